@@ -0,0 +1,158 @@
+/**
+ * Benchmark:  per-call cost of the frame / byte array accessors,
+ *  out of line (bza_get_frame_ptr, bzb_size, bzb_to_asciiz)
+ *  vs. inline (bza_fast_frame_ptr, bzb_fast_size, bzb_fast_data).
+ *  Built twice:  bench_access (checked) and bench_access_unchecked
+ *  (BZA_UNCHECKED).
+ */
+/*
+    buzzard:  blaze runtime (so far, just a simple memory management library)
+
+    Copyright (C) 2010, Robin R Anderson
+    roboprog@yahoo.com
+    PO 1608
+    Shingle Springs, CA 95682
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "bzrt_alloc.h"
+#include "bzrt_bytes.h"
+
+/** number of byte arrays read round robin */
+#define NUM_ARRAYS		64
+
+/** return a monotonic time stamp, in seconds */
+static
+double					now_sec( void)
+	{
+	struct timespec		ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ( ts.tv_nsec / 1e9);
+	}  // _________________________________________________________
+
+/** print the cost per call of a loop */
+static
+void					report
+	(
+	const
+	char *				label,			// what was called
+	double				secs,			// time taken
+	long				calls			// number of calls
+	)
+	{
+	printf( "%-28s %8.2f ns / call\n", label, secs * 1e9 / calls);
+	}  // _________________________________________________________
+
+/**
+ * Time each accessor over a set of byte arrays.
+ *  usage:  bench_access [iterations]
+ */
+int						main
+	(
+	int					argc,
+	char *				argv []
+	)
+	{
+	long				num_iter;
+	t_stack *			stack;
+	size_t				arrays[ NUM_ARRAYS + 1 ];
+	char				text[ 32 ];
+	volatile
+	size_t				sink;
+	long				iter;
+	size_t				cat;
+	double				start;
+
+	num_iter = ( argc > 1) ? atol( argv[ 1 ]) : 20000000;
+#ifdef BZA_UNCHECKED
+	printf( "unchecked (BZA_UNCHECKED), %ld calls\n", num_iter);
+#else
+	printf( "checked, %ld calls\n", num_iter);
+#endif  // BZA_UNCHECKED defined?
+
+	stack = bza_cons_stack( NULL);
+	for ( iter = 0; iter < NUM_ARRAYS; iter++)
+
+		{
+		sprintf( text, "byte array %ld", iter);
+		arrays[ iter ] = bzb_from_asciiz( NULL, &stack, text);
+		}  // make each array
+
+	arrays[ NUM_ARRAYS ] = 0;
+
+	sink = 0;
+	start = now_sec();
+	for ( iter = 0; iter < num_iter; iter++)
+
+		{
+		sink += *(char *) bza_get_frame_ptr( NULL, stack,
+				arrays[ iter % NUM_ARRAYS ]);
+		}  // read each frame
+
+	report( "bza_get_frame_ptr", now_sec() - start, num_iter);
+
+	start = now_sec();
+	for ( iter = 0; iter < num_iter; iter++)
+
+		{
+		sink += *(char *) bza_fast_frame_ptr( stack,
+				arrays[ iter % NUM_ARRAYS ]);
+		}  // read each frame
+
+	report( "bza_fast_frame_ptr", now_sec() - start, num_iter);
+
+	start = now_sec();
+	for ( iter = 0; iter < num_iter; iter++)
+
+		{
+		sink += bzb_size( NULL, stack, arrays[ iter % NUM_ARRAYS ]) +
+				bzb_to_asciiz( NULL, stack, arrays[ iter % NUM_ARRAYS ])[ 0 ];
+		}  // read each array
+
+	report( "bzb_size + bzb_to_asciiz", now_sec() - start, num_iter);
+
+	start = now_sec();
+	for ( iter = 0; iter < num_iter; iter++)
+
+		{
+		sink += bzb_fast_size( stack, arrays[ iter % NUM_ARRAYS ]) +
+				bzb_fast_data( stack, arrays[ iter % NUM_ARRAYS ])[ 0 ];
+		}  // read each array
+
+	report( "bzb_fast_size + bzb_fast_data", now_sec() - start, num_iter);
+
+	// (the library's own loops use the inline forms)
+	start = now_sec();
+	for ( iter = 0; iter < ( num_iter / 100); iter++)
+
+		{
+		cat = bzb_concat( NULL, &stack, arrays);
+		bzb_deref( NULL, stack, cat);
+		}  // concatenate them all
+
+	report( "bzb_concat (64 arrays)", now_sec() - start, num_iter / 100);
+
+	bza_dest_stack( NULL, &stack);
+	return ( sink == 0);
+	}  // _________________________________________________________
+
+// vi: ts=4 sw=4 ai
+// *** EOF ***
@@ -0,0 +1,170 @@
+/**
+ * Benchmark frame payload alignment:  word sums over table-like
+ *  child arrays, and byte array copies, with the payloads at
+ *  16 byte alignment (now), 8 (the old packing) and 1 (worst case).
+ */
+/*
+    buzzard:  blaze runtime (so far, just a simple memory management library)
+
+    Copyright (C) 2010, Robin R Anderson
+    roboprog@yahoo.com
+    PO 1608
+    Shingle Springs, CA 95682
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "bzrt_alloc.h"
+
+/** frames per pass */
+#define NUM_FRAMES		4096
+
+/** words per (child array) frame */
+#define NUM_WORDS		32
+
+/** a word that the compiler may not assume is aligned */
+typedef size_t			t_loose_word __attribute__ ((aligned (1)));
+
+/** return a monotonic time stamp, in seconds */
+static
+double					now_sec( void)
+	{
+	struct timespec		ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ( ts.tv_nsec / 1e9);
+	}  // _________________________________________________________
+
+/** run "num_passes" sum and copy passes with payloads skewed by "skew" */
+static
+void					run_case
+	(
+	const
+	char *				name,			// display name
+	size_t				skew,			// bytes past the frame's payload
+	long				num_passes		// number of passes over the frames
+	)
+	{
+	const
+	size_t				WORDS_SZ = NUM_WORDS * sizeof( size_t);
+
+	t_stack *			stack;
+	size_t				frames[ NUM_FRAMES ];
+	char *				ptrs[ NUM_FRAMES ];
+	t_loose_word *		words;
+	size_t				sum;
+	long				pass;
+	int					idx;
+	int					word;
+	double				start;
+	double				sum_sec;
+	double				copy_sec;
+
+	stack = bza_cons_stack( NULL);
+	for ( idx = 0; idx < NUM_FRAMES; idx++)
+
+		{
+		frames[ idx ] = bza_cons_stk_frame( NULL, &stack, WORDS_SZ + 16);
+		}  // allocate each frame
+
+	for ( idx = 0; idx < NUM_FRAMES; idx++)
+
+		{
+		// stack is done growing, pointers are stable
+		ptrs[ idx ] = bza_get_frame_ptr( NULL, stack, frames[ idx ]) + skew;
+		words = (t_loose_word *) ptrs[ idx ];
+		for ( word = 0; word < NUM_WORDS; word++)
+
+			{
+			words[ word ] = idx + word;
+			}  // fill each word
+
+		}  // find and fill each frame
+
+	sum = 0;
+	start = now_sec();
+	for ( pass = 0; pass < num_passes; pass++)
+
+		{
+		for ( idx = 0; idx < NUM_FRAMES; idx++)
+
+			{
+			words = (t_loose_word *) ptrs[ idx ];
+			for ( word = 0; word < NUM_WORDS; word++)
+
+				{
+				sum += words[ word ];
+				}  // add each word
+
+			}  // each frame
+
+		}  // each pass
+
+	sum_sec = now_sec() - start;
+
+	start = now_sec();
+	for ( pass = 0; pass < num_passes; pass++)
+
+		{
+		for ( idx = 1; idx < NUM_FRAMES; idx++)
+
+			{
+			memcpy( ptrs[ idx ], ptrs[ idx - 1 ], WORDS_SZ);
+			}  // each frame
+
+		}  // each pass
+
+	copy_sec = now_sec() - start;
+	sum += *( (t_loose_word *) ptrs[ NUM_FRAMES - 1 ]);
+
+	printf( "%-12s sum %8.3f s  %8.2f GB/s   copy %8.3f s  %8.2f GB/s  (%lx)\n",
+			name,
+			sum_sec,
+			( ( (double) num_passes) * NUM_FRAMES * WORDS_SZ / sum_sec) / 1e9,
+			copy_sec,
+			( ( (double) num_passes) * NUM_FRAMES * WORDS_SZ / copy_sec) / 1e9,
+			(unsigned long) sum);
+	bza_dest_stack( NULL, &stack);
+	}  // _________________________________________________________
+
+/**
+ * Run at each alignment.
+ *  usage:  bench_align [num_passes]
+ */
+int						main
+	(
+	int					argc,
+	char *				argv []
+	)
+	{
+	long				num_passes;
+
+	num_passes = ( argc > 1) ? atol( argv[ 1 ]) : 2000;
+	printf( "%ld passes, %d frames of %d words\n", num_passes, NUM_FRAMES,
+			NUM_WORDS);
+
+	run_case( "align 16", 0, num_passes);
+	run_case( "align 8", 8, num_passes);
+	run_case( "align 1", 1, num_passes);
+
+	return 0;
+	}  // _________________________________________________________
+
+// vi: ts=4 sw=4 ai
+// *** EOF ***
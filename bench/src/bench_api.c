@@ -0,0 +1,548 @@
+/**
+ * Benchmark each public API across sizes, alongside plain malloc / free
+ *  and libc equivalents, writing the results as JSON (to stdout)
+ *  so that runs can be compared between releases.
+ *  With "-p", each case is also wrapped with hardware counters
+ *  (see bench_perf.h), reported per operation.
+ */
+/*
+    buzzard:  blaze runtime (so far, just a simple memory management library)
+
+    Copyright (C) 2010, Robin R Anderson
+    roboprog@yahoo.com
+    PO 1608
+    Shingle Springs, CA 95682
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <search.h>
+
+#include "bzrt_alloc.h"
+#include "bzrt_bytes.h"
+#include "bzrt_table.h"
+#include "bench_perf.h"
+
+/** frames (or blocks) live at once in the fifo / random patterns */
+#define WINDOW			1024
+
+/** longest byte array built up by appending */
+#define MAX_APPEND		( 64 * 1024)
+
+/** payload sizes to try */
+static
+const
+size_t					SIZES[] = { 16, 256, 4096 };
+
+#define NUM_SIZES		( sizeof( SIZES) / sizeof( SIZES[ 0 ]) )
+
+/** defeats dead code elimination of unused blocks */
+static
+volatile
+char					sink;
+
+/** source bytes, for copies */
+static
+char					src_mem[ MAX_APPEND ];
+
+/** counters for each case, if asked for */
+static
+t_perf					perf;
+
+/** true if "perf" is open */
+static
+int						use_perf;
+
+/** time stamp at the start of the current case */
+static
+double					start_sec;
+
+/** return a monotonic time stamp, in seconds */
+static
+double					now_sec( void)
+	{
+	struct timespec		ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ( ts.tv_nsec / 1e9);
+	}  // _________________________________________________________
+
+/** return the number of operations to time for a size */
+static
+long					ops_for
+	(
+	size_t				size			// payload size
+	)
+	{
+	return ( size <= 256) ? 1000000 : 200000;
+	}  // _________________________________________________________
+
+/** start timing (and counting) a case */
+static
+void					case_start( void)
+	{
+	if ( use_perf)
+		{
+		perf_start( &perf);
+		}  // counting?
+
+	start_sec = now_sec();
+	}  // _________________________________________________________
+
+/**
+ * stop timing the current case, and write its result
+ *  as a JSON object (in the "results" array).
+ */
+static
+void					report
+	(
+	const
+	char *				name,			// benchmark name
+	const
+	char *				impl,			// implementation ("bza", "malloc", ...)
+	size_t				size,			// payload size
+	long				ops				// operations timed
+	)
+	{
+	static
+	int					num_reported;
+
+	double				elapsed;
+	int					ctr;
+
+	elapsed = now_sec() - start_sec;
+	if ( use_perf)
+		{
+		perf_stop( &perf);
+		}  // counting?
+
+	printf( "%s\n    { \"name\": \"%s\", \"impl\": \"%s\", \"size\": %lu, "
+			"\"ops\": %ld, \"ns_per_op\": %.2f",
+			( num_reported++ > 0) ? "," : "",
+			name, impl, (unsigned long) size, ops,
+			( elapsed * 1e9) / ops);
+	fprintf( stderr, "%-14s %-8s %6lu  %10.2f ns / op",
+			name, impl, (unsigned long) size, ( elapsed * 1e9) / ops);
+	for ( ctr = 0; use_perf && ( ctr < PERF_NUM_CTRS); ctr++)
+
+		{
+		if ( perf.fds[ ctr ] >= 0)
+			{
+			printf( ", \"%s\": %.3f", perf_name( ctr), perf.vals[ ctr ] / ops);
+			fprintf( stderr, "  %s %.2f", perf_name( ctr), perf.vals[ ctr ] / ops);
+			}  // available?
+
+		}  // each counter, per op
+
+	printf( " }");
+	fprintf( stderr, "\n");
+	}  // _________________________________________________________
+
+/** frames made and freed in stack (LIFO), FIFO and random order */
+static
+void					bench_frames
+	(
+	size_t				size			// payload size
+	)
+	{
+	static
+	const
+	char *				NAMES[] = { "frame_lifo", "frame_fifo", "frame_random" };
+
+	t_stack *			stack;
+	size_t				frames[ WINDOW ];
+	char *				blocks[ WINDOW ];
+	unsigned int		seed;
+	long				ops;
+	long				op;
+	int					pattern;
+	int					idx;
+
+	ops = ops_for( size);
+	for ( pattern = 0; pattern < 3; pattern++)
+
+		{
+		stack = bza_cons_stack( NULL);
+		seed = 12345;
+		for ( idx = 0; idx < WINDOW; idx++)
+
+			{
+			frames[ idx ] = bza_cons_stk_frame( NULL, &stack, size);
+			}  // fill the window
+
+		case_start();
+		for ( op = 0; op < ops; op++)
+
+			{
+			idx = ( pattern == 0) ? ( WINDOW - 1) :
+					( pattern == 1) ? ( op % WINDOW) :
+					( rand_r( &seed) % WINDOW);
+			bza_deref_stk_frame( NULL, stack, frames[ idx ]);
+			frames[ idx ] = bza_cons_stk_frame( NULL, &stack, size);
+			*(char *) bza_get_frame_ptr( NULL, stack, frames[ idx ]) = 1;
+			}  // replace one
+
+		report( NAMES[ pattern ], "bza", size, ops);
+		bza_dest_stack( NULL, &stack);
+
+		seed = 12345;
+		for ( idx = 0; idx < WINDOW; idx++)
+
+			{
+			blocks[ idx ] = malloc( size);
+			}  // fill the window
+
+		case_start();
+		for ( op = 0; op < ops; op++)
+
+			{
+			idx = ( pattern == 0) ? ( WINDOW - 1) :
+					( pattern == 1) ? ( op % WINDOW) :
+					( rand_r( &seed) % WINDOW);
+			free( blocks[ idx ]);
+			blocks[ idx ] = malloc( size);
+			blocks[ idx ][ 0 ] = 1;
+			}  // replace one
+
+		report( NAMES[ pattern ], "malloc", size, ops);
+		for ( idx = 0; idx < WINDOW; idx++)
+
+			{
+			free( blocks[ idx ]);
+			}  // empty the window
+
+		}  // each pattern
+
+	}  // _________________________________________________________
+
+/** byte arrays copied from memory, and sub-ranges of them */
+static
+void					bench_copies
+	(
+	size_t				size			// payload size
+	)
+	{
+	t_stack *			stack;
+	size_t				whole;
+	size_t				bytes;
+	char *				block;
+	long				ops;
+	long				op;
+
+	ops = ops_for( size);
+	stack = bza_cons_stack( NULL);
+
+	case_start();
+	for ( op = 0; op < ops; op++)
+
+		{
+		bytes = bzb_from_fixed_mem( NULL, &stack, src_mem, size);
+		sink = bzb_to_asciiz( NULL, stack, bytes)[ 0 ];
+		bzb_deref( NULL, stack, bytes);
+		}  // copy one in
+
+	report( "from_fixed_mem", "bza", size, ops);
+
+	case_start();
+	for ( op = 0; op < ops; op++)
+
+		{
+		block = malloc( size + 1);
+		memcpy( block, src_mem, size);
+		block[ size ] = '\0';
+		sink = block[ 0 ];
+		free( block);
+		}  // copy one in
+
+	report( "from_fixed_mem", "malloc", size, ops);
+
+	// (the middle half)
+	whole = bzb_from_fixed_mem( NULL, &stack, src_mem, size * 2);
+	case_start();
+	for ( op = 0; op < ops; op++)
+
+		{
+		bytes = bzb_subarray( NULL, &stack, whole, size / 2, size);
+		sink = bzb_to_asciiz( NULL, stack, bytes)[ 0 ];
+		bzb_deref( NULL, stack, bytes);
+		}  // copy one part out
+
+	report( "subarray", "bza", size, ops);
+
+	case_start();
+	for ( op = 0; op < ops; op++)
+
+		{
+		block = strndup( src_mem + ( size / 2), size);
+		sink = block[ 0 ];
+		free( block);
+		}  // copy one part out
+
+	report( "subarray", "strndup", size, ops);
+
+	bzb_deref( NULL, stack, whole);
+	bza_dest_stack( NULL, &stack);
+	}  // _________________________________________________________
+
+/** byte arrays joined, and appended to (growing) */
+static
+void					bench_concats
+	(
+	size_t				size			// payload size (of each part)
+	)
+	{
+	t_stack *			stack;
+	size_t				parts[ 3 ];
+	size_t				bytes;
+	size_t				grown;
+	char *				block;
+	char *				longer;
+	size_t				len;
+	long				ops;
+	long				op;
+
+	ops = ops_for( size);
+	stack = bza_cons_stack( NULL);
+	parts[ 0 ] = bzb_from_fixed_mem( NULL, &stack, src_mem, size);
+	parts[ 1 ] = bzb_from_fixed_mem( NULL, &stack, src_mem, size);
+	parts[ 2 ] = 0;
+
+	case_start();
+	for ( op = 0; op < ops; op++)
+
+		{
+		bytes = bzb_concat( NULL, &stack, parts);
+		sink = bzb_to_asciiz( NULL, stack, bytes)[ 0 ];
+		bzb_deref( NULL, stack, bytes);
+		}  // join two
+
+	report( "concat", "bza", size, ops);
+
+	case_start();
+	for ( op = 0; op < ops; op++)
+
+		{
+		block = malloc( ( size * 2) + 1);
+		block[ 0 ] = '\0';
+		strncat( block, src_mem, size);
+		strncat( block, src_mem, size);
+		sink = block[ 0 ];
+		free( block);
+		}  // join two
+
+	report( "concat", "strcat", size, ops);
+
+	// append until MAX_APPEND, then start over
+	bytes = bzb_init_size( NULL, &stack, 0);
+	case_start();
+	for ( op = 0; op < ops; op++)
+
+		{
+		if ( ( bzb_size( NULL, stack, bytes) + size) > MAX_APPEND)
+			{
+			bzb_deref( NULL, stack, bytes);
+			bytes = bzb_init_size( NULL, &stack, 0);
+			}  // start over?
+
+		grown = bzb_concat_to( NULL, &stack, bytes, parts[ 0 ]);
+		bzb_deref( NULL, stack, bytes);
+		bytes = grown;
+		}  // append one
+
+	report( "concat_to", "bza", size, ops);
+	bzb_deref( NULL, stack, bytes);
+
+	block = NULL;
+	len = 0;
+	case_start();
+	for ( op = 0; op < ops; op++)
+
+		{
+		if ( ( len + size) > MAX_APPEND)
+			{
+			free( block);
+			block = NULL;
+			len = 0;
+			}  // start over?
+
+		longer = realloc( block, len + size + 1);
+		block = longer;
+		memcpy( block + len, src_mem, size);
+		len += size;
+		block[ len ] = '\0';
+		}  // append one
+
+	sink = block[ 0 ];
+	report( "concat_to", "realloc", size, ops);
+	free( block);
+
+	bza_dest_stack( NULL, &stack);
+	}  // _________________________________________________________
+
+/** compare tsearch keys (C strings) */
+static
+int						cmp_keys
+	(
+	const
+	void *				a,				// key
+	const
+	void *				b				// key
+	)
+	{
+	return strcmp( a, b);
+	}  // _________________________________________________________
+
+/** table inserts and lookups of 16 byte keys, values of the given size */
+static
+void					bench_table
+	(
+	size_t				size			// value size
+	)
+	{
+	const
+	long				NUM_KEYS = 10000;
+
+	t_stack *			stack;
+	size_t				table;
+	char *				keys;
+	void *				root;
+	char *				key;
+	long				idx;
+	long				ops;
+
+	keys = malloc( NUM_KEYS * 17);
+	for ( idx = 0; idx < NUM_KEYS; idx++)
+
+		{
+		sprintf( keys + ( idx * 17), "%08lx%08lx", idx * 2654435761UL, idx);
+		}  // make up keys
+
+	stack = bza_cons_stack( NULL);
+	table = bzt_init( NULL, &stack);
+	case_start();
+	for ( idx = 0; idx < NUM_KEYS; idx++)
+
+		{
+		bzt_put( NULL, &stack, table, keys + ( idx * 17), 16, src_mem, size);
+		}  // insert each key
+
+	report( "table_put", "bza", size, NUM_KEYS);
+
+	ops = ops_for( size);
+	case_start();
+	for ( idx = 0; idx < ops; idx++)
+
+		{
+		sink = bzt_get( NULL, stack, table,
+				keys + ( ( idx % NUM_KEYS) * 17), 16) != 0;
+		}  // look up a key
+
+	report( "table_get", "bza", size, ops);
+	bza_dest_stack( NULL, &stack);
+
+	// libc binary tree, of keys followed by (copied) values
+	root = NULL;
+	case_start();
+	for ( idx = 0; idx < NUM_KEYS; idx++)
+
+		{
+		key = malloc( 17 + size);
+		memcpy( key, keys + ( idx * 17), 17);
+		memcpy( key + 17, src_mem, size);
+		tsearch( key, &root, cmp_keys);
+		}  // insert each key
+
+	report( "table_put", "tsearch", size, NUM_KEYS);
+
+	case_start();
+	for ( idx = 0; idx < ops; idx++)
+
+		{
+		sink = tfind( keys + ( ( idx % NUM_KEYS) * 17), &root, cmp_keys) != NULL;
+		}  // look up a key
+
+	report( "table_get", "tsearch", size, ops);
+	tdestroy( root, free);
+	free( keys);
+	}  // _________________________________________________________
+
+/**
+ * Run each benchmark at each size.
+ *  usage:  bench_api [-p] > results.json   (a summary goes to stderr)
+ *  -p:  also count cycles, cache misses etc. (where available)
+ */
+int						main
+	(
+	int					argc,
+	char *				argv []
+	)
+	{
+	size_t				idx;
+	int					ctr;
+	int					num_listed;
+
+	if ( ( argc > 1) && ( strcmp( argv[ 1 ], "-p") == 0) )
+		{
+		use_perf = ( perf_open( &perf) > 0);
+		for ( ctr = 0; ctr < PERF_NUM_CTRS; ctr++)
+
+			{
+			if ( perf.fds[ ctr ] < 0)
+				{
+				fprintf( stderr, "(no %s counter)\n", perf_name( ctr) );
+				}  // unavailable?
+
+			}  // note each missing counter
+
+		}  // count events?
+
+	memset( src_mem, 'x', sizeof( src_mem) );
+	printf( "{\n  \"suite\": \"bench_api\",\n  \"time\": %ld,\n"
+			"  \"counters\": [", (long) time( NULL) );
+	num_listed = 0;
+	for ( ctr = 0; use_perf && ( ctr < PERF_NUM_CTRS); ctr++)
+
+		{
+		if ( perf.fds[ ctr ] >= 0)
+			{
+			printf( "%s\"%s\"", ( num_listed++ > 0) ? ", " : "", perf_name( ctr) );
+			}  // available?
+
+		}  // list each counter
+
+	printf( "],\n  \"results\": [");
+	for ( idx = 0; idx < NUM_SIZES; idx++)
+
+		{
+		bench_frames( SIZES[ idx ]);
+		bench_copies( SIZES[ idx ]);
+		bench_concats( SIZES[ idx ]);
+		bench_table( SIZES[ idx ]);
+		}  // each size
+
+	printf( "\n  ]\n}\n");
+	if ( use_perf)
+		{
+		perf_close( &perf);
+		}  // counted?
+
+	return 0;
+	}  // _________________________________________________________
+
+// vi: ts=4 sw=4 ai
+// *** EOF ***
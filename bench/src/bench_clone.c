@@ -0,0 +1,157 @@
+/**
+ * Benchmark:  speculative change to a large stack,
+ *  cloned by copying (before) vs. copy-on-write (BZA_OPT_COW).
+ */
+/*
+    buzzard:  blaze runtime (so far, just a simple memory management library)
+
+    Copyright (C) 2010, Robin R Anderson
+    roboprog@yahoo.com
+    PO 1608
+    Shingle Springs, CA 95682
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "bzrt_alloc.h"
+
+/** payload size of each frame */
+#define FRAME_SZ		4000
+
+/** return a monotonic time stamp, in seconds */
+static
+double					now_sec( void)
+	{
+	struct timespec		ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ( ts.tv_nsec / 1e9);
+	}  // _________________________________________________________
+
+/** fill a stack with "num" frames, return their offsets */
+static
+size_t *				fill
+	(
+	t_stack * *			a_stack,		// stack to be filled
+	long				num				// number of frames
+	)
+	{
+	size_t *			frames;
+	long				idx;
+
+	frames = malloc( num * sizeof( size_t) );
+	bza_reserve( NULL, a_stack, num * ( FRAME_SZ + 64) );
+	for ( idx = 0; idx < num; idx++)
+
+		{
+		frames[ idx ] = bza_cons_stk_frame( NULL, a_stack, FRAME_SZ);
+		memset( bza_get_frame_ptr( NULL, *a_stack, frames[ idx ]),
+				(int) idx, FRAME_SZ);
+		}  // add each frame
+
+	return frames;
+	}  // _________________________________________________________
+
+/**
+ * clone a stack, overwrite 1% of its frames (at random) in the clone,
+ *  then throw the clone away;  print the time for each step.
+ */
+static
+void					speculate
+	(
+	const
+	char *				label,			// what sort of stack
+	t_stack *			stack,			// stack to be cloned
+	const
+	size_t *			frames,			// its frames
+	long				num				// number of frames
+	)
+	{
+	t_stack *			clone;
+	unsigned int		seed;
+	long				idx;
+	double				start;
+	double				cloned;
+	double				changed;
+	double				dropped;
+
+	seed = 12345;
+	start = now_sec();
+	clone = bza_clone_stack( NULL, stack);
+	cloned = now_sec();
+	for ( idx = 0; idx < ( num / 100); idx++)
+
+		{
+		memset( bza_get_frame_ptr( NULL, clone,
+				frames[ rand_r( &seed) % num ]), 'x', FRAME_SZ);
+		}  // change 1%
+
+	changed = now_sec();
+	bza_dest_stack( NULL, &clone);
+	dropped = now_sec();
+
+	printf( "%-14s clone %10.3f ms  change %8.3f ms  drop %8.3f ms"
+			"  total %10.3f ms\n",
+			label, ( cloned - start) * 1e3, ( changed - cloned) * 1e3,
+			( dropped - changed) * 1e3, ( dropped - start) * 1e3);
+	}  // _________________________________________________________
+
+/**
+ * Compare cloning by copy with copy-on-write cloning.
+ *  usage:  bench_clone [megabytes]
+ */
+int						main
+	(
+	int					argc,
+	char *				argv []
+	)
+	{
+	long				mbytes;
+	long				num;
+	t_stack_opts		opts;
+	t_stack *			stack;
+	size_t *			frames;
+
+	mbytes = ( argc > 1) ? atol( argv[ 1 ]) : 500;
+	num = ( mbytes << 20) / FRAME_SZ;
+	printf( "%ld MB stack (%ld frames of %d bytes), 1%% changed\n",
+			mbytes, num, FRAME_SZ);
+
+	stack = bza_cons_stack( NULL);
+	frames = fill( &stack, num);
+	speculate( "copied", stack, frames, num);
+	bza_dest_stack( NULL, &stack);
+	free( frames);
+
+	memset( &opts, 0, sizeof( opts) );
+	opts.flags = BZA_OPT_COW;
+	stack = bza_cons_stack_opts( NULL, &opts);
+	frames = fill( &stack, num);
+	speculate( "cow", stack, frames, num);
+
+	// (the original changes too, then is cloned again)
+	memset( bza_get_frame_ptr( NULL, stack, frames[ 0 ]), 'y', FRAME_SZ);
+	speculate( "cow (again)", stack, frames, num);
+	bza_dest_stack( NULL, &stack);
+	free( frames);
+	return 0;
+	}  // _________________________________________________________
+
+// vi: ts=4 sw=4 ai
+// *** EOF ***
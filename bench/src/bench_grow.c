@@ -0,0 +1,132 @@
+/**
+ * Benchmark stack growth policies:
+ *  reallocation counts and throughput for many small frames.
+ */
+/*
+    buzzard:  blaze runtime (so far, just a simple memory management library)
+
+    Copyright (C) 2010, Robin R Anderson
+    roboprog@yahoo.com
+    PO 1608
+    Shingle Springs, CA 95682
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "bzrt_alloc.h"
+
+/** a growth policy to be measured */
+typedef struct			t_policy_case
+	{
+	const
+	char *				name;			// display name
+	tf_grow_policy		grow;			// policy
+	size_t				grow_arg;		// policy parameter
+	}					t_policy_case;
+
+/** return a monotonic time stamp, in seconds */
+static
+double					now_sec( void)
+	{
+	struct timespec		ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ( ts.tv_nsec / 1e9);
+	}  // _________________________________________________________
+
+/** allocate "num_frames" frames of "frame_sz" on a fresh stack, report */
+static
+void					run_case
+	(
+	const
+	t_policy_case *		pcase,			// policy to be measured
+	long				num_frames,		// number of frames to allocate
+	size_t				frame_sz		// size of each frame
+	)
+	{
+	t_stack_opts		opts;
+	t_stack *			stack;
+	long				idx;
+	double				start;
+	double				elapsed;
+
+	memset( &opts, 0, sizeof( opts) );
+	opts.grow = pcase->grow;
+	opts.grow_arg = pcase->grow_arg;
+
+	start = now_sec();
+	stack = bza_cons_stack_opts( NULL, &opts);
+	for ( idx = 0; idx < num_frames; idx++)
+
+		{
+		bza_cons_stk_frame( NULL, &stack, frame_sz);
+		}  // allocate each frame
+
+	elapsed = now_sec() - start;
+
+	printf( "%-16s %10ld reallocs %12ld bytes %8.3f s %10.2f Mframes/s\n",
+			pcase->name,
+			(long) stack->num_grows,
+			(long) stack->size,
+			elapsed,
+			( num_frames / elapsed) / 1e6);
+	bza_dest_stack( NULL, &stack);
+	}  // _________________________________________________________
+
+/**
+ * Run each growth policy:  "exact" is the old behavior.
+ *  usage:  bench_grow [num_frames [frame_size]]
+ */
+int						main
+	(
+	int					argc,
+	char *				argv []
+	)
+	{
+	static const
+	t_policy_case		CASES[] =
+		{
+			{ "exact (before)",	bza_grow_exact,		0 },
+			{ "double",			bza_grow_double,	0 },
+			{ "half (1.5x)",	bza_grow_half,		0 },
+			{ "chunk 64K",		bza_grow_chunk,		0 },
+			{ "chunk 1M",		bza_grow_chunk,		( 1 << 20) },
+			{ NULL,				NULL,				0 }
+		};
+
+	long				num_frames;
+	size_t				frame_sz;
+	const
+	t_policy_case *		pcase;
+
+	num_frames = ( argc > 1) ? atol( argv[ 1 ]) : 1000000;
+	frame_sz = ( argc > 2) ? (size_t) atol( argv[ 2 ]) : 16;
+	printf( "%ld frames of %d bytes\n", num_frames, (int) frame_sz);
+
+	for ( pcase = CASES; pcase->name != NULL; pcase++)
+
+		{
+		run_case( pcase, num_frames, frame_sz);
+		}  // measure each policy
+
+	return 0;
+	}  // _________________________________________________________
+
+// vi: ts=4 sw=4 ai
+// *** EOF ***
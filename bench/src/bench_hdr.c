@@ -0,0 +1,122 @@
+/**
+ * Benchmark frame marker footprint:  a million tiny (8 byte) strings,
+ *  as raw frames and as byte arrays, with the full (24 byte)
+ *  and compact (8 byte) frame markers.
+ */
+/*
+    buzzard:  blaze runtime (so far, just a simple memory management library)
+
+    Copyright (C) 2010, Robin R Anderson
+    roboprog@yahoo.com
+    PO 1608
+    Shingle Springs, CA 95682
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "bzrt_alloc.h"
+#include "bzrt_bytes.h"
+
+/** return a monotonic time stamp, in seconds */
+static
+double					now_sec( void)
+	{
+	struct timespec		ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ( ts.tv_nsec / 1e9);
+	}  // _________________________________________________________
+
+/** build "num_strs" strings on a fresh stack, report */
+static
+void					run_case
+	(
+	const
+	char *				name,			// display name
+	int					flags,			// BZA_OPT_* bits for the stack
+	int					is_bytes,		// byte arrays, rather than raw frames?
+	long				num_strs		// number of strings to build
+	)
+	{
+	t_stack_opts		opts;
+	t_stack *			stack;
+	char				str[ 9 ];
+	size_t				frame;
+	long				idx;
+	double				start;
+	double				elapsed;
+
+	memset( &opts, 0, sizeof( opts) );
+	opts.flags = flags;
+
+	start = now_sec();
+	stack = bza_cons_stack_opts( NULL, &opts);
+	for ( idx = 0; idx < num_strs; idx++)
+
+		{
+		snprintf( str, sizeof( str), "%08x", (unsigned int) idx);
+		if ( is_bytes)
+			{
+			bzb_from_fixed_mem( NULL, &stack, str, 8);
+			}  // whole byte array?
+		else
+			{
+			frame = bza_cons_stk_frame( NULL, &stack, 8);
+			memcpy( bza_get_frame_ptr( NULL, stack, frame), str, 8);
+			}  // just the chars?
+
+		}  // build each string
+
+	elapsed = now_sec() - start;
+
+	printf( "%-24s top %12ld  (%5.1f b/str)  size %12ld  %8.3f s  %8.2f Mstr/s\n",
+			name,
+			(long) stack->top,
+			( (double) stack->top) / num_strs,
+			(long) stack->size,
+			elapsed,
+			( num_strs / elapsed) / 1e6);
+	bza_dest_stack( NULL, &stack);
+	}  // _________________________________________________________
+
+/**
+ * Run each marker form.
+ *  usage:  bench_hdr [num_strings]
+ */
+int						main
+	(
+	int					argc,
+	char *				argv []
+	)
+	{
+	long				num_strs;
+
+	num_strs = ( argc > 1) ? atol( argv[ 1 ]) : 1000000;
+	printf( "%ld strings of 8 bytes\n", num_strs);
+
+	run_case( "frames, full marker", 0, 0, num_strs);
+	run_case( "frames, compact marker", BZA_OPT_COMPACT_HDR, 0, num_strs);
+	run_case( "bytes, full marker", 0, 1, num_strs);
+	run_case( "bytes, compact marker", BZA_OPT_COMPACT_HDR, 1, num_strs);
+
+	return 0;
+	}  // _________________________________________________________
+
+// vi: ts=4 sw=4 ai
+// *** EOF ***
@@ -0,0 +1,144 @@
+/**
+ * Benchmark reuse of dead frames stranded under live ones:
+ *  a long running "request" stack where each request leaves one
+ *  long lived frame on top of its (dead) temporaries.
+ */
+/*
+    buzzard:  blaze runtime (so far, just a simple memory management library)
+
+    Copyright (C) 2010, Robin R Anderson
+    roboprog@yahoo.com
+    PO 1608
+    Shingle Springs, CA 95682
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "bzrt_alloc.h"
+
+/** temporaries per request */
+#define NUM_TEMPS		8
+
+/** return a monotonic time stamp, in seconds */
+static
+double					now_sec( void)
+	{
+	struct timespec		ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ( ts.tv_nsec / 1e9);
+	}  // _________________________________________________________
+
+/** simulate "num_reqs" requests on a fresh stack, report */
+static
+void					run_case
+	(
+	const
+	char *				name,			// display name
+	int					flags,			// BZA_OPT_* bits for the stack
+	long				num_reqs		// number of requests to simulate
+	)
+	{
+	t_stack_opts		opts;
+	t_stack *			stack;
+	size_t				temps[ NUM_TEMPS ];
+	size_t				session;
+	size_t				prev_session;
+	size_t				max_stranded;
+	unsigned int		seed;
+	long				req;
+	int					idx;
+	double				start;
+	double				elapsed;
+
+	memset( &opts, 0, sizeof( opts) );
+	opts.flags = flags;
+	seed = 12345;
+	prev_session = 0;
+	max_stranded = 0;
+
+	start = now_sec();
+	stack = bza_cons_stack_opts( NULL, &opts);
+	for ( req = 0; req < num_reqs; req++)
+
+		{
+		for ( idx = 0; idx < NUM_TEMPS; idx++)
+
+			{
+			temps[ idx ] = bza_cons_stk_frame( NULL, &stack,
+					16 + ( rand_r( &seed) % 496) );
+			}  // allocate each temporary
+
+		session = bza_cons_stk_frame( NULL, &stack, 64);
+
+		for ( idx = 0; idx < NUM_TEMPS; idx++)
+
+			{
+			bza_deref_stk_frame( NULL, stack, temps[ idx ]);
+			}  // release each temporary
+
+		if ( prev_session != 0)
+			{
+			bza_deref_stk_frame( NULL, stack, prev_session);
+			}  // previous long lived frame now done?
+
+		prev_session = session;
+		if ( bza_get_stranded_bytes( NULL, stack) > max_stranded)
+			{
+			max_stranded = bza_get_stranded_bytes( NULL, stack);
+			}  // new worst case?
+
+		}  // simulate each request
+
+	elapsed = now_sec() - start;
+
+	printf( "%-18s top %12ld  size %12ld  stranded %12ld (max %12ld)  %8.3f s  %8.2f Kreq/s\n",
+			name,
+			(long) stack->top,
+			(long) stack->size,
+			(long) bza_get_stranded_bytes( NULL, stack),
+			(long) max_stranded,
+			elapsed,
+			( num_reqs / elapsed) / 1e3);
+	bza_dest_stack( NULL, &stack);
+	}  // _________________________________________________________
+
+/**
+ * Run with and without hole reuse.
+ *  usage:  bench_holes [num_requests]
+ */
+int						main
+	(
+	int					argc,
+	char *				argv []
+	)
+	{
+	long				num_reqs;
+
+	num_reqs = ( argc > 1) ? atol( argv[ 1 ]) : 100000;
+	printf( "%ld requests, %d temporaries each\n", num_reqs, NUM_TEMPS);
+
+	run_case( "no reuse (before)", BZA_OPT_NO_HOLE_REUSE, num_reqs);
+	run_case( "hole reuse", 0, num_reqs);
+
+	return 0;
+	}  // _________________________________________________________
+
+// vi: ts=4 sw=4 ai
+// *** EOF ***
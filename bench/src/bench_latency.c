@@ -0,0 +1,198 @@
+/**
+ * Benchmark:  per-call latency of frame allocation (plus first touch)
+ *  on "real time" stacks, with and without pre-faulting,
+ *  locking and huge pages;  reports p50 / p99 / p99.9 / max.
+ */
+/*
+    buzzard:  blaze runtime (so far, just a simple memory management library)
+
+    Copyright (C) 2010, Robin R Anderson
+    roboprog@yahoo.com
+    PO 1608
+    Shingle Springs, CA 95682
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "bzrt_alloc.h"
+
+/** a stack configuration to be measured */
+typedef struct			t_rt_case
+	{
+	const
+	char *				name;			// display name
+	int					is_fixed;		// true for a fixed size stack
+	int					flags;			// BZA_OPT_* option bits
+	}					t_rt_case;
+
+/** return a monotonic time stamp, in nanoseconds */
+static
+long long				now_nsec( void)
+	{
+	struct timespec		ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts);
+	return ( ts.tv_sec * 1000000000LL) + ts.tv_nsec;
+	}  // _________________________________________________________
+
+/** comparison for qsort */
+static
+int						cmp_nsec
+	(
+	const
+	void *				a,
+	const
+	void *				b
+	)
+	{
+	long long			diff;
+
+	diff = *(const long long *) a - *(const long long *) b;
+	return ( diff > 0) - ( diff < 0);
+	}  // _________________________________________________________
+
+/** return the given percentile of sorted samples */
+static
+long long				pctile
+	(
+	const
+	long long *			samples,		// sorted samples
+	long				num,			// number of samples
+	double				pct				// percentile (0 .. 100)
+	)
+	{
+	long				idx;
+
+	idx = (long) ( ( pct / 100.0) * num);
+	return samples[ ( idx < num) ? idx : ( num - 1) ];
+	}  // _________________________________________________________
+
+/**
+ * time each of "num_frames" allocations of "frame_sz"
+ *  (each frame's first and last byte written) on a fresh stack, report.
+ */
+static
+void					run_case
+	(
+	const
+	t_rt_case *			rcase,			// configuration to be measured
+	long				num_frames,		// number of frames to allocate
+	size_t				frame_sz,		// size of each frame
+	long long *			samples			// room for "num_frames" samples
+	)
+	{
+	t_stack_opts		opts;
+	t_stack *			stack;
+	jmp_buf				catcher;
+	long				idx;
+	long long			start;
+	long long			cons_nsec;
+	char *				ptr;
+
+	memset( &opts, 0, sizeof( opts) );
+	opts.initial_size = rcase->is_fixed ?
+			(size_t) ( num_frames * ( frame_sz + 64) ) : 0;
+	opts.is_fixed = rcase->is_fixed;
+	opts.flags = rcase->flags;
+
+	if ( setjmp( catcher) )
+		{
+		printf( "%-24s (failed:  mlock limit?  see \"ulimit -l\")\n",
+				rcase->name);
+		return;  // === skip ===
+		}  // can't set up?
+
+	start = now_nsec();
+	stack = bza_cons_stack_opts( &catcher, &opts);
+	cons_nsec = now_nsec() - start;
+
+	for ( idx = 0; idx < num_frames; idx++)
+
+		{
+		start = now_nsec();
+		ptr = bza_get_frame_ptr( NULL, stack,
+				bza_cons_stk_frame( NULL, &stack, frame_sz) );
+		ptr[ 0 ] = 1;
+		ptr[ frame_sz - 1 ] = 1;
+		samples[ idx ] = now_nsec() - start;
+		}  // time each frame
+
+	bza_dest_stack( NULL, &stack);
+
+	qsort( samples, num_frames, sizeof( samples[ 0 ]), cmp_nsec);
+	printf( "%-24s %10.3f %8lld %8lld %8lld %10lld\n",
+			rcase->name,
+			cons_nsec / 1e6,
+			pctile( samples, num_frames, 50.0),
+			pctile( samples, num_frames, 99.0),
+			pctile( samples, num_frames, 99.9),
+			samples[ num_frames - 1 ]);
+	}  // _________________________________________________________
+
+/**
+ * Run each configuration:  "growing heap" is the default stack.
+ *  usage:  bench_latency [num_frames [frame_size]]
+ *  (the default fits within an 8 MB RLIMIT_MEMLOCK)
+ */
+int						main
+	(
+	int					argc,
+	char *				argv []
+	)
+	{
+	static const
+	t_rt_case			CASES[] =
+		{
+			{ "growing heap",			0,	0 },
+			{ "fixed heap",				1,	0 },
+			{ "fixed prefault",			1,	BZA_OPT_PREFAULT },
+			{ "fixed prefault+lock",	1,	BZA_OPT_PREFAULT | BZA_OPT_LOCK },
+			{ "fixed prefault+huge",	1,	BZA_OPT_PREFAULT | BZA_OPT_HUGE },
+			{ "fixed all",				1,
+					BZA_OPT_PREFAULT | BZA_OPT_LOCK | BZA_OPT_HUGE },
+			{ "growing prefault",		0,	BZA_OPT_PREFAULT },
+			{ NULL,						0,	0 }
+		};
+
+	long				num_frames;
+	size_t				frame_sz;
+	long long *			samples;
+	const
+	t_rt_case *			rcase;
+
+	num_frames = ( argc > 1) ? atol( argv[ 1 ]) : 20000;
+	frame_sz = ( argc > 2) ? (size_t) atol( argv[ 2 ]) : 256;
+	samples = malloc( num_frames * sizeof( samples[ 0 ]) );
+	printf( "%ld frames of %d bytes, latency in ns\n",
+			num_frames, (int) frame_sz);
+	printf( "%-24s %10s %8s %8s %8s %10s\n",
+			"stack", "setup ms", "p50", "p99", "p99.9", "max");
+
+	for ( rcase = CASES; rcase->name != NULL; rcase++)
+
+		{
+		run_case( rcase, num_frames, frame_sz, samples);
+		}  // measure each configuration
+
+	free( samples);
+	return 0;
+	}  // _________________________________________________________
+
+// vi: ts=4 sw=4 ai
+// *** EOF ***
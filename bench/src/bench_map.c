@@ -0,0 +1,157 @@
+/**
+ * Benchmark:  warm-up of a lookup table,
+ *  built key by key (before) vs. mapped from a saved stack.
+ */
+/*
+    buzzard:  blaze runtime (so far, just a simple memory management library)
+
+    Copyright (C) 2010, Robin R Anderson
+    roboprog@yahoo.com
+    PO 1608
+    Shingle Springs, CA 95682
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "bzrt_alloc.h"
+#include "bzrt_table.h"
+
+/** return a monotonic time stamp, in seconds */
+static
+double					now_sec( void)
+	{
+	struct timespec		ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ( ts.tv_nsec / 1e9);
+	}  // _________________________________________________________
+
+/** look up "num_keys" keys, return the time taken */
+static
+double					look_up
+	(
+	t_stack *			stack,			// stack holding the table
+	size_t				table,			// the table
+	long				num_keys		// number of keys
+	)
+	{
+	char				key[ 32 ];
+	unsigned int		seed;
+	long				idx;
+	long				found;
+	double				start;
+
+	seed = 12345;
+	found = 0;
+	start = now_sec();
+	for ( idx = 0; idx < num_keys; idx++)
+
+		{
+		sprintf( key, "%08x%08x", rand_r( &seed), (unsigned int) idx);
+		found += ( bzt_get( NULL, stack, table, key, 16) != 0);
+		}  // look up each key
+
+	if ( found != num_keys)
+		{
+		fprintf( stderr, "lost keys:  %ld of %ld found\n", found, num_keys);
+		exit( 1);
+		}  // broken?
+
+	return now_sec() - start;
+	}  // _________________________________________________________
+
+/**
+ * Build a table, save it, then compare building with mapping.
+ *  usage:  bench_map [num_keys [file]]
+ */
+int						main
+	(
+	int					argc,
+	char *				argv []
+	)
+	{
+	long				num_keys;
+	const
+	char *				path;
+	t_stack *			stack;
+	t_stack *			mapped;
+	size_t				table;
+	size_t				root;
+	char				key[ 32 ];
+	unsigned int		seed;
+	long				idx;
+	int					fd;
+	double				start;
+	double				build;
+	double				map;
+
+	num_keys = ( argc > 1) ? atol( argv[ 1 ]) : 20000;
+	path = ( argc > 2) ? argv[ 2 ] : "bin/bench_map.stk";
+	printf( "%ld random 16 byte keys\n", num_keys);
+
+	seed = 12345;
+	start = now_sec();
+	stack = bza_cons_stack( NULL);
+	table = bzt_init( NULL, &stack);
+	for ( idx = 0; idx < num_keys; idx++)
+
+		{
+		sprintf( key, "%08x%08x", rand_r( &seed), (unsigned int) idx);
+		bzt_put( NULL, &stack, table, key, 16, key, 16);
+		}  // insert each key
+
+	build = now_sec() - start;
+
+	fd = open( path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if ( fd < 0)
+		{
+		perror( path);
+		return 1;
+		}  // can't save?
+
+	start = now_sec();
+	bza_save_stack( NULL, stack, table, fd);
+	close( fd);
+	printf( "save     %10.3f ms  (%ld bytes)\n",
+			( now_sec() - start) * 1e3, (long) stack->top);
+
+	start = now_sec();
+	mapped = bza_map_stack( NULL, path, 0, &root);
+	map = now_sec() - start;
+
+	printf( "build    %10.3f ms\n", build * 1e3);
+	printf( "map      %10.3f ms  (%.0fx faster)\n", map * 1e3, build / map);
+	printf( "lookups  %10.3f ms  built\n",
+			look_up( stack, table, num_keys) * 1e3);
+	printf( "lookups  %10.3f ms  mapped (first touch)\n",
+			look_up( mapped, root, num_keys) * 1e3);
+	printf( "lookups  %10.3f ms  mapped\n",
+			look_up( mapped, root, num_keys) * 1e3);
+
+	bza_dest_stack( NULL, &mapped);
+	bzt_deref( NULL, stack, table);
+	bza_dest_stack( NULL, &stack);
+	unlink( path);
+	return 0;
+	}  // _________________________________________________________
+
+// vi: ts=4 sw=4 ai
+// *** EOF ***
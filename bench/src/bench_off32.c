@@ -0,0 +1,173 @@
+/**
+ * Benchmark 32 bit offsets (BZA_OPT_OFF32):  the same table of
+ *  hashed 8 char keys built on a normal stack, one with just
+ *  the compact frame marker, and a 32 bit one,
+ *  comparing the memory used, and the time (and, where
+ *  the hardware counters are available, cache misses)
+ *  per lookup in scattered order.
+ */
+/*
+    buzzard:  blaze runtime (so far, just a simple memory management library)
+
+    Copyright (C) 2010, Robin R Anderson
+    roboprog@yahoo.com
+    PO 1608
+    Shingle Springs, CA 95682
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "bzrt_alloc.h"
+#include "bzrt_table.h"
+#include "bench_perf.h"
+
+/** return a monotonic time stamp, in seconds */
+static
+double					now_sec( void)
+	{
+	struct timespec		ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ( ts.tv_nsec / 1e9);
+	}  // _________________________________________________________
+
+/** format the key for an index (scattered, so lookups miss the cache) */
+static
+void					make_key
+	(
+	char *				key,			// 9 bytes of output
+	long				idx				// key number
+	)
+	{
+	snprintf( key, 9, "%08x", (unsigned int) ( idx * 2654435761u) );
+	}  // _________________________________________________________
+
+/** build a table of "num_keys" keys on a fresh stack, look each up, report */
+static
+void					run_case
+	(
+	const
+	char *				name,			// display name
+	int					flags,			// BZA_OPT_* bits for the stack
+	long				num_keys,		// number of keys
+	t_perf *			perf,			// counters
+	int					use_perf		// true if "perf" is open
+	)
+	{
+	t_stack_opts		opts;
+	t_stack *			stack;
+	size_t				table;
+	char				key[ 9 ];
+	long				idx;
+	long				found;
+	int					ctr;
+	double				start;
+	double				build;
+	double				lookup;
+
+	memset( &opts, 0, sizeof( opts) );
+	opts.flags = flags;
+
+	start = now_sec();
+	stack = bza_cons_stack_opts( NULL, &opts);
+	table = bzt_init( NULL, &stack);
+	for ( idx = 0; idx < num_keys; idx++)
+
+		{
+		make_key( key, idx);
+		bzt_put( NULL, &stack, table, key, 8, key, 4);
+		}  // put each key
+
+	build = now_sec() - start;
+
+	// visit the keys in another order than they were put
+	found = 0;
+	if ( use_perf)
+		{
+		perf_start( perf);
+		}  // count?
+
+	start = now_sec();
+	for ( idx = 0; idx < num_keys; idx++)
+
+		{
+		make_key( key, ( idx * 7919) % num_keys);
+		found += ( bzt_get( NULL, stack, table, key, 8) != 0);
+		}  // get each key
+
+	lookup = now_sec() - start;
+	if ( use_perf)
+		{
+		perf_stop( perf);
+		}  // count?
+
+	printf( "%-10s top %12ld  (%5.1f b/key)  build %8.3f s  get %7.1f ns%s",
+			name,
+			(long) stack->top,
+			( (double) stack->top) / num_keys,
+			build,
+			( lookup * 1e9) / num_keys,
+			( found == num_keys) ? "" : "  (MISSING KEYS!)");
+	for ( ctr = 0; use_perf && ( ctr < PERF_NUM_CTRS); ctr++)
+
+		{
+		if ( perf->fds[ ctr ] >= 0)
+			{
+			printf( "  %s %.2f", perf_name( ctr),
+					perf->vals[ ctr ] / num_keys);
+			}  // available?
+
+		}  // report each counter, per lookup
+
+	printf( "\n");
+	bza_dest_stack( NULL, &stack);
+	}  // _________________________________________________________
+
+/**
+ * Run each offset size.
+ *  usage:  bench_off32 [num_keys]
+ *  (10000000 keys take a few GB per case)
+ */
+int						main
+	(
+	int					argc,
+	char *				argv []
+	)
+	{
+	long				num_keys;
+	t_perf				perf;
+	int					use_perf;
+
+	num_keys = ( argc > 1) ? atol( argv[ 1 ]) : 100000;
+	printf( "table of %ld keys of 8 bytes\n", num_keys);
+
+	use_perf = ( perf_open( &perf) > 0);
+	run_case( "full", 0, num_keys, &perf, use_perf);
+	run_case( "compact", BZA_OPT_COMPACT_HDR, num_keys, &perf, use_perf);
+	run_case( "32 bit", BZA_OPT_OFF32, num_keys, &perf, use_perf);
+	if ( use_perf)
+		{
+		perf_close( &perf);
+		}  // counted?
+
+	return 0;
+	}  // _________________________________________________________
+
+// vi: ts=4 sw=4 ai
+// *** EOF ***
@@ -0,0 +1,193 @@
+/**
+ * Optional hardware performance counters for the benchmarks
+ *  (via perf_event_open).
+ *  Each counter is opened on its own, so that a missing one
+ *  (e.g. no LLC events on a VM) doesn't cost the others.
+ */
+/*
+    buzzard:  blaze runtime (so far, just a simple memory management library)
+
+    Copyright (C) 2010, Robin R Anderson
+    roboprog@yahoo.com
+    PO 1608
+    Shingle Springs, CA 95682
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "bench_perf.h"
+
+/** cache event config:  (cache) | (op << 8) | (result << 16) */
+#define CACHE_MISS( cache, op)	\
+	( (cache) | ( (op) << 8) | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16) )
+
+/** what each counter counts */
+static
+const
+struct
+	{
+	const
+	char *				name;			// JSON name
+	uint32_t			type;			// PERF_TYPE_*
+	uint64_t			config;			// event
+	}					CTRS[ PERF_NUM_CTRS ] =
+	{
+	{ "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	{ "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	{ "l1d_misses", PERF_TYPE_HW_CACHE,
+			CACHE_MISS( PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ) },
+	{ "llc_misses", PERF_TYPE_HW_CACHE,
+			CACHE_MISS( PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ) },
+	{ "branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+	{ "dtlb_misses", PERF_TYPE_HW_CACHE,
+			CACHE_MISS( PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ) },
+	{ "page_faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS }
+	};
+
+/** return the (JSON) name of a counter */
+const
+char *					perf_name
+	(
+	int					ctr				// e_perf_ctr
+	)
+	{
+	return CTRS[ ctr ].name;
+	}  // _________________________________________________________
+
+/**
+ * open whichever counters are available for this thread,
+ *  return how many there are.
+ */
+int						perf_open
+	(
+	t_perf *			perf			// counters to be opened
+	)
+	{
+	struct perf_event_attr	attr;
+	int					ctr;
+	int					num_open;
+
+	num_open = 0;
+	for ( ctr = 0; ctr < PERF_NUM_CTRS; ctr++)
+
+		{
+		memset( &attr, 0, sizeof( attr) );
+		attr.size = sizeof( attr);
+		attr.type = CTRS[ ctr ].type;
+		attr.config = CTRS[ ctr ].config;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+				PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		// (this thread, any cpu, no group)
+		perf->fds[ ctr ] = syscall( __NR_perf_event_open, &attr, 0, -1, -1, 0);
+		perf->vals[ ctr ] = 0;
+		if ( perf->fds[ ctr ] >= 0)
+			{
+			num_open++;
+			}  // available?
+
+		}  // try each counter
+
+	return num_open;
+	}  // _________________________________________________________
+
+/** zero and start the open counters */
+void					perf_start
+	(
+	t_perf *			perf			// open counters
+	)
+	{
+	int					ctr;
+
+	for ( ctr = 0; ctr < PERF_NUM_CTRS; ctr++)
+
+		{
+		if ( perf->fds[ ctr ] >= 0)
+			{
+			ioctl( perf->fds[ ctr ], PERF_EVENT_IOC_RESET, 0);
+			ioctl( perf->fds[ ctr ], PERF_EVENT_IOC_ENABLE, 0);
+			}  // open?
+
+		}  // start each counter
+
+	}  // _________________________________________________________
+
+/** stop the open counters, and read them into "vals" */
+void					perf_stop
+	(
+	t_perf *			perf			// open counters
+	)
+	{
+	int					ctr;
+	uint64_t			buf[ 3 ];		// value, time enabled, time running
+
+	for ( ctr = 0; ctr < PERF_NUM_CTRS; ctr++)
+
+		{
+		if ( perf->fds[ ctr ] >= 0)
+			{
+			ioctl( perf->fds[ ctr ], PERF_EVENT_IOC_DISABLE, 0);
+			}  // open?
+
+		}  // stop each counter (before reading any)
+
+	for ( ctr = 0; ctr < PERF_NUM_CTRS; ctr++)
+
+		{
+		perf->vals[ ctr ] = 0;
+		if ( ( perf->fds[ ctr ] < 0) ||
+			 ( read( perf->fds[ ctr ], buf, sizeof( buf) ) != sizeof( buf) ) ||
+			 ( buf[ 2 ] == 0) )
+			{
+			continue;  // === skip ===
+			}  // unavailable, or never scheduled?
+
+		// scale up for the time the counter was multiplexed out
+		perf->vals[ ctr ] = ( (double) buf[ 0 ]) * buf[ 1 ] / buf[ 2 ];
+		}  // read each counter
+
+	}  // _________________________________________________________
+
+/** close the open counters */
+void					perf_close
+	(
+	t_perf *			perf			// open counters
+	)
+	{
+	int					ctr;
+
+	for ( ctr = 0; ctr < PERF_NUM_CTRS; ctr++)
+
+		{
+		if ( perf->fds[ ctr ] >= 0)
+			{
+			close( perf->fds[ ctr ]);
+			perf->fds[ ctr ] = -1;
+			}  // open?
+
+		}  // close each counter
+
+	}  // _________________________________________________________
+
+// vi: ts=4 sw=4 ai
+// *** EOF ***
@@ -0,0 +1,79 @@
+/**
+ * Optional hardware performance counters for the benchmarks
+ *  (via perf_event_open), which quietly report nothing
+ *  when the counters are unavailable (e.g. in a container).
+ *
+ * $Id: $
+ */
+
+#ifndef _BENCH_PERF_H
+#define _BENCH_PERF_H
+
+#include <stdint.h>
+
+/** counters tried (each may be unavailable on its own) */
+typedef enum			e_perf_ctr
+	{
+	PERF_CYCLES,
+	PERF_INSTRUCTIONS,
+	PERF_L1D_MISSES,
+	PERF_LLC_MISSES,
+	PERF_BRANCH_MISSES,
+	PERF_DTLB_MISSES,
+	PERF_PAGE_FAULTS,
+	PERF_NUM_CTRS
+	}					e_perf_ctr;
+
+/** open counters, and the last reading of each */
+typedef struct			t_perf
+	{
+	int					fds[ PERF_NUM_CTRS ];
+										// counter file, -1 if unavailable
+	double				vals[ PERF_NUM_CTRS ];
+										// count between start and stop
+										//  (scaled up if multiplexed)
+	}					t_perf;
+
+/** return the (JSON) name of a counter */
+const
+char *					perf_name
+	(
+	int					ctr				// e_perf_ctr
+	)
+	;
+
+/**
+ * open whichever counters are available for this thread,
+ *  return how many there are.
+ */
+int						perf_open
+	(
+	t_perf *			perf			// counters to be opened
+	)
+	;
+
+/** zero and start the open counters */
+void					perf_start
+	(
+	t_perf *			perf			// open counters
+	)
+	;
+
+/** stop the open counters, and read them into "vals" */
+void					perf_stop
+	(
+	t_perf *			perf			// open counters
+	)
+	;
+
+/** close the open counters */
+void					perf_close
+	(
+	t_perf *			perf			// open counters
+	)
+	;
+
+#endif  // _BENCH_PERF_H
+
+// vi: ts=4 sw=4 ai
+// *** EOF ***
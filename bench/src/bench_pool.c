@@ -0,0 +1,184 @@
+/**
+ * Benchmark:  short tasks on worker threads, each on its own stack,
+ *  created and destroyed per task (before) vs. taken from a stack pool.
+ */
+/*
+    buzzard:  blaze runtime (so far, just a simple memory management library)
+
+    Copyright (C) 2010, Robin R Anderson
+    roboprog@yahoo.com
+    PO 1608
+    Shingle Springs, CA 95682
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "bzrt_alloc.h"
+#include "bzrt_pool.h"
+
+/** frames per task */
+#define NUM_TASK_FRAMES	64
+
+/** parameters for a worker thread */
+typedef struct			t_worker
+	{
+	t_stack_pool *		pool;			// pool, null to cons / dest
+	long				num_tasks;		// tasks to run
+	}					t_worker;
+
+/** return a monotonic time stamp, in seconds */
+static
+double					now_sec( void)
+	{
+	struct timespec		ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ( ts.tv_nsec / 1e9);
+	}  // _________________________________________________________
+
+/** run the tasks of one worker */
+static
+void *					run_worker
+	(
+	void *				arg				// t_worker
+	)
+	{
+	t_worker *			worker;
+	t_stack *			stack;
+	long				task;
+	int					idx;
+
+	worker = (t_worker *) arg;
+	for ( task = 0; task < worker->num_tasks; task++)
+
+		{
+		stack = ( worker->pool != NULL) ?
+				bza_pool_get( NULL, worker->pool) :
+				bza_cons_stack( NULL);
+		for ( idx = 0; idx < NUM_TASK_FRAMES; idx++)
+
+			{
+			bza_cons_stk_frame( NULL, &stack, 16 + ( idx * 8) );
+			}  // allocate each frame
+
+		if ( worker->pool != NULL)
+			{
+			bza_pool_put( NULL, worker->pool, &stack);
+			}  // pooled?
+		else
+			{
+			bza_dest_stack( NULL, &stack);
+			}  // throw away
+
+		}  // run each task
+
+	return NULL;
+	}  // _________________________________________________________
+
+/** run "num_threads" workers, report */
+static
+void					run_case
+	(
+	const
+	char *				name,			// display name
+	int					use_pool,		// true to use a stack pool
+	int					num_threads,	// number of worker threads
+	long				num_tasks		// tasks per thread
+	)
+	{
+	t_pool_opts			opts;
+	t_stack_pool *		pool;
+	t_worker			worker;
+	pthread_t *			threads;
+	int					idx;
+	double				start;
+	double				elapsed;
+
+	pool = NULL;
+	if ( use_pool)
+		{
+		memset( &opts, 0, sizeof( opts) );
+		opts.stack_opts.initial_size = 32 * 1024;
+		pool = bza_cons_pool( NULL, &opts);
+		}  // pooled?
+
+	worker.pool = pool;
+	worker.num_tasks = num_tasks;
+	threads = malloc( num_threads * sizeof( pthread_t) );
+
+	start = now_sec();
+	for ( idx = 0; idx < num_threads; idx++)
+
+		{
+		pthread_create( &( threads[ idx ]), NULL, run_worker, &worker);
+		}  // start each worker
+
+	for ( idx = 0; idx < num_threads; idx++)
+
+		{
+		pthread_join( threads[ idx ], NULL);
+		}  // wait for each worker
+
+	elapsed = now_sec() - start;
+
+	printf( "%-12s %3d threads %8.3f s %10.3f Mtasks/s",
+			name, num_threads, elapsed,
+			( ( num_threads * num_tasks) / elapsed) / 1e6);
+	if ( pool != NULL)
+		{
+		printf( "  (%lu stacks created)", (unsigned long) pool->num_created);
+		bza_dest_pool( NULL, &pool);
+		}  // pooled?
+
+	printf( "\n");
+	free( threads);
+	}  // _________________________________________________________
+
+/**
+ * Run per task stacks vs. pooled stacks, at 1 .. "max_threads" threads.
+ *  usage:  bench_pool [num_tasks [max_threads]]
+ */
+int						main
+	(
+	int					argc,
+	char *				argv []
+	)
+	{
+	long				num_tasks;
+	int					max_threads;
+	int					num_threads;
+
+	num_tasks = ( argc > 1) ? atol( argv[ 1 ]) : 200000;
+	max_threads = ( argc > 2) ? atoi( argv[ 2 ]) : 4;
+	printf( "%ld tasks per thread, %d frames per task\n",
+			num_tasks, NUM_TASK_FRAMES);
+
+	for ( num_threads = 1; num_threads <= max_threads; num_threads *= 2)
+
+		{
+		run_case( "cons/dest", 0, num_threads, num_tasks);
+		run_case( "pool", 1, num_threads, num_tasks);
+		}  // measure each thread count
+
+	return 0;
+	}  // _________________________________________________________
+
+// vi: ts=4 sw=4 ai
+// *** EOF ***
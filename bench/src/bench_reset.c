@@ -0,0 +1,164 @@
+/**
+ * Benchmark per-request stack handling:
+ *  construct + destroy a stack for each request,
+ *  vs. reset of a long lived stack, vs. rollback to a checkpoint.
+ */
+/*
+    buzzard:  blaze runtime (so far, just a simple memory management library)
+
+    Copyright (C) 2010, Robin R Anderson
+    roboprog@yahoo.com
+    PO 1608
+    Shingle Springs, CA 95682
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "bzrt_alloc.h"
+
+/** frames per request */
+#define NUM_FRAMES		64
+
+/** how a request's stack is set up and torn down */
+typedef enum			t_mode
+	{
+	MODE_TEARDOWN,						// bza_cons_stack / bza_dest_stack
+	MODE_RESET,							// bza_reset_stack
+	MODE_RELEASE						// bza_mark / bza_release_to
+	}					t_mode;
+
+/** return a monotonic time stamp, in seconds */
+static
+double					now_sec( void)
+	{
+	struct timespec		ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ( ts.tv_nsec / 1e9);
+	}  // _________________________________________________________
+
+/** do the "work" of one request:  allocate (and leak) some frames */
+static
+void					do_request
+	(
+	t_stack * *			stack,			// stack for the request
+	unsigned int *		seed			// random number state
+	)
+	{
+	int					idx;
+	size_t				frame;
+
+	for ( idx = 0; idx < NUM_FRAMES; idx++)
+
+		{
+		frame = bza_cons_stk_frame( NULL, stack, 16 + ( rand_r( seed) % 1008) );
+		// touch the last payload byte (just under the marker)
+		( *stack)->data[ frame - 1 ] = 'R';
+		}  // allocate each frame
+
+	}  // _________________________________________________________
+
+/** simulate "num_reqs" requests, report */
+static
+void					run_case
+	(
+	const
+	char *				name,			// display name
+	t_mode				mode,			// how to clean up after each request
+	long				num_reqs		// number of requests to simulate
+	)
+	{
+	t_stack *			stack;
+	size_t				mark;
+	unsigned int		seed;
+	long				req;
+	double				start;
+	double				elapsed;
+
+	seed = 12345;
+	stack = NULL;
+	start = now_sec();
+	for ( req = 0; req < num_reqs; req++)
+
+		{
+		switch ( mode)
+			{
+			case MODE_TEARDOWN :
+					stack = bza_cons_stack( NULL);
+					do_request( &stack, &seed);
+					bza_dest_stack( NULL, &stack);
+				break;
+			case MODE_RESET :
+					if ( stack == NULL)
+						{
+						stack = bza_cons_stack( NULL);
+						}  // first request?
+
+					do_request( &stack, &seed);
+					bza_reset_stack( NULL, stack);
+				break;
+			case MODE_RELEASE :
+					if ( stack == NULL)
+						{
+						stack = bza_cons_stack( NULL);
+						bza_cons_stk_frame( NULL, &stack, 64);  // "session"
+						}  // first request?
+
+					mark = bza_mark( NULL, stack);
+					do_request( &stack, &seed);
+					bza_release_to( NULL, stack, mark);
+				break;
+			}  // which clean up?
+
+		}  // simulate each request
+
+	elapsed = now_sec() - start;
+	if ( stack != NULL)
+		{
+		bza_dest_stack( NULL, &stack);
+		}  // long lived stack?
+
+	printf( "%-20s %8.3f s  %10.1f ns/request\n",
+			name, elapsed, ( elapsed / num_reqs) * 1e9);
+	}  // _________________________________________________________
+
+/**
+ * Run each clean up strategy.
+ *  usage:  bench_reset [num_requests]
+ */
+int						main
+	(
+	int					argc,
+	char *				argv []
+	)
+	{
+	long				num_reqs;
+
+	num_reqs = ( argc > 1) ? atol( argv[ 1 ]) : 100000;
+	printf( "%ld requests, %d frames each\n", num_reqs, NUM_FRAMES);
+
+	run_case( "teardown (before)", MODE_TEARDOWN, num_reqs);
+	run_case( "reset", MODE_RESET, num_reqs);
+	run_case( "mark / release", MODE_RELEASE, num_reqs);
+
+	return 0;
+	}  // _________________________________________________________
+
+// vi: ts=4 sw=4 ai
+// *** EOF ***
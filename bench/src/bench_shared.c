@@ -0,0 +1,199 @@
+/**
+ * Benchmark:  threads sharing one stack (BZA_OPT_SHARED):
+ *  concurrent readers (reference, read, de-reference a common frame),
+ *  and concurrent writers (create and drop frames of their own).
+ */
+/*
+    buzzard:  blaze runtime (so far, just a simple memory management library)
+
+    Copyright (C) 2010, Robin R Anderson
+    roboprog@yahoo.com
+    PO 1608
+    Shingle Springs, CA 95682
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "bzrt_alloc.h"
+
+/** bytes read from the common frame, per reference */
+#define READ_SZ			64
+
+/** parameters for a worker thread */
+typedef struct			t_worker
+	{
+	t_stack *			stack;			// the shared stack
+	size_t				frame;			// common frame (readers)
+	long				num_ops;		// operations to run
+	long				sum;			// (keeps the reads live)
+	}					t_worker;
+
+/** return a monotonic time stamp, in seconds */
+static
+double					now_sec( void)
+	{
+	struct timespec		ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ( ts.tv_nsec / 1e9);
+	}  // _________________________________________________________
+
+/** reader:  reference, read, de-reference the common frame */
+static
+void *					run_reader
+	(
+	void *				arg				// t_worker
+	)
+	{
+	t_worker *			worker;
+	const
+	char *				data;
+	long				op;
+	int					idx;
+
+	worker = (t_worker *) arg;
+	for ( op = 0; op < worker->num_ops; op++)
+
+		{
+		bza_ref_stk_frame( NULL, worker->stack, worker->frame);
+		data = bza_get_frame_ptr( NULL, worker->stack, worker->frame);
+		for ( idx = 0; idx < READ_SZ; idx++)
+
+			{
+			worker->sum += data[ idx ];
+			}  // read each byte
+
+		bza_deref_stk_frame( NULL, worker->stack, worker->frame);
+		}  // each operation
+
+	return NULL;
+	}  // _________________________________________________________
+
+/** writer:  create a frame, drop it */
+static
+void *					run_writer
+	(
+	void *				arg				// t_worker
+	)
+	{
+	t_worker *			worker;
+	long				op;
+	size_t				frame;
+
+	worker = (t_worker *) arg;
+	for ( op = 0; op < worker->num_ops; op++)
+
+		{
+		frame = bza_cons_stk_frame( NULL, &( worker->stack), 16 + ( op & 63) );
+		bza_deref_stk_frame( NULL, worker->stack, frame);
+		}  // each operation
+
+	return NULL;
+	}  // _________________________________________________________
+
+/** run "num_threads" workers on one stack, report */
+static
+void					run_case
+	(
+	const
+	char *				name,			// display name
+	void *				( *body)( void *),	// worker body
+	int					flags,			// BZA_OPT_* option bits
+	int					num_threads,	// number of worker threads
+	long				num_ops			// operations per thread
+	)
+	{
+	t_stack_opts		opts;
+	t_stack *			stack;
+	t_worker *			workers;
+	pthread_t *			threads;
+	size_t				frame;
+	int					idx;
+	double				start;
+	double				elapsed;
+
+	memset( &opts, 0, sizeof( opts) );
+	opts.vm_reserve = ( 1 << 28);
+	opts.flags = flags;
+	stack = bza_cons_stack_opts( NULL, &opts);
+	frame = bza_cons_stk_frame( NULL, &stack, READ_SZ);
+	memset( bza_get_frame_ptr( NULL, stack, frame), 1, READ_SZ);
+
+	workers = calloc( num_threads, sizeof( t_worker) );
+	threads = malloc( num_threads * sizeof( pthread_t) );
+	start = now_sec();
+	for ( idx = 0; idx < num_threads; idx++)
+
+		{
+		workers[ idx ].stack = stack;
+		workers[ idx ].frame = frame;
+		workers[ idx ].num_ops = num_ops;
+		pthread_create( &( threads[ idx ]), NULL, body, &( workers[ idx ]) );
+		}  // start each worker
+
+	for ( idx = 0; idx < num_threads; idx++)
+
+		{
+		pthread_join( threads[ idx ], NULL);
+		}  // wait for each worker
+
+	elapsed = now_sec() - start;
+
+	printf( "%-18s %3d threads %8.3f s %10.2f Mops/s\n",
+			name, num_threads, elapsed,
+			( ( num_threads * num_ops) / elapsed) / 1e6);
+	bza_dest_stack( NULL, &stack);
+	free( threads);
+	free( workers);
+	}  // _________________________________________________________
+
+/**
+ * Run readers and writers at 1 .. "max_threads" threads
+ *  (plus the unshared, single thread cost, for comparison).
+ *  usage:  bench_shared [num_ops [max_threads]]
+ */
+int						main
+	(
+	int					argc,
+	char *				argv []
+	)
+	{
+	long				num_ops;
+	int					max_threads;
+	int					num_threads;
+
+	num_ops = ( argc > 1) ? atol( argv[ 1 ]) : 2000000;
+	max_threads = ( argc > 2) ? atoi( argv[ 2 ]) : 8;
+	printf( "%ld operations per thread\n", num_ops);
+
+	run_case( "readers, unshared", run_reader, 0, 1, num_ops);
+	run_case( "writers, unshared", run_writer, 0, 1, num_ops);
+	for ( num_threads = 1; num_threads <= max_threads; num_threads *= 2)
+
+		{
+		run_case( "readers", run_reader, BZA_OPT_SHARED, num_threads, num_ops);
+		run_case( "writers", run_writer, BZA_OPT_SHARED, num_threads, num_ops);
+		}  // measure each thread count
+
+	return 0;
+	}  // _________________________________________________________
+
+// vi: ts=4 sw=4 ai
+// *** EOF ***
@@ -0,0 +1,128 @@
+/**
+ * Benchmark slab sub-allocation:  a churn of small byte arrays
+ *  (most not freed in stack order) with and without BZA_OPT_SLAB.
+ */
+/*
+    buzzard:  blaze runtime (so far, just a simple memory management library)
+
+    Copyright (C) 2010, Robin R Anderson
+    roboprog@yahoo.com
+    PO 1608
+    Shingle Springs, CA 95682
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "bzrt_alloc.h"
+#include "bzrt_bytes.h"
+
+/** live byte arrays at any one time */
+#define NUM_LIVE		4096
+
+/** return a monotonic time stamp, in seconds */
+static
+double					now_sec( void)
+	{
+	struct timespec		ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ( ts.tv_nsec / 1e9);
+	}  // _________________________________________________________
+
+/** replace a random live array "num_ops" times on a fresh stack, report */
+static
+void					run_case
+	(
+	const
+	char *				name,			// display name
+	int					flags,			// BZA_OPT_* bits for the stack
+	long				num_ops			// number of replacements
+	)
+	{
+	static
+	const
+	char				CHARS[] = "abcdefghijklmnopqrstuvwxyz0123456789"
+			"ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789abcdefghijklmnopqrstuvwxyz";
+
+	t_stack_opts		opts;
+	t_stack *			stack;
+	size_t				live[ NUM_LIVE ];
+	unsigned int		seed;
+	long				op;
+	int					idx;
+	double				start;
+	double				elapsed;
+
+	memset( &opts, 0, sizeof( opts) );
+	opts.flags = flags;
+	seed = 12345;
+
+	start = now_sec();
+	stack = bza_cons_stack_opts( NULL, &opts);
+	for ( idx = 0; idx < NUM_LIVE; idx++)
+
+		{
+		live[ idx ] = bzb_from_fixed_mem( NULL, &stack, CHARS,
+				rand_r( &seed) % 100);
+		}  // fill the working set
+
+	for ( op = 0; op < num_ops; op++)
+
+		{
+		idx = rand_r( &seed) % NUM_LIVE;
+		bzb_deref( NULL, stack, live[ idx ]);
+		live[ idx ] = bzb_from_fixed_mem( NULL, &stack, CHARS,
+				rand_r( &seed) % 100);
+		}  // replace a random one
+
+	elapsed = now_sec() - start;
+
+	printf( "%-12s top %12ld  stranded %12ld  %8.3f s  %8.2f Mops/s\n",
+			name,
+			(long) stack->top,
+			(long) bza_get_stranded_bytes( NULL, stack),
+			elapsed,
+			( num_ops / elapsed) / 1e6);
+	bza_dest_stack( NULL, &stack);
+	}  // _________________________________________________________
+
+/**
+ * Run with and without slabs.
+ *  usage:  bench_slab [num_ops]
+ */
+int						main
+	(
+	int					argc,
+	char *				argv []
+	)
+	{
+	long				num_ops;
+
+	num_ops = ( argc > 1) ? atol( argv[ 1 ]) : 1000000;
+	printf( "%ld replacements, %d live byte arrays of 0..99 bytes\n",
+			num_ops, NUM_LIVE);
+
+	run_case( "frames", 0, num_ops);
+	run_case( "slabs", BZA_OPT_SLAB, num_ops);
+
+	return 0;
+	}  // _________________________________________________________
+
+// vi: ts=4 sw=4 ai
+// *** EOF ***
@@ -0,0 +1,178 @@
+/**
+ * Benchmark table inserts, with the key and value arrays of each
+ *  new leaf made in one batch, or one frame at a time.
+ */
+/*
+    buzzard:  blaze runtime (so far, just a simple memory management library)
+
+    Copyright (C) 2010, Robin R Anderson
+    roboprog@yahoo.com
+    PO 1608
+    Shingle Springs, CA 95682
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "bzrt_alloc.h"
+#include "bzrt_table.h"
+
+/** return a monotonic time stamp, in seconds */
+static
+double					now_sec( void)
+	{
+	struct timespec		ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ( ts.tv_nsec / 1e9);
+	}  // _________________________________________________________
+
+/** insert "num_keys" keys into a fresh table, report */
+static
+void					run_case
+	(
+	const
+	char *				name,			// display name
+	int					flags,			// BZA_OPT_* bits for the stack
+	long				num_keys		// number of keys to insert
+	)
+	{
+	t_stack_opts		opts;
+	t_stack *			stack;
+	size_t				table;
+	char				key[ 32 ];
+	unsigned int		seed;
+	long				idx;
+	double				start;
+	double				elapsed;
+
+	memset( &opts, 0, sizeof( opts) );
+	opts.flags = flags;
+	seed = 12345;
+
+	start = now_sec();
+	stack = bza_cons_stack_opts( NULL, &opts);
+	table = bzt_init( NULL, &stack);
+	for ( idx = 0; idx < num_keys; idx++)
+
+		{
+		sprintf( key, "%08x%08x", rand_r( &seed), (unsigned int) idx);
+		bzt_put( NULL, &stack, table, key, 16, key, 16);
+		}  // insert each key
+
+	elapsed = now_sec() - start;
+
+	printf( "%-10s top %12ld  holes %8ld  grows %6ld  %8.3f s  %8.2f Kput/s\n",
+			name,
+			(long) stack->top,
+			(long) stack->num_holes,
+			(long) stack->num_grows,
+			elapsed,
+			( num_keys / elapsed) / 1e3);
+	bzt_deref( NULL, stack, table);
+	bza_dest_stack( NULL, &stack);
+	}  // _________________________________________________________
+
+/**
+ * promote a table of "num_keys" keys out of a scratch stack:
+ *  by re-inserting each key (before), then by bzt_transfer, report.
+ */
+static
+void					run_transfer
+	(
+	long				num_keys		// number of keys in table
+	)
+	{
+	t_stack *			scratch;
+	t_stack *			stack;
+	size_t				table;
+	size_t				copy;
+	char				key[ 32 ];
+	unsigned int		seed;
+	long				idx;
+	double				start;
+	double				rebuild;
+	double				transfer;
+
+	seed = 12345;
+	scratch = bza_cons_stack( NULL);
+	table = bzt_init( NULL, &scratch);
+	for ( idx = 0; idx < num_keys; idx++)
+
+		{
+		sprintf( key, "%08x%08x", rand_r( &seed), (unsigned int) idx);
+		bzt_put( NULL, &scratch, table, key, 16, key, 16);
+		}  // insert each key
+
+	seed = 12345;
+	start = now_sec();
+	stack = bza_cons_stack( NULL);
+	copy = bzt_init( NULL, &stack);
+	for ( idx = 0; idx < num_keys; idx++)
+
+		{
+		sprintf( key, "%08x%08x", rand_r( &seed), (unsigned int) idx);
+		bzt_put( NULL, &stack, copy, key, 16, key, 16);
+		}  // re-insert each key
+
+	rebuild = now_sec() - start;
+	bza_dest_stack( NULL, &stack);
+
+	start = now_sec();
+	stack = bza_cons_stack( NULL);
+	copy = bzt_transfer( NULL, scratch, &stack, table);
+	transfer = now_sec() - start;
+
+	printf( "promote:  rebuild %8.3f s  transfer %8.3f s  (%.1fx)\n",
+			rebuild, transfer, rebuild / transfer);
+	bzt_deref( NULL, stack, copy);
+	bza_dest_stack( NULL, &stack);
+	bza_dest_stack( NULL, &scratch);
+	}  // _________________________________________________________
+
+/**
+ * Run with and without batch allocation (also with no hole reuse),
+ *  then promotion.
+ *  usage:  bench_table [num_keys]
+ */
+int						main
+	(
+	int					argc,
+	char *				argv []
+	)
+	{
+	long				num_keys;
+
+	num_keys = ( argc > 1) ? atol( argv[ 1 ]) : 20000;
+	printf( "%ld random 16 byte keys\n", num_keys);
+
+	run_case( "one by one", BZA_OPT_NO_BATCH, num_keys);
+	run_case( "batched", 0, num_keys);
+	run_case( "one by one", BZA_OPT_NO_BATCH, num_keys);
+	run_case( "batched", 0, num_keys);
+
+	// without hole reuse, so the trie cost shows apart from the hole scan
+	run_case( "1by1 nohr", BZA_OPT_NO_BATCH | BZA_OPT_NO_HOLE_REUSE, num_keys);
+	run_case( "batch nohr", BZA_OPT_NO_HOLE_REUSE, num_keys);
+	run_transfer( num_keys);
+
+	return 0;
+	}  // _________________________________________________________
+
+// vi: ts=4 sw=4 ai
+// *** EOF ***
@@ -0,0 +1,121 @@
+/**
+ * Benchmark the cost of allocator event tracing:
+ *  a churn of small frames (cons, ref, deref, deref)
+ *  with tracing off and on.
+ */
+/*
+    buzzard:  blaze runtime (so far, just a simple memory management library)
+
+    Copyright (C) 2010, Robin R Anderson
+    roboprog@yahoo.com
+    PO 1608
+    Shingle Springs, CA 95682
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "bzrt_alloc.h"
+
+/** events recorded per round */
+#define EVS_PER_ROUND	4
+
+/** return a monotonic time stamp, in seconds */
+static
+double					now_sec( void)
+	{
+	struct timespec		ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ( ts.tv_nsec / 1e9);
+	}  // _________________________________________________________
+
+/** run "num_rounds" rounds on a fresh stack, return elapsed seconds */
+static
+double					run_case
+	(
+	const
+	char *				name,			// display name
+	size_t				ring_sz,		// trace ring size, 0 for no tracing
+	long				num_rounds		// number of cons/ref/deref rounds
+	)
+	{
+	t_stack *			stack;
+	size_t				base;
+	size_t				frame;
+	long				round;
+	double				start;
+	double				elapsed;
+
+	stack = bza_cons_stack( NULL);
+	if ( ring_sz > 0)
+		{
+		bza_trace_on( NULL, stack, ring_sz);
+		}  // traced?
+
+	// (keep one frame underneath, so the churn isn't just "top" moving)
+	base = bza_cons_stk_frame( NULL, &stack, 64);
+
+	start = now_sec();
+	for ( round = 0; round < num_rounds; round++)
+
+		{
+		frame = bza_cons_stk_frame( NULL, &stack, ( round & 63) + 1);
+		bza_ref_stk_frame( NULL, stack, frame);
+		bza_deref_stk_frame( NULL, stack, frame);
+		bza_deref_stk_frame( NULL, stack, frame);
+		}  // churn one frame
+
+	elapsed = now_sec() - start;
+
+	printf( "%-10s %8.3f s  %8.2f ns / op\n",
+			name, elapsed, ( elapsed * 1e9) / ( num_rounds * EVS_PER_ROUND) );
+	bza_deref_stk_frame( NULL, stack, base);
+	bza_dest_stack( NULL, &stack);
+	return elapsed;
+	}  // _________________________________________________________
+
+/**
+ * Run with and without tracing.
+ *  usage:  bench_trace [num_rounds]
+ */
+int						main
+	(
+	int					argc,
+	char *				argv []
+	)
+	{
+	long				num_rounds;
+	double				plain;
+	double				traced;
+
+	num_rounds = ( argc > 1) ? atol( argv[ 1 ]) : 10000000;
+	printf( "%ld rounds of cons, ref, deref, deref\n", num_rounds);
+
+	plain = run_case( "untraced", 0, num_rounds);
+	traced = run_case( "traced", 1 << 16, num_rounds);
+	plain = run_case( "untraced", 0, num_rounds);
+	traced = run_case( "traced", 1 << 16, num_rounds);
+	printf( "tracing costs %.2f ns / event\n",
+			( ( traced - plain) * 1e9) / ( num_rounds * EVS_PER_ROUND) );
+
+	return 0;
+	}  // _________________________________________________________
+
+// vi: ts=4 sw=4 ai
+// *** EOF ***
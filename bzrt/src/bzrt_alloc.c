@@ -14,6 +14,17 @@
  * (LOW)
  *  stack houskeeping fields
  *
+ * Frames are contiguous:  each payload starts just above the previous marker.
+ * A dead frame beneath a live one (a "hole") stays in place,
+ * merged with any adjacent hole.
+ * The holes are kept in lists by size (log2 buckets), linked both ways
+ * through the last two words of each hole's payload,
+ * and are handed out again (close fit) by later allocations.
+ * Low bits of each marker's size say whether the frame is a hole,
+ * and whether the frame just above it is one (and a minimum size one);
+ * a hole's first word is its own marker offset, so a frame which dies
+ * next to a hole finds it (either way) without a search.
+ *
  * $Id: $
  */
 /*
@@ -29,385 +40,4323 @@
     the Free Software Foundation, either version 3 of the License, or
     (at your option) any later version.
 
-    This program is distributed in the hope that it will be useful,
-    but WITHOUT ANY WARRANTY; without even the implied warranty of
-    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
-    GNU General Public License for more details.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE		// (mremap)
+
+#include <malloc.h>
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "bzrt_alloc.h"
+
+// #define DO_LOG	1
+#include "_log.h"
+
+/** smallest size to which a growth policy will expand a stack */
+#define BZA_MIN_GROW	256
+
+/** default chunk size for bza_grow_chunk */
+#define BZA_DEF_CHUNK	( 64 * 1024)
+
+/** size (and alignment) of a huge page (see BZA_OPT_HUGE) */
+#define BZA_HUGE_PAGE	( 2 * 1024 * 1024)
+
+/** smallest size to which automatic trimming will cut a stack */
+#define BZA_TRIM_MIN	( 64 * 1024)
+
+/** the "real time" option bits (any of which make a plain stack "mapped") */
+#define BZA_OPT_RT_MASK	( BZA_OPT_PREFAULT | BZA_OPT_LOCK | BZA_OPT_HUGE)
+
+/** /proc/self/pagemap entry bits (see cow_write_back) */
+#define BZA_PM_PRESENT	( ( (uint64_t) 1) << 63)
+#define BZA_PM_SWAPPED	( ( (uint64_t) 1) << 62)
+#define BZA_PM_FILE		( ( (uint64_t) 1) << 61)
+
+/** smallest frame payload:  room for a dead frame's own marker offset */
+#define BZA_MIN_FRAME	sizeof( size_t)
+
+/**
+ * smallest hole with room for its own marker offset and two links
+ *  (a BZA_MIN_FRAME one packs two short links instead, see bza_get_hole_link)
+ */
+#define BZA_MIN_HOLE	( 3 * sizeof( size_t) )
+
+/** marker size bit (see BZA_SIZE_FLAGS):  the frame is a hole */
+#define BZA_IS_HOLE		( (size_t) 1)
+
+/** marker size bit:  the frame just above this one is a hole */
+#define BZA_HOLE_ABOVE	( (size_t) 2)
+
+/** marker size bit:  the frame just above is a BZA_MIN_FRAME hole instead */
+#define BZA_TINY_ABOVE	( (size_t) 4)
+
+/** marker size bits about the frame just above */
+#define BZA_ABOVE_BITS	( BZA_HOLE_ABOVE | BZA_TINY_ABOVE)
+
+/** alignment of every frame payload (malloc's, good for SIMD/atomics) */
+#define BZA_ALIGN		16
+
+/** payload size of the smallest slab size class (each class doubles) */
+#define BZA_SLAB_MIN	( (size_t) 16)
+
+/** payload size of a slab frame */
+#define BZA_SLAB_BYTES	( 4096 - 64)
+
+/** round up to a multiple of a power of 2 */
+#define BZA_ROUND_UP( n, p2)	( ( (n) + ( (p2) - 1) ) & ~( (size_t) ( (p2) - 1) ) )
+
+/** return the size of a frame marker (overhead per frame) in the stack */
+static  // inline?
+size_t					bza_hdr_sz
+	(
+	t_stack *			stack			// a stack to be accessed,
+										//  not null!
+	)
+	{
+	return ( stack->flags & BZA_OPT_COMPACT_HDR) ?
+			sizeof( t_compact_marker) : sizeof( t_frame_marker);
+	}  // _________________________________________________________
+
+/** return the largest frame size a marker in the stack can record */
+static  // inline?
+size_t					bza_max_frame
+	(
+	t_stack *			stack			// a stack to be accessed,
+										//  not null!
+	)
+	{
+	return ( stack->flags & BZA_OPT_COMPACT_HDR) ?
+			UINT32_MAX : SIZE_MAX;
+	}  // _________________________________________________________
+
+/** return offset of marker structure for top frame */
+static  // inline?
+size_t					bza_get_top_frame_marker_offset
+	(
+	t_stack *			stack			// a stack to be accessed,
+										//  not null!
+	)
+	{
+	// the frame marker is just underneathh the stack top, unless empty
+	return ( stack->top > bza_hdr_sz( stack) ) ?
+			( stack->top - bza_hdr_sz( stack) ) : 0;
+	}  // _________________________________________________________
+
+/** return true if both offsets are in the same segment (or not segmented) */
+static  // inline?
+int						bza_same_seg
+	(
+	t_stack *			stack,			// a stack to be accessed,
+										//  not null!
+	size_t				off1,			// an offset into the stack's data
+	size_t				off2			// another offset into the stack's data
+	)
+	{
+	return ( stack->seg_shift == 0) ||
+			( ( off1 >> stack->seg_shift) == ( off2 >> stack->seg_shift) );
+	}  // _________________________________________________________
+
+/** return the marker offset of the frame below the indicated one (or 0) */
+static  // inline?
+size_t					bza_frame_prev
+	(
+	t_stack *			stack,			// a stack to be accessed,
+										//  not null!
+	size_t				marker_off		// offset to desired frame marker
+	)
+	{
+	size_t				start;
+
+	if ( stack->flags & BZA_OPT_COMPACT_HDR)
+		{
+		start = marker_off - bza_frame_size( stack, marker_off);
+		return ( start > 0) ? ( start - sizeof( t_compact_marker) ) : 0;
+		}  // derived?
+
+	return bza_get_frame_marker( stack, marker_off)->prev_off;
+	}  // _________________________________________________________
+
+/**
+ * fill in the marker of the indicated frame
+ *  ("prev_off" must be the frame just below the payload;
+ *  the compact form does not record it).
+ */
+static  // inline?
+void					bza_set_frame
+	(
+	t_stack *			stack,			// a stack to be updated,
+										//  not null!
+	size_t				marker_off,		// offset to desired frame marker
+	size_t				size,			// payload size
+	int					ref_cnt,		// reference count
+	size_t				prev_off		// marker offset of frame below
+	)
+	{
+	t_frame_marker *	marker;
+	t_compact_marker *	short_marker;
+
+	// (this also clears the hole bookkeeping bits)
+	assert( ( size & BZA_SIZE_FLAGS) == 0);
+	if ( stack->flags & BZA_OPT_COMPACT_HDR)
+		{
+		assert( size <= UINT32_MAX);
+		short_marker = (t_compact_marker *) bza_addr( stack, marker_off);
+		short_marker->size = (uint32_t) size;
+		short_marker->ref_cnt = ref_cnt;
+		return;  // === done ===
+		}  // short form?
+
+	marker = bza_get_frame_marker( stack, marker_off);
+	marker->size = size;
+	marker->ref_cnt = ref_cnt;
+	marker->prev_off = prev_off;
+	}  // _________________________________________________________
+
+/** return the statistics bucket for a payload size */
+static  // inline?
+int						bza_stat_bucket
+	(
+	size_t				frame_sz		// size of frame, excluding overhead
+	)
+	{
+	int					bucket;
+
+	for ( bucket = 0; bucket < ( BZA_STAT_BUCKETS - 1); bucket++)
+
+		{
+		if ( frame_sz <= ( ( (size_t) 16) << bucket) )
+			{
+			break;  // === found ===
+			}  // fits?
+
+		}  // check each bucket
+
+	return bucket;
+	}  // _________________________________________________________
+
+/** count a frame coming to life (or dying) in the live statistics */
+static  // inline?
+void					bza_tally_frame
+	(
+	t_stack *			stack,			// a stack to be updated,
+										//  not null!
+	size_t				frame_sz,		// size of frame, excluding overhead
+	int					is_live			// true if born, false if died
+	)
+	{
+	int					bucket;
+
+	bucket = bza_stat_bucket( frame_sz);
+	if ( is_live)
+		{
+		stack->live_frames++;
+		stack->live_bytes += frame_sz;
+		stack->size_hist[ bucket ]++;
+		}  // born?
+	else
+		{
+		stack->live_frames--;
+		stack->live_bytes -= frame_sz;
+		stack->size_hist[ bucket ]--;
+		}  // died
+
+	}  // _________________________________________________________
+
+/** forget the checkpoints which the top of stack has dropped below */
+static inline
+void					bza_drop_marks
+	(
+	t_stack *			stack			// a stack whose top has dropped,
+										//  not null!
+	)
+	{
+	while ( ( stack->num_marks > 0) &&
+			( stack->marks[ stack->num_marks - 1 ] > stack->top) )
+
+		{
+		stack->num_marks--;
+		}  // pop each stale checkpoint
+
+	}  // _________________________________________________________
+
+/** note a new top of stack in the statistics */
+static  // inline?
+void					bza_set_top
+	(
+	t_stack *			stack,			// a stack to be updated,
+										//  not null!
+	size_t				top				// new offset to next available space
+	)
+	{
+	stack->top = top;
+	if ( top > stack->high_water)
+		{
+		stack->high_water = top;
+		}  // new "high water" mark?
+
+	}  // _________________________________________________________
+
+/** the stack whose lock this thread holds (see BZA_OPT_SHARED), if any */
+static
+__thread
+t_stack *				bza_held;
+
+/**
+ * take the lock of a shared stack, unless this thread already has it.
+ *  Return true if taken (to be given back by bza_unlock).
+ */
+static  // inline?
+int						bza_lock
+	(
+	t_stack *			stack			// a stack to be locked,
+										//  not null!
+	)
+	{
+	if ( ( ! ( stack->flags & BZA_OPT_SHARED) ) || ( bza_held == stack) )
+		{
+		return 0;  // === done ===
+		}  // not shared, or nested call?
+
+	while ( __atomic_exchange_n( &( stack->lock), 1, __ATOMIC_ACQUIRE) )
+
+		{
+		while ( __atomic_load_n( &( stack->lock), __ATOMIC_RELAXED) )
+
+			{
+			sched_yield();
+			}  // wait until it looks free
+
+		}  // try until taken
+
+	bza_held = stack;
+	return 1;
+	}  // _________________________________________________________
+
+/** give back a lock from bza_lock */
+static  // inline?
+void					bza_unlock
+	(
+	t_stack *			stack,			// a stack which was locked,
+										//  not null!
+	int					taken			// result of bza_lock
+	)
+	{
+	if ( taken)
+		{
+		bza_held = NULL;
+		__atomic_store_n( &( stack->lock), 0, __ATOMIC_RELEASE);
+		}  // really locked?
+
+	}  // _________________________________________________________
+
+/** return the clock (monotonic), in nanoseconds */
+static
+uint64_t				bza_nsec( void)
+	{
+	struct timespec		ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts);
+	return ( ( (uint64_t) ts.tv_sec) * 1000000000) + ts.tv_nsec;
+	}  // _________________________________________________________
+
+/** return a time stamp for a traced event (cheap, if not portable) */
+static  // inline?
+uint64_t				bza_ticks( void)
+	{
+#if defined( __x86_64__) || defined( __i386__)
+	return __builtin_ia32_rdtsc();
+#else
+	return bza_nsec();
+#endif  // time stamp counter?
+	}  // _________________________________________________________
+
+/** record an event in a traced stack's ring buffer */
+static  // inline?
+void					bza_trace_ev
+	(
+	t_trace *			trace,			// event ring, not null!
+	int					op,				// e_trace_op
+	size_t				off,			// frame offset (or as per op)
+	size_t				size			// size, count (or as per op)
+	)
+	{
+	uint64_t			head;
+	t_trace_ev *		ev;
+
+	head = trace->head;
+	ev = &( trace->evs[ head & trace->mask ]);
+	ev->ticks = bza_ticks();
+	ev->off = off;
+	ev->size = ( size > UINT32_MAX) ? UINT32_MAX : (uint32_t) size;
+	ev->op = op;
+
+	// publish the event only once it is all there
+	__atomic_store_n( &( trace->head), head + 1, __ATOMIC_RELEASE);
+	}  // _________________________________________________________
+
+/** record an event, if the stack is being traced */
+#define BZA_TRACE( stack, op, off, size)	\
+	if ( ( stack)->trace != NULL) bza_trace_ev( ( stack)->trace, (op), (off), (size))
+
+/** write a call to a recorded stack's file (errors are caught later) */
+static
+void					bza_record_ev
+	(
+	FILE *				out,			// recording, not null!
+	int					op,				// e_trace_op
+	size_t				off,			// frame offset (or as per op)
+	size_t				size			// size, count (or as per op)
+	)
+	{
+	t_record_ev			ev;
+
+	ev.off = off;
+	ev.size = ( size > UINT32_MAX) ? UINT32_MAX : (uint32_t) size;
+	ev.op = op;
+	fwrite( &ev, sizeof( ev), 1, out);
+	}  // _________________________________________________________
+
+/** write a call, if the stack is being recorded */
+#define BZA_RECORD( stack, op, off, size)	\
+	if ( ( stack)->record != NULL) bza_record_ev( ( stack)->record, (op), (off), (size))
+
+/** return a frame's hole bookkeeping bits (BZA_IS_HOLE, BZA_ABOVE_BITS) */
+static  // inline?
+size_t					bza_frame_flags
+	(
+	t_stack *			stack,			// a stack to be accessed,
+										//  not null!
+	size_t				marker_off		// offset to desired frame marker
+	)
+	{
+	if ( stack->flags & BZA_OPT_COMPACT_HDR)
+		{
+		return ( (t_compact_marker *) bza_addr( stack, marker_off) )->size &
+				BZA_SIZE_FLAGS;
+		}  // short form?
+
+	return bza_get_frame_marker( stack, marker_off)->size & BZA_SIZE_FLAGS;
+	}  // _________________________________________________________
+
+/**
+ * replace some of the hole bookkeeping bits in a frame's marker.
+ *  (A live frame's marker may be read by other threads meanwhile,
+ *  on a shared stack:  the size they see is the same either way.)
+ */
+static  // inline?
+void					bza_set_frame_flags
+	(
+	t_stack *			stack,			// a stack to be updated,
+										//  not null!
+	size_t				marker_off,		// offset to desired frame marker
+	size_t				mask,			// BZA_IS_HOLE and/or BZA_ABOVE_BITS
+	size_t				bits			// new value of those bits
+	)
+	{
+	t_compact_marker *	short_marker;
+	t_frame_marker *	marker;
+
+	if ( stack->flags & BZA_OPT_COMPACT_HDR)
+		{
+		short_marker = (t_compact_marker *) bza_addr( stack, marker_off);
+		__atomic_store_n( &( short_marker->size),
+				( short_marker->size & ~(uint32_t) mask) | (uint32_t) bits,
+				__ATOMIC_RELAXED);
+		return;  // === done ===
+		}  // short form?
+
+	marker = bza_get_frame_marker( stack, marker_off);
+	__atomic_store_n( &( marker->size), ( marker->size & ~mask) | bits,
+			__ATOMIC_RELAXED);
+	}  // _________________________________________________________
+
+/** return the hole list (bucket) for a dead frame's payload size */
+static  // inline?
+int						bza_hole_bucket
+	(
+	size_t				size			// payload size, not 0
+	)
+	{
+	int					bucket;
+
+	bucket = ( (int) ( sizeof( size_t) * 8) - 1) - __builtin_clzl( size);
+	return ( bucket < BZA_HOLE_BUCKETS) ? bucket : ( BZA_HOLE_BUCKETS - 1);
+	}  // _________________________________________________________
+
+/**
+ * return true if a dead frame can go on a hole list:
+ *  a BZA_MIN_FRAME one must be low enough for a short link.
+ */
+static  // inline?
+int						bza_hole_listed
+	(
+	size_t				marker_off,		// offset to dead frame's marker
+	size_t				size			// its payload size
+	)
+	{
+	return ( size >= BZA_MIN_HOLE) ||
+			( ( marker_off / BZA_ALIGN) < UINT32_MAX);
+	}  // _________________________________________________________
+
+/**
+ * return a link from a listed hole (0 for none):
+ *  the next hole in its list is in the last word of the payload,
+ *  the previous one in the word below that.
+ *  A BZA_MIN_FRAME hole packs both into its one word,
+ *  as 32 bit counts of BZA_ALIGN (plus 1, so 0 is still none);
+ *  every hole on its list is the same size, so any one's size will do.
+ */
+static  // inline?
+size_t					bza_get_hole_link
+	(
+	t_stack *			stack,			// a stack to be accessed,
+										//  not null!
+	size_t				marker_off,		// offset to hole's marker
+	size_t				size,			// payload size of a hole on its list
+	int					is_next			// true for next, false for previous
+	)
+	{
+	uint32_t			short_link;
+
+	if ( size < BZA_MIN_HOLE)
+		{
+		short_link = ( (uint32_t *) bza_addr( stack,
+				marker_off - BZA_MIN_FRAME) )[ is_next ];
+		return ( short_link == 0) ? 0 :
+				( ( ( short_link - (size_t) 1) * BZA_ALIGN) +
+					( marker_off % BZA_ALIGN) );
+		}  // packed?
+
+	return *(size_t *) bza_addr( stack,
+			marker_off - ( is_next ? sizeof( size_t) : ( 2 * sizeof( size_t) ) ) );
+	}  // _________________________________________________________
+
+/** set a link in a listed hole (see bza_get_hole_link) */
+static  // inline?
+void					bza_set_hole_link
+	(
+	t_stack *			stack,			// a stack to be updated,
+										//  not null!
+	size_t				marker_off,		// offset to hole's marker
+	size_t				size,			// payload size of a hole on its list
+	int					is_next,		// true for next, false for previous
+	size_t				link			// marker offset of the other hole, or 0
+	)
+	{
+	if ( size < BZA_MIN_HOLE)
+		{
+		( (uint32_t *) bza_addr( stack, marker_off - BZA_MIN_FRAME) )[ is_next ] =
+				( link == 0) ? 0 : (uint32_t) ( ( link / BZA_ALIGN) + 1);
+		return;  // === done ===
+		}  // packed?
+
+	*(size_t *) bza_addr( stack,
+			marker_off - ( is_next ? sizeof( size_t) : ( 2 * sizeof( size_t) ) ) ) =
+			link;
+	}  // _________________________________________________________
+
+/**
+ * put a dead frame on the list for its size (and count it),
+ *  and mark it as a hole (for the frames on either side of it).
+ */
+static
+void					bza_link_hole
+	(
+	t_stack *			stack,			// a stack to be updated,
+										//  not null!
+	size_t				marker_off		// offset to dead frame's marker
+	)
+	{
+	size_t				size;
+	int					bucket;
+	size_t				next;
+	size_t				below;
+
+	size = bza_frame_size( stack, marker_off);
+	if ( bza_hole_listed( marker_off, size) )
+		{
+		bucket = bza_hole_bucket( size);
+		next = stack->holes[ bucket ];
+		bza_set_hole_link( stack, marker_off, size, 1, next);
+		bza_set_hole_link( stack, marker_off, size, 0, 0);
+		if ( next != 0)
+			{
+			bza_set_hole_link( stack, next, size, 0, marker_off);
+			}  // list not empty?
+
+		stack->holes[ bucket ] = marker_off;
+		stack->hole_map |= ( (uint32_t) 1) << bucket;
+		stack->hole_bytes += size + bza_hdr_sz( stack);
+		stack->num_holes++;
+		}  // can be found by size?
+	// else:  only found through its neighbours (not counted)
+
+	// the frame above finds us from the first word of the payload
+	//  (or, if that's taken by the short links, from our size)
+	if ( size >= BZA_MIN_HOLE)
+		{
+		*(size_t *) bza_addr( stack, marker_off - size) = marker_off;
+		}  // room?
+
+	bza_set_frame_flags( stack, marker_off, BZA_IS_HOLE, BZA_IS_HOLE);
+
+	below = bza_frame_prev( stack, marker_off);
+	if ( below != 0)
+		{
+		bza_set_frame_flags( stack, below, BZA_ABOVE_BITS,
+				( size >= BZA_MIN_HOLE) ? BZA_HOLE_ABOVE : BZA_TINY_ABOVE);
+		}  // not the bottom frame?
+
+	}  // _________________________________________________________
+
+/**
+ * take a hole off the list for its size (and uncount it);
+ *  its marker and its neighbours' are left to the caller.
+ */
+static
+void					bza_unlink_hole
+	(
+	t_stack *			stack,			// a stack to be updated,
+										//  not null!
+	size_t				marker_off		// offset to hole's marker
+	)
+	{
+	size_t				size;
+	int					bucket;
+	size_t				next;
+	size_t				prev;
+
+	size = bza_frame_size( stack, marker_off);
+	if ( ! bza_hole_listed( marker_off, size) )
+		{
+		return;  // === done ===
+		}  // never listed?
+
+	bucket = bza_hole_bucket( size);
+	next = bza_get_hole_link( stack, marker_off, size, 1);
+	prev = bza_get_hole_link( stack, marker_off, size, 0);
+	if ( prev != 0)
+		{
+		bza_set_hole_link( stack, prev, size, 1, next);
+		}  // in the middle?
+	else
+		{
+		stack->holes[ bucket ] = next;
+		if ( next == 0)
+			{
+			stack->hole_map &= ~( ( (uint32_t) 1) << bucket);
+			}  // list now empty?
+
+		}  // first in list
+
+	if ( next != 0)
+		{
+		bza_set_hole_link( stack, next, size, 0, prev);
+		}  // not last?
+
+	stack->hole_bytes -= size + bza_hdr_sz( stack);
+	stack->num_holes--;
+	}  // _________________________________________________________
+
+/**
+ * record a dead frame beneath a live one in the hole lists,
+ *  merging it with any adjacent hole(s):
+ *  the one below is found from the frame's own marker,
+ *  the one above from the first word of its payload, or its size
+ *  (when the frame's marker says there is one).
+ */
+static
+void					bza_add_hole
+	(
+	t_stack *			stack,			// a stack to be updated,
+										//  not null!
+	size_t				marker_off		// offset to newly dead frame
+	)
+	{
+	size_t				hdr_sz;
+	size_t				size;
+	size_t				prev_off;
+	size_t				above;
+	size_t				upper;
+	size_t				merged;
+
+	hdr_sz = bza_hdr_sz( stack);
+	size = bza_frame_size( stack, marker_off);
+	prev_off = bza_frame_prev( stack, marker_off);
+	above = bza_frame_flags( stack, marker_off) & BZA_ABOVE_BITS;
+
+	if ( ( prev_off != 0) &&
+		 ( bza_frame_flags( stack, prev_off) & BZA_IS_HOLE) )
+		{
+		merged = size + bza_frame_size( stack, prev_off) + hdr_sz;
+		if ( bza_same_seg( stack, prev_off - bza_frame_size( stack, prev_off),
+					marker_off) &&
+			 ( merged <= bza_max_frame( stack) ) )
+			{
+			// absorb the hole just below
+			bza_unlink_hole( stack, prev_off);
+			size = merged;
+			prev_off = bza_frame_prev( stack, prev_off);
+			bza_set_frame( stack, marker_off, size, 0, prev_off);
+			}  // same segment, and still fits in a marker?
+
+		}  // adjacent hole below?
+
+	if ( above)
+		{
+		upper = ( above & BZA_TINY_ABOVE) ?
+				( marker_off + hdr_sz + BZA_MIN_FRAME) :
+				*(size_t *) bza_addr( stack, marker_off + hdr_sz);
+		merged = bza_frame_size( stack, upper) + size + hdr_sz;
+		if ( bza_same_seg( stack, marker_off - size, upper) &&
+			 ( merged <= bza_max_frame( stack) ) )
+			{
+			// let the hole just above absorb this one
+			above = bza_frame_flags( stack, upper) & BZA_ABOVE_BITS;
+			bza_unlink_hole( stack, upper);
+			bza_set_frame( stack, upper, merged, 0, prev_off);
+			marker_off = upper;
+			}  // same segment, and still fits in a marker?
+
+		}  // adjacent hole above?
+
+	bza_set_frame_flags( stack, marker_off, BZA_ABOVE_BITS, above);
+	bza_link_hole( stack, marker_off);
+	}  // _________________________________________________________
+
+/** most holes looked at in the list for a frame's own size */
+#define BZA_HOLE_SCAN	8
+
+/**
+ * try to build a new frame in a hole:  a close fit from the list
+ *  for its size, else the first hole of the next larger list
+ *  which has any;  return the frame offset, or 0 if no hole fits.
+ */
+static
+size_t					bza_take_hole
+	(
+	t_stack *			stack,			// a stack to be updated,
+										//  not null!
+	size_t				frame_sz		// size of frame, excluding overhead
+	)
+	{
+	size_t				hdr_sz;
+	int					bucket;
+	int					num_seen;
+	uint32_t			larger;
+	size_t				cur;
+	size_t				cur_size;
+	size_t				best;
+	size_t				best_size;
+	size_t				above;
+	size_t				below;
+	size_t				frame_off;
+
+	hdr_sz = bza_hdr_sz( stack);
+	bucket = bza_hole_bucket( frame_sz);
+
+	// (this list also holds holes smaller than the frame)
+	best = 0;
+	best_size = 0;
+	num_seen = 0;
+	for ( cur = stack->holes[ bucket ];
+		  ( cur != 0) && ( num_seen < BZA_HOLE_SCAN);
+		  cur = bza_get_hole_link( stack, cur, cur_size, 1) )
+
+		{
+		cur_size = bza_frame_size( stack, cur);
+		if ( ( cur_size >= frame_sz) &&
+			 ( ( best == 0) || ( cur_size < best_size) ) )
+			{
+			best = cur;
+			best_size = cur_size;
+			if ( best_size == frame_sz)
+				{
+				break;  // === done ===
+				}  // can't beat that?
+
+			}  // better fit?
+
+		num_seen++;
+		}  // check the first few holes
+
+	// (any hole in a larger list is big enough)
+	larger = ( bucket < ( BZA_HOLE_BUCKETS - 1) ) ?
+			( stack->hole_map & ( ~( (uint32_t) 0) << ( bucket + 1) ) ) : 0;
+	if ( ( best == 0) && ( larger != 0) )
+		{
+		best = stack->holes[ __builtin_ctz( larger) ];
+		best_size = bza_frame_size( stack, best);
+		}  // take from a larger list?
+
+	if ( best == 0)
+		{
+		return 0;  // === fail ===
+		}  // nothing big enough?
+
+	bza_unlink_hole( stack, best);
+	above = bza_frame_flags( stack, best) & BZA_ABOVE_BITS;
+	below = bza_frame_prev( stack, best);
+	if ( below != 0)
+		{
+		bza_set_frame_flags( stack, below, BZA_ABOVE_BITS, 0);
+		}  // a live frame above it now
+
+	if ( best_size < ( frame_sz + hdr_sz + BZA_MIN_FRAME) )
+		{
+		// use the whole hole (the extra space goes along for the ride)
+		bza_set_frame( stack, best, best_size, 1, below);
+		bza_set_frame_flags( stack, best, BZA_ABOVE_BITS, above);
+		bza_tally_frame( stack, best_size, 1);
+		return best;  // === done ===
+		}  // not worth splitting?
+
+	// split:  new frame at the bottom, the rest stays a hole
+	frame_off = ( best - best_size) + frame_sz;
+	bza_set_frame( stack, frame_off, frame_sz, 1, below);
+	bza_set_frame( stack, best, best_size - ( frame_sz + hdr_sz), 0, frame_off);
+	bza_set_frame_flags( stack, best, BZA_ABOVE_BITS, above);
+	bza_link_hole( stack, best);
+	bza_tally_frame( stack, frame_sz, 1);
+	return frame_off;
+	}  // _________________________________________________________
+
+/**
+ * take a hole which has come to the top of the stack off its list,
+ *  return the offset of the frame below it (0 if none).
+ */
+static
+size_t					bza_pop_hole
+	(
+	t_stack *			stack,			// a stack to be updated,
+										//  not null!
+	size_t				marker_off		// offset to hole's marker
+	)
+	{
+	bza_unlink_hole( stack, marker_off);
+	return bza_frame_prev( stack, marker_off);
+	}  // _________________________________________________________
+
+/**
+ * dump stack / heap structure.
+ *  Compiled down to nothing unless logging is on:
+ *  the frame walk would otherwise run (with no output) on every call.
+ */
+static
+void					bza_dump_stack
+	(
+	t_stack *			stack			// a stack to be displayed
+	)
+	{
+#ifdef DO_LOG
+	size_t				marker_off;
+
+	if ( stack == NULL)
+		{
+		MLOG_PRINTF( stderr, "No stack!");
+		return;  // === done ===
+		}  // no stack???
+
+	MLOG_PRINTF( stderr, "STK: %d bytes @ %x\n",
+			(int) stack->size, (int) stack);
+	for ( marker_off = bza_get_top_frame_marker_offset( stack);
+		  marker_off != 0;
+		  marker_off = bza_frame_prev( stack, marker_off))
+
+		{
+		MLOG_PRINTF( stderr, "\tFRM: %d b, %d refs (prev %d) @ %d\n",
+				(int) bza_frame_size( stack, marker_off),
+				(int) *bza_frame_refs( stack, marker_off),
+				(int) bza_frame_prev( stack, marker_off),
+				(int) marker_off);
+		}  // dump each frame
+
+#endif  // DO_LOG defined?
+	}  // _________________________________________________________
+
+/** create a new (empty) stack */
+t_stack *				bza_cons_stack
+	(
+	jmp_buf *			catcher			// error handler (or null for immediate death)
+	)
+	{
+	return bza_cons_stack_rt( catcher, 0, 0);
+	}  // _________________________________________________________
+
+/**
+ * allocate the requested amount of memory,
+ * possibly resizing an existing block
+ * TODO:  set policy for releasing existing block if realloc fails.
+ */
+static
+void *					alloc_or_die
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	void *				existing,		// existing block (if not null)
+	size_t				new_size		// number of bytes requested
+	)
+	{
+	void *				new_blk;
+
+	// TODO: determine if alloc is thread safe
+	new_blk = realloc( existing, new_size);
+	if ( new_blk != NULL)
+		{
+		return new_blk;  // === done ===
+		}  // it worked?
+
+	if ( catcher != NULL)
+		{
+		longjmp( *catcher, 1);  // === abort ===
+		}  // error handler?
+
+	// just die, then
+	assert( new_blk != NULL);
+	return NULL;  // dummy
+	}  // _________________________________________________________
+
+/**
+ * ALWAYS FAIL to allocate memory,
+ * TODO:  set policy for releasing existing block if realloc fails.
+ */
+static
+void *					no_alloc_just_die
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	void *				existing,		// existing block (if not null)
+	size_t				new_size		// number of bytes requested
+	)
+	{
+	if ( catcher != NULL)
+		{
+		MLOG_PUTS( "\tResize not allowed\n");
+		longjmp( *catcher, 1);  // === abort ===
+		}  // error handler?
+
+	// just die, then
+	assert( "Resize not allowed" == NULL);
+	return NULL;  // dummy
+	}  // _________________________________________________________
+
+/** release a block from alloc_or_die */
+static
+void					free_block
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	void *				existing		// existing block
+	)
+	{
+	free( existing);
+	}  // _________________________________________________________
+
+/** raise an error (e.g. for a failed system call) */
+static
+void					fail_or_die
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	const
+	char *				what			// description of what failed
+	)
+	{
+	MLOG_PRINTF( stderr, "\t%s\n", what);
+	if ( catcher != NULL)
+		{
+		longjmp( *catcher, 1);  // === abort ===
+		}  // error handler?
+
+	// just die, then
+	assert( what == NULL);
+	}  // _________________________________________________________
+
+/** return the VM page size */
+static
+size_t					get_page_size( void)
+	{
+	static
+	size_t				page_size;
+
+	if ( page_size == 0)
+		{
+		page_size = (size_t) sysconf( _SC_PAGESIZE);
+		}  // first call?
+
+	return page_size;
+	}  // _________________________________________________________
+
+/**
+ * apply the "real time" options to memory just added to a stack:
+ *  touch each page (BZA_OPT_PREFAULT), then lock them (BZA_OPT_LOCK).
+ *  Return 0 if OK, non-0 if the pages could not be locked.
+ */
+static
+int						rt_prepare
+	(
+	int					flags,			// BZA_OPT_* option bits
+	void *				addr,			// start of new memory
+	size_t				len				// bytes of new memory
+	)
+	{
+	volatile
+	char *				p;
+	volatile
+	char *				end;
+	size_t				page_size;
+
+	if ( len == 0)
+		{
+		return 0;  // === done ===
+		}  // nothing new?
+
+	if ( flags & BZA_OPT_PREFAULT)
+		{
+		// (read and write back:  the memory may already hold data)
+		page_size = get_page_size();
+		end = ( (char *) addr) + len;
+		for ( p = (char *) addr; p < end; p += page_size)
+
+			{
+			*p = *p;
+			}  // touch each page
+
+		end[ -1 ] = end[ -1 ];
+		}  // fault in now?
+
+	if ( flags & BZA_OPT_LOCK)
+		{
+		return mlock( addr, len);
+		}  // keep in RAM?
+
+	return 0;
+	}  // _________________________________________________________
+
+/** return the unit in which a "mapped" stack is sized */
+static
+size_t					map_unit
+	(
+	int					flags			// BZA_OPT_* option bits
+	)
+	{
+	return ( flags & BZA_OPT_HUGE) ? BZA_HUGE_PAGE : get_page_size();
+	}  // _________________________________________________________
+
+/**
+ * map a block of memory for a "mapped" stack,
+ *  with the "real time" options applied.
+ */
+static
+void *					map_block_or_die
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	int					flags,			// BZA_OPT_* option bits
+	size_t				len				// bytes to map (a multiple of map_unit)
+	)
+	{
+	int					map_flags;
+	int					populated;
+	void *				blk;
+
+	map_flags = MAP_PRIVATE | MAP_ANONYMOUS;
+	blk = MAP_FAILED;
+	populated = 0;
+	if ( flags & BZA_OPT_HUGE)
+		{
+		blk = mmap( NULL, len, PROT_READ | PROT_WRITE,
+				map_flags | MAP_HUGETLB |
+				( ( flags & BZA_OPT_PREFAULT) ? MAP_POPULATE : 0),
+				-1, 0);
+		populated = ( blk != MAP_FAILED);
+		}  // try for explicit huge pages?
+
+	if ( blk == MAP_FAILED)
+		{
+		// (transparent huge pages must be asked for before the faults)
+		if ( ! ( flags & BZA_OPT_HUGE) )
+			{
+			map_flags |= ( flags & BZA_OPT_PREFAULT) ? MAP_POPULATE : 0;
+			populated = 1;
+			}  // populate now?
+
+		blk = mmap( NULL, len, PROT_READ | PROT_WRITE, map_flags, -1, 0);
+		if ( blk == MAP_FAILED)
+			{
+			fail_or_die( catcher, "mmap failed");
+			return NULL;  // dummy
+			}  // no memory?
+
+		if ( flags & BZA_OPT_HUGE)
+			{
+			madvise( blk, len, MADV_HUGEPAGE);  // (just a hint)
+			}  // transparent huge pages?
+
+		}  // normal pages?
+
+	if ( rt_prepare( populated ? ( flags & ~BZA_OPT_PREFAULT) : flags,
+			blk, len) != 0)
+		{
+		munmap( blk, len);
+		fail_or_die( catcher, "mlock failed");
+		return NULL;  // dummy
+		}  // could not lock?
+
+	return blk;
+	}  // _________________________________________________________
+
+/**
+ * resize a "mapped" stack to (at least) the requested size,
+ *  applying the "real time" options to any new pages,
+ *  or unmapping any pages given up.
+ */
+static
+void *					map_alloc_or_die
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	void *				existing,		// existing block (NOT null)
+	size_t				new_size		// number of bytes requested
+	)
+	{
+	int					flags;
+	size_t				old_len;
+	size_t				new_len;
+	void *				blk;
+
+	// (read now:  "existing" may be gone after mremap)
+	flags = ( (t_stack *) existing)->flags;
+	old_len = ( (t_stack *) existing)->mapped;
+	new_len = BZA_ROUND_UP( new_size, map_unit( flags) );
+	if ( new_len == old_len)
+		{
+		return existing;  // === done ===
+		}  // already the right size?
+
+	if ( new_len < old_len)
+		{
+		// (shrinking never moves a mapping)
+		if ( mremap( existing, old_len, new_len, 0) == MAP_FAILED)
+			{
+			fail_or_die( catcher, "mremap failed");
+			}  // can't shrink?
+
+		( (t_stack *) existing)->mapped = new_len;
+		return existing;  // === done ===
+		}  // trimmed?
+
+	blk = mremap( existing, old_len, new_len, MREMAP_MAYMOVE);
+	if ( blk == MAP_FAILED)
+		{
+		// (e.g. explicit huge pages, on older kernels)
+		blk = map_block_or_die( catcher, flags, new_len);
+		memcpy( blk, existing, old_len);
+		munmap( existing, old_len);
+		( (t_stack *) blk)->bytes_copied += old_len;
+		}  // can't remap?
+	else if ( rt_prepare( flags, ( (char *) blk) + old_len,
+			new_len - old_len) != 0)
+		{
+		// put it back where (and as) it was:  the caller still has it
+		if ( blk == existing)
+			{
+			// (shrinking in place never moves a mapping)
+			blk = mremap( blk, new_len, old_len, 0);
+			}  // grown in place?
+		else
+			{
+			blk = mremap( blk, new_len, old_len,
+					MREMAP_MAYMOVE | MREMAP_FIXED, existing);
+			}  // moved?
+
+		if ( blk != existing)
+			{
+			fail_or_die( catcher, "mremap failed");
+			return NULL;  // dummy
+			}  // can't put it back?
+
+		fail_or_die( catcher, "mlock failed");
+		return NULL;  // dummy
+		}  // could not lock the new pages?
+
+	( (t_stack *) blk)->mapped = new_len;
+	return blk;
+	}  // _________________________________________________________
+
+/** release a "mapped" stack */
+static
+void					map_release
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	void *				existing		// existing block
+	)
+	{
+	munmap( existing, ( (t_stack *) existing)->mapped);
+	}  // _________________________________________________________
+
+/**
+ * memory file holding BZA_OPT_COW stacks:  the one which created it
+ *  (mapped shared), then any clones (all mapped copy-on-write).
+ */
+typedef struct			t_cow_file
+	{
+	int					fd;				// memfd
+	int					refs;			// stacks mapping it
+	}					t_cow_file;
+
+/** create a memory file of the given size, for a BZA_OPT_COW stack */
+static
+t_cow_file *			cow_file_or_die
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	size_t				len				// size of file
+	)
+	{
+	t_cow_file *		cow;
+
+	cow = alloc_or_die( catcher, NULL, sizeof( t_cow_file) );
+	cow->fd = memfd_create( "bzrt_stack", MFD_CLOEXEC);
+	if ( ( cow->fd < 0) || ( ftruncate( cow->fd, (off_t) len) != 0) )
+		{
+		if ( cow->fd >= 0)
+			{
+			close( cow->fd);
+			}  // created, but no room?
+
+		free( cow);
+		fail_or_die( catcher, "memfd failed");
+		return NULL;  // dummy
+		}  // can't create?
+
+	cow->refs = 1;
+	return cow;
+	}  // _________________________________________________________
+
+/** drop a stack's hold on its memory file (closed after the last one) */
+static
+void					cow_unref
+	(
+	t_cow_file *		cow				// memory file
+	)
+	{
+	if ( __atomic_sub_fetch( &( cow->refs), 1, __ATOMIC_ACQ_REL) == 0)
+		{
+		close( cow->fd);
+		free( cow);
+		}  // last one?
+
+	}  // _________________________________________________________
+
+/**
+ * map the start of a memory file, shared or copy-on-write,
+ *  in place of the memory at "addr" (if not null).
+ *  Return the mapping, or MAP_FAILED.
+ */
+static
+void *					cow_map
+	(
+	t_cow_file *		cow,			// memory file
+	void *				addr,			// mapping to be replaced, or null
+	size_t				len,			// bytes to map
+	int					shared			// true to write through to the file
+	)
+	{
+	return mmap( addr, len, PROT_READ | PROT_WRITE,
+			( shared ? MAP_SHARED : MAP_PRIVATE) |
+			( ( addr != NULL) ? MAP_FIXED : 0),
+			cow->fd, 0);
+	}  // _________________________________________________________
+
+/** write a block to a file, return 0 if OK */
+static
+int						cow_write
+	(
+	int					fd,				// file
+	const
+	void *				buf,			// block to be written
+	size_t				len,			// bytes to write
+	size_t				off				// where, in the file
+	)
+	{
+	ssize_t				done;
+
+	while ( len > 0)
+
+		{
+		done = pwrite( fd, buf, len, (off_t) off);
+		if ( done <= 0)
+			{
+			return -1;  // === abort ===
+			}  // disk full, etc?
+
+		buf = ( (const char *) buf) + done;
+		len -= done;
+		off += done;
+		}  // write until all written (large blocks go in pieces)
+
+	return 0;
+	}  // _________________________________________________________
+
+/**
+ * write the pages of a copy-on-write stack which differ from
+ *  its memory file (its private copies) back to the file,
+ *  return 0 if OK.  The private copies are found from
+ *  /proc/self/pagemap, if readable, otherwise all pages are written.
+ */
+static
+int						cow_write_back
+	(
+	t_stack *			stack			// a stack mapped copy-on-write
+	)
+	{
+	uint64_t			ents[ 512 ];
+	size_t				page_size;
+	size_t				num_pages;
+	size_t				first;
+	size_t				num;
+	size_t				idx;
+	int					pm;
+	int					rc;
+
+	page_size = get_page_size();
+	num_pages = stack->mapped / page_size;
+	pm = open( "/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+	if ( pm < 0)
+		{
+		return cow_write( stack->cow->fd, stack, stack->mapped, 0);
+		// === done ===
+		}  // can't tell which?
+
+	rc = 0;
+	for ( first = 0; ( first < num_pages) && ( rc == 0); first += num)
+
+		{
+		num = num_pages - first;
+		num = ( num < 512) ? num : 512;
+		if ( pread( pm, ents, num * sizeof( uint64_t),
+				(off_t) ( ( ( (uintptr_t) stack) / page_size + first) *
+						sizeof( uint64_t) ) ) !=
+				(ssize_t) ( num * sizeof( uint64_t) ) )
+			{
+			close( pm);
+			return cow_write( stack->cow->fd, stack, stack->mapped, 0);
+			// === done ===
+			}  // can't tell which, after all?
+
+		for ( idx = 0; ( idx < num) && ( rc == 0); idx++)
+
+			{
+			// (a private copy is an anonymous page, in RAM or swapped out)
+			if ( ( ( ents[ idx ] & BZA_PM_PRESENT) &&
+				   ! ( ents[ idx ] & BZA_PM_FILE) ) ||
+				 ( ents[ idx ] & BZA_PM_SWAPPED) )
+				{
+				rc = cow_write( stack->cow->fd,
+						( (char *) stack) + ( first + idx) * page_size,
+						page_size, ( first + idx) * page_size);
+				}  // changed since mapped?
+
+			}  // check each page of the batch
+
+		}  // check each batch of pages
+
+	close( pm);
+	return rc;
+	}  // _________________________________________________________
+
+/**
+ * resize a BZA_OPT_COW stack (and its memory file, if need be)
+ *  to (at least) the requested size.
+ *  The file is only cut back while no clone maps it.
+ */
+static
+void *					cow_alloc_or_die
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	void *				existing,		// existing block (NOT null)
+	size_t				new_size		// number of bytes requested
+	)
+	{
+	t_stack *			stack;
+	struct stat			st;
+	size_t				new_len;
+	void *				blk;
+
+	stack = (t_stack *) existing;
+	new_len = BZA_ROUND_UP( new_size, get_page_size() );
+	if ( new_len == stack->mapped)
+		{
+		return existing;  // === done ===
+		}  // already the right size?
+
+	if ( new_len < stack->mapped)
+		{
+		// (shrinking never moves a mapping)
+		if ( ( mremap( existing, stack->mapped, new_len, 0) == MAP_FAILED) ||
+			 ( ( __atomic_load_n( &( stack->cow->refs), __ATOMIC_ACQUIRE) ==
+					1) &&
+			   ( ftruncate( stack->cow->fd, (off_t) new_len) != 0) ) )
+			{
+			fail_or_die( catcher, "mremap failed");
+			}  // can't shrink?
+
+		stack->mapped = new_len;
+		return existing;  // === done ===
+		}  // trimmed?
+
+	// (clones may map more of the file than this one)
+	if ( ( fstat( stack->cow->fd, &st) != 0) ||
+		 ( ( (size_t) st.st_size < new_len) &&
+		   ( ftruncate( stack->cow->fd, (off_t) new_len) != 0) ) )
+		{
+		fail_or_die( catcher, "memfd failed");
+		}  // no room?
+
+	blk = mremap( existing, stack->mapped, new_len, MREMAP_MAYMOVE);
+	if ( blk == MAP_FAILED)
+		{
+		fail_or_die( catcher, "mremap failed");
+		return NULL;  // dummy
+		}  // no address space?
+
+	( (t_stack *) blk)->mapped = new_len;
+	return blk;
+	}  // _________________________________________________________
+
+/** release a BZA_OPT_COW stack */
+static
+void					cow_release
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	void *				existing		// existing block
+	)
+	{
+	t_cow_file *		cow;
+
+	cow = ( (t_stack *) existing)->cow;
+	munmap( existing, ( (t_stack *) existing)->mapped);
+	cow_unref( cow);
+	}  // _________________________________________________________
+
+/**
+ * commit pages, within the address space reserved for a "vm" stack,
+ *  to cover the requested size (or give back those beyond it).
+ *  The stack is never moved.
+ */
+static
+void *					vm_commit_or_die
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	void *				existing,		// existing block (NOT null)
+	size_t				new_size		// number of bytes requested
+	)
+	{
+	t_stack *			stack;
+	size_t				page_size;
+	size_t				old_commit;
+	size_t				new_commit;
+
+	stack = (t_stack *) existing;
+	page_size = get_page_size();
+	old_commit = BZA_ROUND_UP( stack->size + sizeof( t_stack), page_size);
+	new_commit = BZA_ROUND_UP( new_size, page_size);
+	if ( new_commit > stack->reserved)
+		{
+		return no_alloc_just_die( catcher, existing, new_size);
+		// === abort ===
+		}  // out of reserved space?
+
+	if ( new_commit < old_commit)
+		{
+		// fresh reserved pages in place of the old ones (and any locks)
+		if ( mmap( ( (char *) existing) + new_commit, old_commit - new_commit,
+				PROT_NONE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED,
+				-1, 0) == MAP_FAILED)
+			{
+			fail_or_die( catcher, "mmap failed");
+			}  // can't decommit?
+
+		if ( stack->flags & BZA_OPT_HUGE)
+			{
+			madvise( ( (char *) existing) + new_commit,
+					old_commit - new_commit, MADV_HUGEPAGE);  // (just a hint)
+			}  // transparent huge pages?
+
+		return existing;  // === done ===
+		}  // trimmed?
+
+	if ( ( new_commit > old_commit) &&
+		 ( mprotect( ( (char *) existing) + old_commit,
+				new_commit - old_commit,
+				PROT_READ | PROT_WRITE) != 0) )
+		{
+		fail_or_die( catcher, "mprotect failed");
+		}  // more pages needed, but commit failed?
+
+	if ( ( new_commit > old_commit) &&
+		 ( rt_prepare( stack->flags, ( (char *) existing) + old_commit,
+				new_commit - old_commit) != 0) )
+		{
+		fail_or_die( catcher, "mlock failed");
+		}  // "real time" stack, but could not lock?
+
+	return existing;
+	}  // _________________________________________________________
+
+/** release the address space of a "vm" stack */
+static
+void					vm_release
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	void *				existing		// existing block
+	)
+	{
+	munmap( existing, ( (t_stack *) existing)->reserved);
+	}  // _________________________________________________________
+
+/**
+ * reserve address space for a "vm" stack,
+ *  and commit enough of it for the initial size.
+ */
+static
+t_stack *				vm_reserve_or_die
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	size_t				reserve_size,	// address space to reserve
+	size_t				initial_size,	// bytes to commit now
+	int					flags			// BZA_OPT_* option bits
+	)
+	{
+	size_t				page_size;
+	size_t				commit;
+	void *				blk;
+
+	page_size = get_page_size();
+	reserve_size = BZA_ROUND_UP( reserve_size, page_size);
+	commit = BZA_ROUND_UP( initial_size, page_size);
+	if ( commit > reserve_size)
+		{
+		return no_alloc_just_die( catcher, NULL, initial_size);
+		// === abort ===
+		}  // initial size too big?
+
+	blk = mmap( NULL, reserve_size, PROT_NONE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if ( blk == MAP_FAILED)
+		{
+		fail_or_die( catcher, "mmap failed");
+		return NULL;  // dummy
+		}  // no address space?
+
+	if ( mprotect( blk, commit, PROT_READ | PROT_WRITE) != 0)
+		{
+		munmap( blk, reserve_size);
+		fail_or_die( catcher, "mprotect failed");
+		return NULL;  // dummy
+		}  // commit failed?
+
+	if ( flags & BZA_OPT_HUGE)
+		{
+		madvise( blk, reserve_size, MADV_HUGEPAGE);  // (just a hint)
+		}  // transparent huge pages?
+
+	if ( rt_prepare( flags, blk, commit) != 0)
+		{
+		munmap( blk, reserve_size);
+		fail_or_die( catcher, "mlock failed");
+		return NULL;  // dummy
+		}  // "real time" stack, but could not lock?
+
+	( (t_stack *) blk)->reserved = reserve_size;
+	return (t_stack *) blk;
+	}  // _________________________________________________________
+
+/**
+ * move a child stack into a bigger frame of its parent
+ *  (the old frame is dropped).
+ */
+static
+void *					child_alloc_or_die
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	void *				existing,		// existing block (NOT null)
+	size_t				new_size		// number of bytes requested
+	)
+	{
+	t_stack *			stack;
+	t_stack *			parent;
+	size_t				frame;
+	void *				blk;
+
+	stack = (t_stack *) existing;
+	parent = stack->parent;
+	frame = bza_cons_stk_frame( catcher, &parent, new_size);
+	assert( parent == stack->parent);  // (never relocated)
+
+	// just the housekeeping fields and the frames in use
+	blk = bza_fast_frame_ptr( parent, frame);
+	memcpy( blk, existing, sizeof( t_stack) + stack->top);
+	bza_deref_stk_frame( catcher, parent, stack->parent_frame);
+	( (t_stack *) blk)->parent_frame = frame;
+	return blk;
+	}  // _________________________________________________________
+
+/** release a child stack (drop its frame in the parent) */
+static
+void					child_release
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	void *				existing		// existing block
+	)
+	{
+	bza_deref_stk_frame( catcher, ( (t_stack *) existing)->parent,
+			( (t_stack *) existing)->parent_frame);
+	}  // _________________________________________________________
+
+/** return true if a stack may be relocated when it grows */
+static
+int						bza_may_relocate
+	(
+	t_stack *			stack			// a stack to be checked,
+										//  not null!
+	)
+	{
+	return ( stack->alloc == alloc_or_die) ||
+			( stack->alloc == map_alloc_or_die) ||
+			( stack->alloc == cow_alloc_or_die) ||
+			( stack->alloc == child_alloc_or_die);
+	}  // _________________________________________________________
+
+/**
+ * create a new (empty) stack which is NEVER relocated:
+ *  the given amount of address space is reserved up front,
+ *  and pages are committed as the stack grows into it.
+ */
+t_stack *				bza_cons_stack_vm
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	size_t				reserve_size	// address space to reserve
+										//  (maximum size of stack)
+	)
+	{
+	t_stack_opts		opts;
+
+	memset( &opts, 0, sizeof( opts) );
+	opts.vm_reserve = reserve_size;
+	return bza_cons_stack_opts( catcher, &opts);
+	}  // _________________________________________________________
+
+/**
+ * add segments to a segmented stack to cover the requested size
+ *  (or free those beyond it).
+ *  The stack (and existing segments) are never moved.
+ */
+static
+void *					seg_alloc_or_die
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	void *				existing,		// existing block (NOT null)
+	size_t				new_size		// number of bytes requested
+	)
+	{
+	t_stack *			stack;
+	size_t				seg_size;
+	size_t				num_segs;
+
+	stack = (t_stack *) existing;
+	seg_size = ( (size_t) 1) << stack->seg_shift;
+	new_size -= sizeof( t_stack);
+	num_segs = ( new_size + seg_size - 1) >> stack->seg_shift;
+	if ( num_segs <= stack->num_segs)
+		{
+		while ( stack->num_segs > num_segs)
+
+			{
+			free( stack->segs[ --( stack->num_segs) ]);
+			}  // free each segment given up
+
+		return existing;  // === done ===
+		}  // already big enough (or trimmed)?
+
+	// only the (small) segment table is ever copied
+	stack->segs = alloc_or_die( catcher, stack->segs,
+			num_segs * sizeof( char *) );
+	while ( stack->num_segs < num_segs)
+
+		{
+		stack->segs[ stack->num_segs ] = alloc_or_die( catcher, NULL, seg_size);
+		stack->num_segs++;
+		if ( rt_prepare( stack->flags, stack->segs[ stack->num_segs - 1 ],
+				seg_size) != 0)
+			{
+			fail_or_die( catcher, "mlock failed");
+			}  // "real time" stack, but could not lock?
+
+		}  // add each segment
+
+	return existing;
+	}  // _________________________________________________________
+
+/** release the segments of a segmented stack */
+static
+void					seg_release
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	void *				existing		// existing block
+	)
+	{
+	t_stack *			stack;
+
+	stack = (t_stack *) existing;
+	while ( stack->num_segs > 0)
+
+		{
+		free( stack->segs[ --( stack->num_segs) ]);
+		}  // free each segment
+
+	free( stack->segs);
+	free( stack);
+	}  // _________________________________________________________
+
+/**
+ * create a new (empty) segmented stack, which is NEVER relocated:
+ *  the stack grows by adding fixed size segments.
+ */
+t_stack *				bza_cons_stack_seg
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	int					seg_shift		// log2 of segment size
+	)
+	{
+	t_stack_opts		opts;
+
+	memset( &opts, 0, sizeof( opts) );
+	opts.seg_shift = seg_shift;
+	return bza_cons_stack_opts( catcher, &opts);
+	}  // _________________________________________________________
+
+/** create a new (empty) stack, with "real time" support options */
+t_stack *				bza_cons_stack_rt
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	size_t				initial_size,	// initial size of stack
+	int					is_fixed		// true if fixed to "initial" size
+	)
+	{
+	t_stack_opts		opts;
+
+	memset( &opts, 0, sizeof( opts) );
+	opts.initial_size = initial_size;
+	opts.is_fixed = is_fixed;
+	return bza_cons_stack_opts( catcher, &opts);
+	}  // _________________________________________________________
+
+/**
+ * set up the housekeeping fields of a new stack
+ *  (all but those of its storage:  alloc, release, reserved, mapped, cow
+ *  and, if segmented, the segments).
+ */
+static
+void					bza_init_stack
+	(
+	t_stack *			stack,			// a stack to be set up,
+										//  not null!
+	size_t				stk_sz,			// size, including these fields
+	const
+	t_stack_opts *		opts			// construction options, not null!
+	)
+	{
+	if ( opts->seg_shift == 0)
+		{
+		stack->seg_shift = 0;
+		stack->segs = NULL;
+		stack->num_segs = 0;
+		}  // contiguous?
+
+	// TODO: define boundary better, so I can recognize an empty stack
+
+	// "initial_size" includes the housekeeping fields
+	stack->size = stk_sz - sizeof( t_stack);
+	stack->top = 0;
+	stack->flags = ( opts->flags & BZA_OPT_OFF32) ?
+			( opts->flags | BZA_OPT_COMPACT_HDR) : opts->flags;
+	memset( stack->holes, 0, sizeof( stack->holes) );
+	stack->hole_map = 0;
+	stack->num_holes = 0;
+	stack->hole_bytes = 0;
+	memset( stack->slabs, 0, sizeof( stack->slabs) );
+	stack->high_water = 0;
+	stack->marks = NULL;
+	stack->num_marks = 0;
+	stack->max_marks = 0;
+	stack->bytes_copied = 0;
+	stack->stats_stale = 0;
+	stack->live_frames = 0;
+	stack->live_bytes = 0;
+	memset( stack->size_hist, 0, sizeof( stack->size_hist) );
+	memset( stack->slot_counts, 0, sizeof( stack->slot_counts) );
+	stack->trace = NULL;
+	stack->record = NULL;
+	stack->lock = 0;
+	stack->parent = NULL;
+	stack->parent_frame = 0;
+	if ( opts->grow != NULL)
+		{
+		stack->grow = opts->grow;
+		stack->grow_arg = opts->grow_arg;
+		}  // explicit growth policy?
+	else if ( opts->seg_shift > 0)
+		{
+		stack->grow = bza_grow_chunk;
+		stack->grow_arg = ( (size_t) 1) << opts->seg_shift;
+		}  // segmented stack?
+	else if ( opts->vm_reserve > 0)
+		{
+		// nothing is copied, so just commit some more pages at a time
+		stack->grow = bza_grow_chunk;
+		stack->grow_arg = BZA_DEF_CHUNK;
+		}  // "vm" stack?
+	else
+		{
+		stack->grow = bza_grow_double;
+		stack->grow_arg = 0;
+		}  // default policy?
+	stack->num_grows = 0;
+	stack->trim_floor = stack->size;
+	}  // _________________________________________________________
+
+/**
+ * fail unless the construction options make sense together
+ *  (for bza_cons_stack_opts and bza_cons_child_stack).
+ */
+static
+void					bza_check_opts
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	const
+	t_stack_opts *		opts,			// construction options, not null!
+	size_t				stk_sz			// size, including the housekeeping
+										//  fields
+	)
+	{
+	if ( ( opts->vm_reserve > 0) && ( opts->seg_shift > 0) )
+		{
+		fail_or_die( catcher, "stack cannot be both vm and segmented");
+		return;  // dummy
+		}  // conflicting storage?
+
+	if ( ( opts->flags & BZA_OPT_SHARED) && ( ! opts->is_fixed) &&
+		 ( opts->vm_reserve == 0) && ( opts->seg_shift == 0) )
+		{
+		fail_or_die( catcher, "shared stack would be relocated");
+		return;  // dummy
+		}  // other threads would be left with a stale stack?
+
+	if ( ( opts->flags & BZA_OPT_SHARED) && ( opts->seg_shift > 0) )
+		{
+		fail_or_die( catcher, "shared stack cannot be segmented");
+		return;  // dummy
+		}  // segment table is grown (moved) while others read it?
+
+	if ( ( opts->flags & BZA_OPT_COW) &&
+		 ( ( opts->flags & BZA_OPT_RT_MASK) ||
+		   ( opts->vm_reserve > 0) || ( opts->seg_shift > 0) ) )
+		{
+		fail_or_die( catcher, "copy-on-write stack must be plain");
+		return;  // dummy
+		}  // conflicting storage?
+
+	if ( ( opts->flags & BZA_OPT_OFF32) &&
+		 ( ( stk_sz - sizeof( t_stack) ) > UINT32_MAX) )
+		{
+		fail_or_die( catcher, "stack too big for 32 bit offsets");
+		return;  // dummy
+		}  // offsets would not fit?
+
+	}  // _________________________________________________________
+
+/** create a new (empty) stack, with the given options */
+t_stack *				bza_cons_stack_opts
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	const
+	t_stack_opts *		opts			// construction options (null for defaults)
+	)
+	{
+	static const
+	t_stack_opts		DEFAULT_OPTS;	// all 0s
+
+	size_t				stk_sz;
+	t_stack *			stack;
+	t_cow_file *		cow;
+	const char *		fx;
+
+	if ( opts == NULL)
+		{
+		opts = &DEFAULT_OPTS;
+		}  // use defaults?
+
+	stk_sz = ( opts->initial_size > sizeof( t_stack) ) ?
+			opts->initial_size : sizeof( t_stack);
+	bza_check_opts( catcher, opts, stk_sz);
+
+	if ( opts->vm_reserve > 0)
+		{
+		stack = vm_reserve_or_die( catcher, opts->vm_reserve, stk_sz,
+				opts->flags);
+
+		// whatever is committed is usable
+		stk_sz = BZA_ROUND_UP( stk_sz, get_page_size() );
+		stack->alloc = opts->is_fixed ?
+				no_alloc_just_die :
+				vm_commit_or_die ;
+		stack->release = vm_release;
+		stack->mapped = 0;
+		stack->cow = NULL;
+		}  // reserve address space, commit as needed?
+	else if ( opts->seg_shift > 0)
+		{
+		// just the housekeeping fields here, data goes in segments
+		stack = alloc_or_die( catcher, NULL, sizeof( t_stack) );
+		stack->seg_shift = opts->seg_shift;
+		stack->segs = NULL;
+		stack->num_segs = 0;
+		stack->flags = opts->flags;  // (for seg_alloc_or_die)
+		seg_alloc_or_die( catcher, stack, stk_sz);
+
+		// whatever is in the segments is usable
+		stk_sz = sizeof( t_stack) +
+				( stack->num_segs << stack->seg_shift);
+		stack->alloc = opts->is_fixed ?
+				no_alloc_just_die :
+				seg_alloc_or_die ;
+		stack->release = seg_release;
+		stack->reserved = 0;
+		stack->mapped = 0;
+		stack->cow = NULL;
+		}  // add segments as needed?
+	else if ( opts->flags & BZA_OPT_RT_MASK)
+		{
+		stk_sz = BZA_ROUND_UP( stk_sz, map_unit( opts->flags) );
+		stack = map_block_or_die( catcher, opts->flags, stk_sz);
+
+		// whatever is mapped is usable
+		stack->mapped = stk_sz;
+		stack->alloc = opts->is_fixed ?
+				no_alloc_just_die :
+				map_alloc_or_die ;
+		stack->release = map_release;
+		stack->reserved = 0;
+		stack->cow = NULL;
+		}  // "real time" mapped block?
+	else if ( opts->flags & BZA_OPT_COW)
+		{
+		stk_sz = BZA_ROUND_UP( stk_sz, get_page_size() );
+		cow = cow_file_or_die( catcher, stk_sz);
+		stack = cow_map( cow, NULL, stk_sz, 1);
+		if ( stack == MAP_FAILED)
+			{
+			cow_unref( cow);
+			fail_or_die( catcher, "mmap failed");
+			return NULL;  // dummy
+			}  // no address space?
+
+		// whatever is mapped is usable
+		stack->mapped = stk_sz;
+		stack->cow = cow;
+		stack->cow_shared = 1;
+		stack->alloc = opts->is_fixed ?
+				no_alloc_just_die :
+				cow_alloc_or_die ;
+		stack->release = cow_release;
+		stack->reserved = 0;
+		}  // mapped from a memory file?
+	else
+		{
+		stack = alloc_or_die( catcher, NULL, stk_sz);
+		stack->alloc = opts->is_fixed ?
+				no_alloc_just_die :
+				alloc_or_die ;
+		stack->release = free_block;
+		stack->reserved = 0;
+		stack->mapped = 0;
+		stack->cow = NULL;
+		}  // plain heap block?
+
+	bza_init_stack( stack, stk_sz, opts);
+
+	fx = opts->is_fixed ? "fix" : "init";
+	MLOG_PRINTF( stderr, "*** STK: construct (%d b %s):\n", (int) stk_sz, fx);  // TEMP
+	bza_dump_stack( stack);  // TEMP
+	return stack;
+	}  // _________________________________________________________
+
+/**
+ * create a new (empty) child stack inside a frame of a parent stack,
+ *  for nested scopes.
+ */
+t_stack *				bza_cons_child_stack
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			parent,			// stack in which to carve the child
+	const
+	t_stack_opts *		opts			// construction options (null for
+										//  defaults);  "initial_size" is
+										//  the size of the frame,
+										//  "vm_reserve" and "seg_shift"
+										//  must be 0
+	)
+	{
+	static const
+	t_stack_opts		DEFAULT_OPTS;	// all 0s
+
+	size_t				stk_sz;
+	size_t				frame;
+	t_stack *			stack;
+
+	// TODO: better error handling
+	assert( parent != NULL);
+
+	if ( opts == NULL)
+		{
+		opts = &DEFAULT_OPTS;
+		}  // use defaults?
+
+	if ( ( opts->vm_reserve > 0) || ( opts->seg_shift > 0) )
+		{
+		fail_or_die( catcher, "child stack cannot be vm or segmented");
+		return NULL;  // dummy
+		}  // storage of its own?
+
+	if ( opts->flags & ( BZA_OPT_COW | BZA_OPT_RT_MASK) )
+		{
+		fail_or_die( catcher, "child stack must be plain");
+		return NULL;  // dummy
+		}  // storage the parent frame cannot provide?
+
+	if ( bza_may_relocate( parent) )
+		{
+		fail_or_die( catcher, "parent stack would be relocated");
+		return NULL;  // dummy
+		}  // child would be left behind?
+
+	stk_sz = ( opts->initial_size > sizeof( t_stack) ) ?
+			opts->initial_size : sizeof( t_stack);
+	bza_check_opts( catcher, opts, stk_sz);
+	frame = bza_cons_stk_frame( catcher, &parent, stk_sz);
+
+	// the whole frame is usable
+	stk_sz = bza_frame_size( parent, frame);
+	stack = (t_stack *) bza_fast_frame_ptr( parent, frame);
+	stack->alloc = opts->is_fixed ?
+			no_alloc_just_die :
+			child_alloc_or_die ;
+	stack->release = child_release;
+	stack->reserved = 0;
+	stack->mapped = 0;
+	stack->cow = NULL;
+	bza_init_stack( stack, stk_sz, opts);
+	stack->parent = parent;
+	stack->parent_frame = frame;
+	return stack;
+	}  // _________________________________________________________
+
+/** growth policy:  exactly what is needed (many reallocations!) */
+size_t					bza_grow_exact
+	(
+	size_t				cur_size,		// current usable size of stack
+	size_t				needed,			// minimum usable size required
+	size_t				grow_arg		// (ignored)
+	)
+	{
+	return needed;
+	}  // _________________________________________________________
+
+/** growth policy:  double the current size until large enough */
+size_t					bza_grow_double
+	(
+	size_t				cur_size,		// current usable size of stack
+	size_t				needed,			// minimum usable size required
+	size_t				grow_arg		// (ignored)
+	)
+	{
+	size_t				new_size;
+
+	new_size = ( cur_size > BZA_MIN_GROW) ? cur_size : BZA_MIN_GROW;
+	while ( new_size < needed)
+
+		{
+		if ( new_size > ( SIZE_MAX >> 1) )
+			{
+			return needed;
+			}  // doubling would overflow?
+
+		new_size <<= 1;
+		}  // double until big enough
+
+	return new_size;
+	}  // _________________________________________________________
+
+/** growth policy:  add 50% to the current size until large enough */
+size_t					bza_grow_half
+	(
+	size_t				cur_size,		// current usable size of stack
+	size_t				needed,			// minimum usable size required
+	size_t				grow_arg		// (ignored)
+	)
+	{
+	size_t				new_size;
+
+	new_size = ( cur_size > BZA_MIN_GROW) ? cur_size : BZA_MIN_GROW;
+	while ( new_size < needed)
+
+		{
+		if ( new_size > ( SIZE_MAX - ( new_size >> 1) ) )
+			{
+			return needed;
+			}  // growing would overflow?
+
+		new_size += ( new_size >> 1);
+		}  // grow by half until big enough
+
+	return new_size;
+	}  // _________________________________________________________
+
+/** growth policy:  round up to a multiple of a fixed chunk size */
+size_t					bza_grow_chunk
+	(
+	size_t				cur_size,		// current usable size of stack
+	size_t				needed,			// minimum usable size required
+	size_t				grow_arg		// chunk size (0 for default)
+	)
+	{
+	size_t				chunk;
+
+	chunk = ( grow_arg > 0) ? grow_arg : BZA_DEF_CHUNK;
+	if ( needed > ( SIZE_MAX - ( chunk - 1) ) )
+		{
+		return needed;
+		}  // rounding up would overflow?
+
+	return ( ( needed + chunk - 1) / chunk) * chunk;
+	}  // _________________________________________________________
+
+/** [re]allocate the stack to the given usable size */
+static
+void					bza_resize_stack
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack * *			a_stack,		// a stack to be resized
+										// (which may be relocated!)
+	size_t				new_size		// new usable size
+	)
+	{
+	void *				ptr;
+	size_t				sz;
+	size_t				old_sz;
+
+	if ( ( ( *a_stack)->flags & BZA_OPT_OFF32) && ( new_size > UINT32_MAX) )
+		{
+		fail_or_die( catcher, "stack too big for 32 bit offsets");
+		return;  // dummy
+		}  // offsets would not fit?
+
+	if ( new_size > ( SIZE_MAX - sizeof( t_stack) ) )
+		{
+		fail_or_die( catcher, "stack too big");
+		return;  // dummy
+		}  // size with housekeeping would overflow?
+
+	// (more excess debug visibility vars)
+	ptr = *a_stack;
+	old_sz = ( *a_stack)->size + sizeof( t_stack);
+	sz = new_size + sizeof( t_stack);
+	ptr = ( ( *a_stack)->alloc)( catcher, ptr, sz);
+	if ( ( ptr != (void *) *a_stack) &&
+		 ( ( (t_stack *) ptr)->alloc != map_alloc_or_die) &&
+		 ( ( (t_stack *) ptr)->alloc != cow_alloc_or_die) )
+		{
+		( (t_stack *) ptr)->bytes_copied += old_sz;
+		}  // moved (copied) elsewhere?
+	// (mapped stacks are moved by mremap, and count any copy themselves)
+
+	*a_stack = ptr;
+	( *a_stack)->size = new_size;
+	( *a_stack)->num_grows++;
+	BZA_TRACE( *a_stack, BZA_EV_GROW, 0, new_size);
+	}  // _________________________________________________________
+
+/**
+ * grow the stack so that it has at least "needed" usable bytes,
+ *  asking the stack's growth policy how much to actually get.
+ */
+static
+void					bza_grow_stack
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack * *			a_stack,		// a stack to be expanded
+										// (which may be relocated!)
+	size_t				needed			// minimum usable size required
+	)
+	{
+	size_t				new_size;
+
+	new_size = ( ( *a_stack)->grow)( ( *a_stack)->size, needed,
+			( *a_stack)->grow_arg);
+	if ( new_size < needed)
+		{
+		new_size = needed;
+		}  // policy (callback) came up short?
+
+	if ( ( ( *a_stack)->flags & BZA_OPT_OFF32) &&
+		 ( new_size > UINT32_MAX) && ( needed <= UINT32_MAX) )
+		{
+		new_size = UINT32_MAX & ~( (size_t) BZA_ALIGN - 1);
+		if ( new_size < needed)
+			{
+			new_size = needed;
+			}  // (just short of the limit)
+
+		}  // policy overshot the 32 bit limit?
+
+	bza_resize_stack( catcher, a_stack, new_size);
+	}  // _________________________________________________________
+
+/**
+ * make sure that the stack can hold at least "size" bytes
+ *  (frames + overhead) without further reallocation.
+ */
+void					bza_reserve
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack * *			a_stack,		// a stack to be expanded
+										// (which may be relocated!)
+	size_t				size			// usable size needed
+	)
+	{
+	// TODO: better error handling
+	assert( a_stack != NULL);
+	assert( *a_stack != NULL);
+
+	if ( size > ( *a_stack)->size)
+		{
+		// exact size:  the caller knows what is coming
+		bza_resize_stack( catcher, a_stack, size);
+		}  // need more room?
+
+	}  // _________________________________________________________
+
+/**
+ * shrink a stack's storage to what its frames use,
+ *  but no smaller than "keep" usable bytes;
+ *  return the number of usable bytes given up.
+ */
+size_t					bza_trim
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack * *			a_stack,		// a stack to be trimmed
+										// (which may be relocated!)
+	size_t				keep			// usable size to keep, at least
+	)
+	{
+	size_t				old_size;
+	size_t				new_size;
+
+	// TODO: better error handling
+	assert( a_stack != NULL);
+	assert( *a_stack != NULL);
+
+	old_size = ( *a_stack)->size;
+	new_size = ( ( *a_stack)->top > keep) ? ( *a_stack)->top : keep;
+	if ( ( ( *a_stack)->alloc == no_alloc_just_die) ||
+		 ( ( *a_stack)->alloc == child_alloc_or_die) ||
+		 ( new_size >= old_size) )
+		{
+		return 0;  // === done ===
+		}  // fixed size, child (a smaller frame would only add to the
+		   //  parent), or nothing to give up?
+
+	bza_resize_stack( catcher, a_stack, new_size);
+	return old_size - new_size;
+	}  // _________________________________________________________
+
+/**
+ * return the size to which a BZA_OPT_AUTO_TRIM stack which is using
+ *  less than a quarter of its size should be trimmed:
+ *  twice what it needs (but not below its initial size).
+ *  Trim only if this is below its current size.
+ */
+static inline
+size_t					bza_auto_trim_keep
+	(
+	t_stack *			stack,			// a stack to be trimmed,
+										//  not null!
+	size_t				needed			// usable size needed now
+	)
+	{
+	size_t				keep;
+
+	keep = needed << 1;
+	keep = ( keep > stack->trim_floor) ? keep : stack->trim_floor;
+	return ( keep > BZA_TRIM_MIN) ? keep : BZA_TRIM_MIN;
+	}  // _________________________________________________________
+
+/** free up a stack (run any needed / practical cleanup) */
+void					bza_dest_stack
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack * *			a_stack			// a stack to be torn down
+	)
+	{
+	// TODO: better error handling
+	assert( a_stack != NULL);
+	assert( *a_stack != NULL);
+
+	free( ( *a_stack)->trace);
+	free( ( *a_stack)->marks);
+	( ( *a_stack)->release)( catcher, *a_stack);
+	*a_stack = NULL;
+	}  // _________________________________________________________
+
+/**
+ * drop every frame on the stack, regardless of reference counts,
+ *  but keep the space for reuse.
+ */
+void					bza_reset_stack
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack			// a stack to be emptied
+	)
+	{
+	// TODO: better error handling
+	assert( a_stack != NULL);
+	BZA_TRACE( a_stack, BZA_EV_RESET, 0, 0);
+	BZA_RECORD( a_stack, BZA_EV_RESET, 0, 0);
+
+	a_stack->top = 0;
+	a_stack->num_marks = 0;
+	memset( a_stack->holes, 0, sizeof( a_stack->holes) );
+	a_stack->hole_map = 0;
+	a_stack->num_holes = 0;
+	a_stack->hole_bytes = 0;
+	memset( a_stack->slabs, 0, sizeof( a_stack->slabs) );
+	a_stack->stats_stale = 0;
+	a_stack->live_frames = 0;
+	a_stack->live_bytes = 0;
+	memset( a_stack->size_hist, 0, sizeof( a_stack->size_hist) );
+	memset( a_stack->slot_counts, 0, sizeof( a_stack->slot_counts) );
+	}  // _________________________________________________________
+
+/** return a checkpoint for bza_release_to (the current top of stack) */
+size_t					bza_mark
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack			// a stack to be checkpointed
+	)
+	{
+	size_t				top;
+
+	// TODO: better error handling
+	assert( a_stack != NULL);
+
+	// (remember it, so bza_release_to can tell if it went stale)
+	top = a_stack->top;
+	if ( ( top > 0) &&
+		 ( ( a_stack->num_marks == 0) ||
+		   ( a_stack->marks[ a_stack->num_marks - 1 ] < top) ) )
+		{
+		if ( a_stack->num_marks == a_stack->max_marks)
+			{
+			a_stack->max_marks = ( a_stack->max_marks > 0) ?
+					( a_stack->max_marks << 1) : 8;
+			a_stack->marks = alloc_or_die( catcher, a_stack->marks,
+					a_stack->max_marks * sizeof( size_t) );
+			}  // need more room?
+
+		a_stack->marks[ a_stack->num_marks++ ] = top;
+		}  // new checkpoint?
+
+	return top;
+	}  // _________________________________________________________
+
+/** return true if a checkpoint is still good (see bza_drop_marks) */
+static
+int						bza_mark_ok
+	(
+	t_stack *			stack,			// a stack to be checked,
+										//  not null!
+	size_t				mark			// checkpoint from bza_mark
+	)
+	{
+	size_t				idx;
+
+	if ( ( mark == 0) || ( mark == stack->top) )
+		{
+		return 1;  // === done ===
+		}  // everything, or nothing?
+
+	// (most likely a recent one, so search from the end)
+	for ( idx = stack->num_marks; idx > 0; idx--)
+
+		{
+		if ( stack->marks[ idx - 1 ] <= mark)
+			{
+			return stack->marks[ idx - 1 ] == mark;  // === done ===
+			}  // reached it (or passed it)?
+
+		}  // each checkpoint, newest first
+
+	return 0;
+	}  // _________________________________________________________
+
+/**
+ * slab header, at the start of a (normal) frame carved into slots
+ *  of one size class;  the slabs of a class form a ring,
+ *  with the ones that have room first.
+ */
+typedef struct			t_slab
+	{
+	size_t				self;			// marker offset of this slab's frame
+	size_t				next;			// next slab in ring (marker offset)
+	size_t				prev;			// previous slab in ring
+	uint32_t			free;			// first free slot (offset in slab),
+										//  0 if none
+	uint32_t			carved;			// offset of first never used slot
+	uint32_t			cls;			// size class
+	uint32_t			num_live;		// slots in use
+	}					t_slab;
+
+/** where the first slot goes in a slab (slot payloads stay aligned) */
+#define BZA_SLAB_HDR	BZA_ROUND_UP( sizeof( t_slab), BZA_ALIGN)
+
+/**
+ * return the slab header of the slab frame (marker) at the given offset.
+ *  WARNING:  this is a volatile value,
+ *  which will often be invalidated by a stack resize.
+ */
+static  // inline?
+t_slab *				bza_get_slab
+	(
+	t_stack *			stack,			// a stack to be accessed,
+										//  not null!
+	size_t				slab_off		// marker offset of a slab frame
+	)
+	{
+	return (t_slab *) bza_addr( stack,
+			slab_off - bza_frame_size( stack, slab_off) );
+	}  // _________________________________________________________
+
+/**
+ * return the slot header for a slot handle.
+ *  WARNING:  this is a volatile value,
+ *  which will often be invalidated by a stack resize.
+ */
+static  // inline?
+t_slot *				bza_get_slot
+	(
+	t_stack *			stack,			// a stack to be accessed,
+										//  not null!
+	size_t				slot			// slot handle (tagged payload offset)
+	)
+	{
+	return (t_slot *) bza_addr( stack,
+			( slot & ~BZA_SLOT_TAG) - sizeof( t_slot) );
+	}  // _________________________________________________________
+
+/** return the size class for a payload size, or -1 if too big */
+static  // inline?
+int						bza_slab_class
+	(
+	size_t				frame_sz		// size of frame, excluding overhead
+	)
+	{
+	int					cls;
+
+	for ( cls = 0; cls < BZA_SLAB_CLASSES; cls++)
+
+		{
+		if ( frame_sz <= ( BZA_SLAB_MIN << cls) )
+			{
+			return cls;  // === found ===
+			}  // fits?
+
+		}  // check each class
+
+	return -1;
+	}  // _________________________________________________________
+
+/** return true if a slab has a free (or never used) slot */
+static  // inline?
+int						bza_slab_has_room
+	(
+	t_stack *			stack,			// a stack to be accessed,
+										//  not null!
+	t_slab *			slab			// slab to be checked
+	)
+	{
+	return ( slab->free != 0) ||
+			( ( slab->carved + sizeof( t_slot) + ( BZA_SLAB_MIN << slab->cls) ) <=
+			  bza_frame_size( stack, slab->self) );
+	}  // _________________________________________________________
+
+/** take a slab out of its class's ring */
+static
+void					bza_unlink_slab
+	(
+	t_stack *			stack,			// a stack to be updated,
+										//  not null!
+	size_t				slab_off		// marker offset of the slab frame
+	)
+	{
+	t_slab *			slab;
+	int					cls;
+
+	slab = bza_get_slab( stack, slab_off);
+	cls = slab->cls;
+	if ( slab->next == slab_off)
+		{
+		stack->slabs[ cls ] = 0;
+		return;  // === done ===
+		}  // only one?
+
+	bza_get_slab( stack, slab->prev)->next = slab->next;
+	bza_get_slab( stack, slab->next)->prev = slab->prev;
+	if ( stack->slabs[ cls ] == slab_off)
+		{
+		stack->slabs[ cls ] = slab->next;
+		}  // was first?
+
+	}  // _________________________________________________________
+
+/** put a slab at the front of its class's ring */
+static
+void					bza_push_slab
+	(
+	t_stack *			stack,			// a stack to be updated,
+										//  not null!
+	size_t				slab_off		// marker offset of the slab frame
+	)
+	{
+	t_slab *			slab;
+	t_slab *			first;
+	size_t				first_off;
+
+	slab = bza_get_slab( stack, slab_off);
+	first_off = stack->slabs[ slab->cls ];
+	if ( first_off == 0)
+		{
+		slab->next = slab->prev = slab_off;
+		}  // only one?
+	else
+		{
+		first = bza_get_slab( stack, first_off);
+		slab->next = first_off;
+		slab->prev = first->prev;
+		bza_get_slab( stack, first->prev)->next = slab_off;
+		first->prev = slab_off;
+		}  // join the others
+
+	stack->slabs[ slab->cls ] = slab_off;
+	}  // _________________________________________________________
+
+/**
+ * create a frame in a slot of the given size class
+ *  (adding a slab if needed), return its (tagged) handle,
+ *  or 0 if slabs won't fit in the stack's segments.
+ */
+static
+size_t					bza_cons_slot
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack * *			a_stack,		// a stack on/in which to
+										// allocate the frame
+										// (which may be relocated!)
+	int					cls				// size class
+	)
+	{
+	size_t				stride;
+	size_t				slab_off;
+	size_t				slab_sz;
+	size_t				seg_size;
+	t_slab *			slab;
+	size_t				slot_rel;
+	t_slot *			slot;
+	FILE *				record;
+
+	stride = sizeof( t_slot) + ( BZA_SLAB_MIN << cls);
+	slab_off = ( *a_stack)->slabs[ cls ];
+	if ( ( slab_off == 0) ||
+		 ! bza_slab_has_room( *a_stack, bza_get_slab( *a_stack, slab_off) ) )
+		{
+		slab_sz = BZA_SLAB_BYTES;
+		if ( ( *a_stack)->seg_shift != 0)
+			{
+			seg_size = ( (size_t) 1) << ( *a_stack)->seg_shift;
+			if ( ( slab_sz + bza_hdr_sz( *a_stack) + BZA_ALIGN) > seg_size)
+				{
+				slab_sz = seg_size - ( bza_hdr_sz( *a_stack) + BZA_ALIGN);
+				}  // shrink to fit?
+
+			if ( slab_sz < ( BZA_SLAB_HDR + stride) )
+				{
+				return 0;  // === skip ===
+				}  // not worth it?
+
+			}  // must fit in a segment?
+
+		// (only the slots are recorded, as they are what is replayed)
+		record = ( *a_stack)->record;
+		( *a_stack)->record = NULL;
+		slab_off = bza_cons_stk_frame_aligned( catcher, a_stack, slab_sz,
+				BZA_ALIGN);
+		( *a_stack)->record = record;
+		slab = bza_get_slab( *a_stack, slab_off);
+		slab->self = slab_off;
+		slab->free = 0;
+		slab->carved = BZA_SLAB_HDR;
+		slab->cls = cls;
+		slab->num_live = 0;
+		bza_push_slab( *a_stack, slab_off);
+		}  // need a new slab?
+
+	slab = bza_get_slab( *a_stack, slab_off);
+	if ( slab->free != 0)
+		{
+		slot_rel = slab->free;
+		slot = (t_slot *) ( ( (char *) slab) + slot_rel);
+		slab->free = slot->link;
+		}  // reuse a freed slot?
+	else
+		{
+		slot_rel = slab->carved;
+		slot = (t_slot *) ( ( (char *) slab) + slot_rel);
+		slab->carved += stride;
+		}  // carve a new one
+
+	slot->back = slot_rel;
+	slot->ref_cnt = 1;
+	slab->num_live++;
+	( *a_stack)->slot_counts[ cls ]++;
+	if ( ! bza_slab_has_room( *a_stack, slab) )
+		{
+		// (the ring is only walked from the front, this goes to the back)
+		( *a_stack)->slabs[ cls ] = slab->next;
+		}  // now full?
+
+	return ( ( slab_off - bza_frame_size( *a_stack, slab_off) ) +
+			slot_rel + sizeof( t_slot) ) | BZA_SLOT_TAG;
+	}  // _________________________________________________________
+
+/** free a slot with no remaining references */
+static
+void					bza_dest_slot
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack,		// a stack on/in which
+										// the frame is allocated
+	size_t				handle			// slot handle
+	)
+	{
+	t_slot *			slot;
+	t_slab *			slab;
+	size_t				slab_off;
+	int					was_full;
+	FILE *				record;
+
+	slot = bza_get_slot( a_stack, handle);
+	slab = (t_slab *) ( ( (char *) slot) - slot->back);
+	slab_off = slab->self;
+	was_full = ! bza_slab_has_room( a_stack, slab);
+	slot->link = slab->free;
+	slab->free = slot->back;
+	slab->num_live--;
+	a_stack->slot_counts[ slab->cls ]--;
+
+	if ( ( slab->num_live == 0) && ( slab->next != slab_off) )
+		{
+		bza_unlink_slab( a_stack, slab_off);
+		record = a_stack->record;
+		a_stack->record = NULL;
+		bza_deref_stk_frame( catcher, a_stack, slab_off);
+		a_stack->record = record;
+		}  // empty, and not the last of its class (keep one handy)?
+	else if ( was_full)
+		{
+		bza_unlink_slab( a_stack, slab_off);
+		bza_push_slab( a_stack, slab_off);
+		}  // room again:  move to the front?
+
+	}  // _________________________________________________________
+
+/** forget slabs at or above a checkpoint (they are being discarded) */
+static
+void					bza_drop_slabs
+	(
+	t_stack *			stack,			// a stack to be updated,
+										//  not null!
+	size_t				mark			// checkpoint
+	)
+	{
+	int					cls;
+	size_t				slab_off;
+	size_t				next_off;
+	size_t				num_slabs;
+
+	for ( cls = 0; cls < BZA_SLAB_CLASSES; cls++)
+
+		{
+		slab_off = stack->slabs[ cls ];
+		if ( slab_off == 0)
+			{
+			continue;  // === skip ===
+			}  // no slabs?
+
+		num_slabs = 0;
+		do
+
+			{
+			num_slabs++;
+			slab_off = bza_get_slab( stack, slab_off)->next;
+			}  while ( slab_off != stack->slabs[ cls ]);
+			// count each slab
+
+		for ( ; num_slabs > 0; num_slabs--)
+
+			{
+			// (unlinking leaves this slab's own links alone)
+			next_off = bza_get_slab( stack, slab_off)->next;
+			if ( slab_off >= mark)
+				{
+				bza_unlink_slab( stack, slab_off);
+				}  // discarded?
+
+			slab_off = next_off;
+			}  // check each slab, once
+
+		}  // each size class
+
+	}  // _________________________________________________________
+
+/** translate the slab rings of a stack after compaction */
+static
+void					bza_remap_slabs
+	(
+	t_stack *			stack,			// a stack to be updated,
+										//  not null!
+	const
+	t_remap *			remap			// translation from bza_compact
+	)
+	{
+	int					cls;
+	size_t				slab_off;
+	size_t				first_off;
+	t_slab *			slab;
+
+	for ( cls = 0; cls < BZA_SLAB_CLASSES; cls++)
+
+		{
+		first_off = bza_remap_off( remap, stack->slabs[ cls ]);
+		stack->slabs[ cls ] = first_off;
+		if ( first_off == 0)
+			{
+			continue;  // === skip ===
+			}  // no slabs?
+
+		slab_off = first_off;
+		do
+
+			{
+			slab = bza_get_slab( stack, slab_off);
+			slab->self = slab_off;
+			slab->next = bza_remap_off( remap, slab->next);
+			slab->prev = bza_remap_off( remap, slab->prev);
+			slab_off = slab->next;
+			}  while ( slab_off != first_off);
+			// translate each slab, once
+
+		}  // each size class
+
+	}  // _________________________________________________________
+
+/**
+ * drop every frame allocated above the checkpoint, regardless of
+ *  reference counts, without visiting them.
+ *  Every hole is looked at, to find the ones above the checkpoint.
+ */
+void					bza_release_to
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack,		// a stack to be cut back
+	size_t				mark			// checkpoint from bza_mark
+	)
+	{
+	size_t				hdr_sz;
+	size_t				new_top;
+	size_t				hole;
+	size_t				next;
+	size_t				hole_start;
+	int					bucket;
+
+	// TODO: better error handling
+	assert( a_stack != NULL);
+	BZA_TRACE( a_stack, BZA_EV_RELEASE, mark, 0);
+	BZA_RECORD( a_stack, BZA_EV_RELEASE, mark, 0);
+
+	if ( ! bza_mark_ok( a_stack, mark) )
+		{
+		fail_or_die( catcher, "stale checkpoint");
+		return;  // dummy
+		}  // above the top, or the top dropped below it since?
+
+	bza_drop_slabs( a_stack, mark);
+	if ( mark < a_stack->top)
+		{
+		a_stack->stats_stale = 1;
+		}  // dropping frames unseen (recount when asked)?
+
+	// forget the holes above the checkpoint
+	hdr_sz = bza_hdr_sz( a_stack);
+	new_top = mark;
+	for ( bucket = 0; bucket < BZA_HOLE_BUCKETS; bucket++)
+
+		{
+		for ( hole = a_stack->holes[ bucket ]; hole != 0; hole = next)
+
+			{
+			next = bza_get_hole_link( a_stack, hole,
+					bza_frame_size( a_stack, hole), 1);
+			if ( hole < mark)
+				{
+				continue;  // === skip ===
+				}  // kept?
+
+			hole_start = hole - bza_frame_size( a_stack, hole);
+			if ( hole_start < new_top)
+				{
+				// merged with dead space below the checkpoint:  drop it all
+				new_top = hole_start;
+				}  // straddles the checkpoint?
+
+			bza_pop_hole( a_stack, hole);
+			}  // check each hole in the list
+
+		}  // each size bucket
+
+	// don't leave a hole on top
+	while ( ( new_top > 0) &&
+			( bza_frame_flags( a_stack, new_top - hdr_sz) & BZA_IS_HOLE) )
+
+		{
+		hole = new_top - hdr_sz;
+		new_top = hole - bza_frame_size( a_stack, hole);
+		bza_pop_hole( a_stack, hole);
+		}  // uncovered a hole?
+
+	a_stack->top = new_top;
+	if ( new_top > 0)
+		{
+		bza_set_frame_flags( a_stack, new_top - hdr_sz, BZA_ABOVE_BITS, 0);
+		}  // (nothing above the top frame now)
+
+	bza_drop_marks( a_stack);
+	}  // _________________________________________________________
+
+/**
+ * return where a frame's payload may start, at or above "start":
+ *  in a segmented stack, a frame which would span two segments
+ *  moves up to the start of the next one,
+ *  and a frame which would leave too little at the end of its segment
+ *  for another frame is enlarged to fill it.
+ */
+static
+size_t					bza_seg_fit
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			stack,			// a stack to be allocated from,
+										//  not null!
+	size_t				start,			// first available offset
+	size_t *			frame_sz		// size of frame, excluding overhead
+										//  (may be enlarged)
+	)
+	{
+	size_t				hdr_sz;
+	size_t				seg_size;
+	size_t				seg_end;
+	size_t				frame_end;
+	size_t				tail;
+
+	if ( stack->seg_shift == 0)
+		{
+		return start;  // === done ===
+		}  // contiguous?
+
+	hdr_sz = bza_hdr_sz( stack);
+	seg_size = ( (size_t) 1) << stack->seg_shift;
+	if ( ( *frame_sz + hdr_sz) > seg_size)
+		{
+		fail_or_die( catcher, "frame too big for segment");
+		}  // can never fit?
+
+	seg_end = ( start | ( seg_size - 1) ) + 1;
+	frame_end = start + *frame_sz + hdr_sz;
+	if ( frame_end > seg_end)
+		{
+		start = seg_end;
+		frame_end = start + *frame_sz + hdr_sz;
+		seg_end += seg_size;
+		}  // move up to next segment?
+
+	tail = seg_end - frame_end;
+	if ( ( tail > 0) &&
+		 ( tail < ( hdr_sz + BZA_MIN_FRAME) ) )
+		{
+		*frame_sz += tail;
+		}  // sliver left over?
+
+	return start;
+	}  // _________________________________________________________
+
+/**
+ * mark the space from "start" up to "end" as a dead frame (hole),
+ *  just above the given frame, return the new frame's (marker) offset.
+ */
+static
+size_t					bza_add_filler
+	(
+	t_stack *			stack,			// a stack to be updated,
+										//  not null!
+	size_t				prev_off,		// offset of frame below
+	size_t				start,			// start of filler
+	size_t				end				// end of filler (including overhead)
+	)
+	{
+	size_t				filler_off;
+
+	filler_off = end - bza_hdr_sz( stack);
+	bza_set_frame( stack, filler_off, filler_off - start, 0, prev_off);
+	bza_add_hole( stack, filler_off);
+	return filler_off;
+	}  // _________________________________________________________
+
+/**
+ * create a new frame on a shared stack, holding its lock:
+ *  an error is passed on to the caller's handler once unlocked.
+ */
+static
+size_t					bza_cons_locked
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack * *			a_stack,		// a (shared) stack on/in which to
+										// allocate the frame
+	size_t				frame_sz,		// size of frame, excluding overhead
+	size_t				align			// required payload alignment,
+										//  a power of 2
+	)
+	{
+	jmp_buf				inner;
+	int					taken;
+	size_t				frame_off;
+
+	taken = bza_lock( *a_stack);
+	if ( setjmp( inner) )
+		{
+		bza_unlock( *a_stack, taken);
+		fail_or_die( catcher, "shared cons failed");
+		return 0;  // dummy
+		}  // failed (with the lock held)?
+
+	frame_off = bza_cons_stk_frame_aligned( &inner, a_stack, frame_sz, align);
+	bza_unlock( *a_stack, taken);
+	return frame_off;
+	}  // _________________________________________________________
+
+/** create a new frame on the stack (set reference count to 1) */
+size_t					bza_cons_stk_frame
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack * *			a_stack,		// a stack on/in which to
+										// allocate the frame
+										// (which may be relocated!)
+	size_t				frame_sz		// size of frame, excluding overhead
+	)
+	{
+	return bza_cons_stk_frame_aligned( catcher, a_stack, frame_sz, BZA_ALIGN);
+	}  // _________________________________________________________
+
+/**
+ * create a new frame on the stack (set reference count to 1),
+ *  with its payload address a multiple of "align".
+ * Alignments past BZA_ALIGN hold only until the stack is relocated
+ *  or compacted,
+ *  so they are for vm and segmented stacks, in practice.
+ */
+size_t					bza_cons_stk_frame_aligned
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack * *			a_stack,		// a stack on/in which to
+										// allocate the frame
+										// (which may be relocated!)
+	size_t				frame_sz,		// size of frame, excluding overhead
+	size_t				align			// required payload alignment,
+										//  a power of 2
+	)
+	{
+	size_t				cur_marker_off;
+	size_t				next_marker_off;
+	size_t				next_top;
+	size_t				next_size;
+	size_t				frame_start;
+	size_t				slack;
+	size_t				pad;
+	size_t				fit_sz;
+	size_t				hdr_sz;
+	int					cls;
+	size_t				req_sz;
+	size_t				keep;
+
+	// TODO: better error handling
+	assert( a_stack != NULL);
+	assert( *a_stack != NULL);
+	assert( frame_sz >= 0);
+	req_sz = frame_sz;
+
+	if ( ( ( *a_stack)->flags & BZA_OPT_SHARED) && ( bza_held != *a_stack) )
+		{
+		return bza_cons_locked( catcher, a_stack, frame_sz, align);
+		// === done ===
+		}  // shared, and not locked yet?
+
+	if ( ( align == 0) || ( ( align & ( align - 1) ) != 0) )
+		{
+		fail_or_die( catcher, "alignment not a power of 2");
+		}  // nonsense?
+
+	if ( ( ( *a_stack)->flags & BZA_OPT_SLAB) &&
+		 ( align <= BZA_ALIGN) &&
+		 ( ( cls = bza_slab_class( frame_sz) ) >= 0) )
+		{
+		next_marker_off = bza_cons_slot( catcher, a_stack, cls);
+		if ( next_marker_off != 0)
+			{
+			BZA_TRACE( *a_stack, BZA_EV_CONS, next_marker_off, frame_sz);
+			BZA_RECORD( *a_stack, BZA_EV_CONS, next_marker_off, req_sz);
+			return next_marker_off;  // === done ===
+			}  // got a slot?
+
+		}  // small enough for a slab?
+
+	hdr_sz = bza_hdr_sz( *a_stack);
+	if ( frame_sz > ( bza_max_frame( *a_stack) - ( hdr_sz + BZA_ALIGN) ) )
+		{
+		fail_or_die( catcher, "frame too big for marker");
+		}  // can't record the size?
+
+	// TODO:  call (make) stack-walk dumping routine
+
+	// keep every payload (and marker) aligned, and leave room for a hole link
+	frame_sz = BZA_ROUND_UP( frame_sz + hdr_sz, BZA_ALIGN) - hdr_sz;
+
+	if ( align <= BZA_ALIGN)
+		{
+		align = BZA_ALIGN;
+		slack = 0;
+		}  // every frame is already that aligned?
+	else
+		{
+		// room to push the payload up past a filler frame
+		slack = align + hdr_sz + BZA_MIN_FRAME;
+		}  // need to pad?
+
+	if ( ( slack == 0) &&
+		 ( ( *a_stack)->hole_map != 0) &&
+		 ! ( ( *a_stack)->flags & BZA_OPT_NO_HOLE_REUSE) )
+		{
+		next_marker_off = bza_take_hole( *a_stack, frame_sz);
+		if ( next_marker_off != 0)
+			{
+			BZA_TRACE( *a_stack, BZA_EV_CONS, next_marker_off, frame_sz);
+			BZA_RECORD( *a_stack, BZA_EV_CONS, next_marker_off, req_sz);
+			return next_marker_off;  // === done ===
+			}  // found a fit?
+
+		}  // try to reuse a dead frame?
+
+	// "overname" stuff, let the C optimizer strip out redundancy
+
+	// current, before we added something:
+	cur_marker_off = bza_get_top_frame_marker_offset( *a_stack);
+
+	// where will the payload go (normally, right at the top):
+	fit_sz = frame_sz + slack;
+	frame_start = bza_seg_fit( catcher, *a_stack, ( *a_stack)->top, &fit_sz);
+
+	// how big must stack be to hold new payload + overhead (worst case):
+	next_size = frame_start + fit_sz + hdr_sz;
+
+	if ( next_size > ( *a_stack)->size)
+		{
+		bza_grow_stack( catcher, a_stack, next_size);
+		}  // new "high water" mark?
+	else if ( ( ( *a_stack)->flags & BZA_OPT_AUTO_TRIM) &&
+			  ( next_size < ( ( *a_stack)->size >> 2) ) &&
+			  ( ( keep = bza_auto_trim_keep( *a_stack, next_size) ) <
+					( *a_stack)->size) )
+		{
+		bza_trim( catcher, a_stack, keep);
+		}  // spike over:  give back the excess?
+	// else:  use/reuse existing space
+
+	if ( slack == 0)
+		{
+		frame_sz = fit_sz;
+		}  // normal case:  no padding
+	else
+		{
+		// the address is only known after any growth (relocation)
+		pad = ( - (size_t) bza_addr( *a_stack, frame_start) ) & ( align - 1);
+		if ( ( pad > 0) && ( pad < ( hdr_sz + BZA_MIN_FRAME) ) )
+			{
+			pad += align;
+			}  // too small for a filler frame?
+
+		frame_start += pad;
+		frame_start = bza_seg_fit( catcher, *a_stack, frame_start, &frame_sz);
+		}  // pad up to alignment?
+
+	if ( frame_start != ( *a_stack)->top)
+		{
+		cur_marker_off = bza_add_filler( *a_stack, cur_marker_off,
+				( *a_stack)->top, frame_start);
+		}  // skipped the end of a segment, or padding?
+
+	// where will bookkeeping for next frame go:
+	next_marker_off = frame_start + frame_sz;
+
+	// where will the next payload (on subsequent call) go:
+	next_top = next_marker_off + hdr_sz;
+
+	bza_set_top( *a_stack, next_top);
+
+	// (prev is 0 for first thing added)
+	bza_set_frame( *a_stack, next_marker_off, frame_sz, 1, cur_marker_off);
+	bza_tally_frame( *a_stack, frame_sz, 1);
+	BZA_TRACE( *a_stack, BZA_EV_CONS, next_marker_off, frame_sz);
+	BZA_RECORD( *a_stack, BZA_EV_CONS, next_marker_off, req_sz);
+	return next_marker_off;
+	}  // _________________________________________________________
+
+/**
+ * create several new frames on the stack (each with a reference count of 1)
+ *  with a single capacity check (or best fit hole search),
+ *  putting their offsets in "offs".
+ * Frames that may not simply be laid out together (slabs, segments)
+ *  are made one at a time, as by bza_cons_stk_frame.
+ */
+void					bza_cons_stk_frames
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack * *			a_stack,		// a stack on/in which to
+										// allocate the frames
+										// (which may be relocated!)
+	const
+	size_t *			sizes,			// size of each frame, excluding overhead
+	size_t				num,			// number of frames
+	size_t *			offs			// offset of each new frame (output)
+	)
+	{
+	size_t				hdr_sz;
+	size_t				idx;
+	size_t				frame_sz;
+	size_t				total;
+	size_t				prev_off;
+	size_t				start;
+	size_t				end;
+	size_t				keep;
+	size_t				above;
+
+	// TODO: better error handling
+	assert( a_stack != NULL);
+	assert( *a_stack != NULL);
+	assert( ( sizes != NULL) && ( offs != NULL) );
+
+	if ( ( num == 0) ||
+		 ( ( *a_stack)->seg_shift != 0) ||
+		 ( ( *a_stack)->flags &
+				( BZA_OPT_SLAB | BZA_OPT_NO_BATCH | BZA_OPT_SHARED) ) )
+		{
+		for ( idx = 0; idx < num; idx++)
+
+			{
+			offs[ idx ] = bza_cons_stk_frame( catcher, a_stack, sizes[ idx ]);
+			}  // make each frame
+
+		return;  // === done ===
+		}  // not simply laid out together?
+
+	// the whole batch, as if one frame (with one marker)
+	hdr_sz = bza_hdr_sz( *a_stack);
+	total = 0;
+	for ( idx = 0; idx < num; idx++)
+
+		{
+		if ( sizes[ idx ] > ( bza_max_frame( *a_stack) - ( hdr_sz + BZA_ALIGN) ) )
+			{
+			fail_or_die( catcher, "frame too big for marker");
+			}  // can't record the size?
+
+		total += BZA_ROUND_UP( sizes[ idx ] + hdr_sz, BZA_ALIGN);
+		}  // add up each frame, with overhead
+
+	total -= hdr_sz;
+
+	end = 0;
+	above = 0;
+	if ( ( ( *a_stack)->hole_map != 0) &&
+		 ! ( ( *a_stack)->flags & BZA_OPT_NO_HOLE_REUSE) &&
+		 ( total <= bza_max_frame( *a_stack) ) )
+		{
+		end = bza_take_hole( *a_stack, total);
+		}  // try to reuse a dead frame?
+
+	if ( end != 0)
+		{
+		// (the last frame gets any extra space in the hole)
+		start = end - bza_frame_size( *a_stack, end);
+		prev_off = bza_frame_prev( *a_stack, end);
+		above = bza_frame_flags( *a_stack, end) & BZA_ABOVE_BITS;
+		}  // fits in a hole?
+	else
+		{
+		if ( ( ( *a_stack)->top + total + hdr_sz) > ( *a_stack)->size)
+			{
+			bza_grow_stack( catcher, a_stack, ( *a_stack)->top + total + hdr_sz);
+			}  // new "high water" mark?
+		else if ( ( ( *a_stack)->flags & BZA_OPT_AUTO_TRIM) &&
+				  ( ( ( *a_stack)->top + total + hdr_sz) <
+						( ( *a_stack)->size >> 2) ) &&
+				  ( ( keep = bza_auto_trim_keep( *a_stack,
+						( *a_stack)->top + total + hdr_sz) ) <
+						( *a_stack)->size) )
+			{
+			bza_trim( catcher, a_stack, keep);
+			}  // spike over:  give back the excess?
+
+		start = ( *a_stack)->top;
+		prev_off = bza_get_top_frame_marker_offset( *a_stack);
+		end = start + total;
+		bza_set_top( *a_stack, end + hdr_sz);
+		}  // on top
+
+	for ( idx = 0; idx < num; idx++)
+
+		{
+		frame_sz = ( idx < ( num - 1) ) ?
+				( BZA_ROUND_UP( sizes[ idx ] + hdr_sz, BZA_ALIGN) - hdr_sz) :
+				( end - start);
+		offs[ idx ] = start + frame_sz;
+		bza_set_frame( *a_stack, offs[ idx ], frame_sz, 1, prev_off);
+		bza_tally_frame( *a_stack, frame_sz, 1);
+		BZA_TRACE( *a_stack, BZA_EV_CONS, offs[ idx ], frame_sz);
+		BZA_RECORD( *a_stack, BZA_EV_CONS, offs[ idx ], sizes[ idx ]);
+		prev_off = offs[ idx ];
+		start = prev_off + hdr_sz;
+		}  // lay out each frame
+
+	// (laying out the last frame cleared its marker's note of a hole above)
+	if ( above)
+		{
+		bza_set_frame_flags( *a_stack, end, BZA_ABOVE_BITS, above);
+		}  // the rest of a split hole, or an older one?
+
+	}  // _________________________________________________________
+
+/** reference a frame on the stack (increment reference count) */
+void					bza_ref_stk_frame
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack,		// a stack on/in which 
+										// the frame is allocated
+	size_t				stk_frame_off	// offset of stack frame
+	)
+	{
+	int *				ref_cnt;
+
+	// TODO: better error handling
+	assert( a_stack != NULL);
+
+	// increment count
+	ref_cnt = bza_frame_refs( a_stack, stk_frame_off);
+	assert( *ref_cnt > 0);
+	if ( a_stack->flags & BZA_OPT_SHARED)
+		{
+		// (the caller already holds a reference:  no ordering needed)
+		__atomic_add_fetch( ref_cnt, 1, __ATOMIC_RELAXED);
+		}  // other threads may be counting too?
+	else
+		{
+		( *ref_cnt)++;
+		}  // just this thread
+
+	BZA_TRACE( a_stack, BZA_EV_REF, stk_frame_off, *ref_cnt);
+	BZA_RECORD( a_stack, BZA_EV_REF, stk_frame_off, *ref_cnt);
+
+	// TODO: check for counter overflow?
+	}  // _________________________________________________________
+
+/**
+ * free a frame with no remaining references:
+ *  pop it (and any dead frames beneath it) if on top,
+ *  else leave it as a hole.
+ */
+static
+void					bza_free_frame
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack,		// a stack on/in which
+										// the frame is allocated
+	size_t				stk_frame_off	// offset of stack frame
+	)
+	{
+	size_t				marker_off;
+	size_t				prev_off;
+
+	if ( stk_frame_off & BZA_SLOT_TAG)
+		{
+		bza_dest_slot( catcher, a_stack, stk_frame_off);
+		return;  // === done ===
+		}  // slab slot?
+
+	bza_tally_frame( a_stack, bza_frame_size( a_stack, stk_frame_off), 0);
+	if ( stk_frame_off != bza_get_top_frame_marker_offset( a_stack) )
+		{
+		bza_add_hole( a_stack, stk_frame_off);
+		return;  // === done ===
+		}  // frame not top-most?
+
+	// so, the top frame has no remaining references, pop all we can:
+
+	for ( marker_off = bza_get_top_frame_marker_offset( a_stack);
+		  marker_off != 0;
+		  marker_off = prev_off)
+
+		{
+		// (on a shared stack, a dead frame which is not a hole yet
+		//  is left to the thread which is about to free it)
+		if ( ( __atomic_load_n( bza_frame_refs( a_stack, marker_off),
+					__ATOMIC_ACQUIRE) > 0) ||
+			 ( ( marker_off != stk_frame_off) &&
+			   ! ( bza_frame_flags( a_stack, marker_off) & BZA_IS_HOLE) ) )
+			{
+			break;  // === done ===
+			}  // still in use?
+
+		if ( marker_off != stk_frame_off)
+			{
+			prev_off = bza_pop_hole( a_stack, marker_off);
+			}  // uncovered a hole?
+		else
+			{
+			prev_off = bza_frame_prev( a_stack, marker_off);
+			}  // the frame itself
+
+		// discard *this* frame
+		a_stack->top = ( prev_off > 0) ?
+			( prev_off + bza_hdr_sz( a_stack) ) : 0;
+		}  // walk down each frame
+
+	if ( marker_off != 0)
+		{
+		bza_set_frame_flags( a_stack, marker_off, BZA_ABOVE_BITS, 0);
+		}  // (nothing above the top frame now)
+
+	bza_drop_marks( a_stack);
+	}  // _________________________________________________________
+
+/** de-reference a frame on the stack (decrement reference count) */
+void					bza_deref_stk_frame
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack,		// a stack on/in which 
+										// the frame is allocated
+	size_t				stk_frame_off	// offset of stack frame
+	)
+	{
+	int *				ref_cnt;
+	int					cnt;
+	int					taken;
+
+	// TODO: better error handling
+	assert( a_stack != NULL);
+
+	// decrement count
+	ref_cnt = bza_frame_refs( a_stack, stk_frame_off);
+	assert( *ref_cnt > 0);
+	if ( a_stack->flags & BZA_OPT_SHARED)
+		{
+		// (release:  this thread is done with the frame before it is freed)
+		cnt = __atomic_sub_fetch( ref_cnt, 1, __ATOMIC_RELEASE);
+		}  // other threads may be counting too?
+	else
+		{
+		cnt = --( *ref_cnt);
+		}  // just this thread
+
+	BZA_TRACE( a_stack, BZA_EV_DEREF, stk_frame_off, cnt);
+	BZA_RECORD( a_stack, BZA_EV_DEREF, stk_frame_off, cnt);
+	if ( cnt > 0)
+		{
+		return;  // === done ===
+		}  // frame still in use?
+
+	if ( a_stack->flags & BZA_OPT_SHARED)
+		{
+		// (acquire:  every other thread is done with the frame, too)
+		__atomic_thread_fence( __ATOMIC_ACQUIRE);
+		taken = bza_lock( a_stack);
+		bza_free_frame( catcher, a_stack, stk_frame_off);
+		bza_unlock( a_stack, taken);
+		return;  // === done ===
+		}  // shared?
+
+	bza_free_frame( catcher, a_stack, stk_frame_off);
+	}  // _________________________________________________________
+
+/** return the reference count of the indicated block */
+int						bza_get_ref_count
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack,		// a stack on/in which 
+										// the frame is allocated
+	size_t				stk_frame_off	// offset of stack frame
+	)
+	{
+	int					cnt;
+
+	// TODO: better error handling
+	assert( a_stack != NULL);
+
+	cnt = *bza_frame_refs( a_stack, stk_frame_off);
+	return cnt;
+	}  // _________________________________________________________
+
+/**
+ * return the number of bytes (including overhead) stranded in dead frames
+ *  which cannot be popped because a live frame sits on top of them.
+ */
+size_t					bza_get_stranded_bytes
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack			// a stack to be measured
+	)
+	{
+	// TODO: better error handling
+	assert( a_stack != NULL);
+
+	return a_stack->hole_bytes;
+	}  // _________________________________________________________
+
+/** walk the stack and slabs to recount the live statistics */
+static
+void					bza_recount_stats
+	(
+	t_stack *			stack			// a stack to be updated,
+										//  not null!
+	)
+	{
+	size_t				marker_off;
+	int					cls;
+	size_t				first_off;
+	size_t				slab_off;
+	t_slab *			slab;
+
+	stack->live_frames = 0;
+	stack->live_bytes = 0;
+	memset( stack->size_hist, 0, sizeof( stack->size_hist) );
+	for ( marker_off = bza_get_top_frame_marker_offset( stack);
+		  marker_off != 0;
+		  marker_off = bza_frame_prev( stack, marker_off))
+
+		{
+		if ( *bza_frame_refs( stack, marker_off) > 0)
+			{
+			bza_tally_frame( stack, bza_frame_size( stack, marker_off), 1);
+			}  // live?
+
+		}  // count each frame
+
+	memset( stack->slot_counts, 0, sizeof( stack->slot_counts) );
+	for ( cls = 0; cls < BZA_SLAB_CLASSES; cls++)
+
+		{
+		first_off = stack->slabs[ cls ];
+		if ( first_off == 0)
+			{
+			continue;  // === skip ===
+			}  // no slabs?
+
+		slab_off = first_off;
+		do
+
+			{
+			slab = bza_get_slab( stack, slab_off);
+			stack->slot_counts[ cls ] += slab->num_live;
+			slab_off = slab->next;
+			}  while ( slab_off != first_off);
+			// count each slab, once
+
+		}  // each size class
+
+	stack->stats_stale = 0;
+	}  // _________________________________________________________
+
+/**
+ * fill in a snapshot of the stack's statistics,
+ *  recounting the live frames if some were dropped unseen.
+ */
+void					bza_get_stats
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack,		// a stack to be measured
+	t_stack_stats *		stats			// statistics (output)
+	)
+	{
+	int					cls;
+
+	// TODO: better error handling
+	assert( a_stack != NULL);
+	assert( stats != NULL);
+
+	if ( a_stack->stats_stale)
+		{
+		bza_recount_stats( a_stack);
+		}  // frames dropped unseen?
+
+	stats->live_frames = a_stack->live_frames;
+	stats->live_bytes = a_stack->live_bytes;
+	stats->live_slots = 0;
+	stats->slot_bytes = 0;
+	for ( cls = 0; cls < BZA_SLAB_CLASSES; cls++)
+
+		{
+		stats->slot_hist[ cls ] = a_stack->slot_counts[ cls ];
+		stats->live_slots += a_stack->slot_counts[ cls ];
+		stats->slot_bytes += a_stack->slot_counts[ cls ] * ( BZA_SLAB_MIN << cls);
+		}  // each size class
+
+	stats->stranded_bytes = a_stack->hole_bytes;
+	stats->num_holes = a_stack->num_holes;
+	stats->top = a_stack->top;
+	stats->size = a_stack->size;
+	stats->high_water = a_stack->high_water;
+	stats->num_grows = a_stack->num_grows;
+	stats->bytes_copied = a_stack->bytes_copied;
+	memcpy( stats->size_hist, a_stack->size_hist, sizeof( stats->size_hist) );
+	}  // _________________________________________________________
+
+/**
+ * start recording allocator events for the stack in a ring buffer
+ *  holding the most recent "num_events" (rounded up to a power of 2),
+ *  replacing any previous ring.
+ */
+void					bza_trace_on
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack,		// a stack to be traced
+	size_t				num_events		// ring buffer size
+	)
+	{
+	size_t				num_slots;
+	t_trace *			trace;
+
+	// TODO: better error handling
+	assert( a_stack != NULL);
+
+	num_slots = 16;
+	while ( num_slots < num_events)
+
+		{
+		num_slots <<= 1;
+		}  // round up to a power of 2
+
+	trace = alloc_or_die( catcher, NULL,
+			sizeof( t_trace) + ( num_slots * sizeof( t_trace_ev) ) );
+	trace->mask = num_slots - 1;
+	trace->head = 0;
+	trace->nsec0 = bza_nsec();
+	trace->ticks0 = bza_ticks();
+
+	free( a_stack->trace);
+	a_stack->trace = trace;
+	}  // _________________________________________________________
+
+/** stop recording allocator events, and discard the ring buffer */
+void					bza_trace_off
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack			// a stack being traced
+	)
+	{
+	// TODO: better error handling
+	assert( a_stack != NULL);
+
+	free( a_stack->trace);
+	a_stack->trace = NULL;
+	}  // _________________________________________________________
+
+/**
+ * write the recorded events (oldest first) to a file,
+ *  after a t_trace_hdr;  recording continues.
+ */
+void					bza_trace_save
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack,		// a stack being traced
+	FILE *				out				// file to write to
+	)
+	{
+	t_trace *			trace;
+	t_trace_hdr			hdr;
+	uint64_t			head;
+	uint64_t			seq;
+	uint64_t			nsec;
+	uint64_t			ticks;
+
+	// TODO: better error handling
+	assert( a_stack != NULL);
+	assert( out != NULL);
+
+	trace = a_stack->trace;
+	if ( trace == NULL)
+		{
+		fail_or_die( catcher, "stack is not being traced");
+		return;  // === abort ===
+		}  // nothing to save?
+
+	// rate of the time stamps, measured over the trace so far
+	nsec = bza_nsec();
+	ticks = bza_ticks();
+
+	head = __atomic_load_n( &( trace->head), __ATOMIC_ACQUIRE);
+	memcpy( hdr.magic, BZA_TRACE_MAGIC, sizeof( hdr.magic) );
+	hdr.first = ( head > ( trace->mask + 1) ) ? ( head - ( trace->mask + 1) ) : 0;
+	hdr.num = head - hdr.first;
+	hdr.ticks0 = trace->ticks0;
+	hdr.ticks_per_ns = ( nsec > trace->nsec0) ?
+			( (double) ( ticks - trace->ticks0) / ( nsec - trace->nsec0) ) :
+			1.0;
+	if ( fwrite( &hdr, sizeof( hdr), 1, out) != 1)
+		{
+		fail_or_die( catcher, "trace header write failed");
+		return;  // === abort ===
+		}  // write error?
+
+	for ( seq = hdr.first; seq < head; seq++)
+
+		{
+		if ( fwrite( &( trace->evs[ seq & trace->mask ]),
+				sizeof( t_trace_ev), 1, out) != 1)
+			{
+			fail_or_die( catcher, "trace event write failed");
+			return;  // === abort ===
+			}  // write error?
+
+		}  // write each event, oldest first
+
+	}  // _________________________________________________________
+
+/**
+ * start writing every frame construction, reference and dereference
+ *  (plus resets, releases and compactions) on the stack to a file.
+ */
+void					bza_record_on
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack,		// a stack to be recorded
+	FILE *				out				// file to write to
+	)
+	{
+	t_record_hdr		hdr;
+
+	// TODO: better error handling
+	assert( a_stack != NULL);
+	assert( out != NULL);
+
+	memcpy( hdr.magic, BZA_RECORD_MAGIC, sizeof( hdr.magic) );
+	hdr.flags = a_stack->flags;
+	if ( fwrite( &hdr, sizeof( hdr), 1, out) != 1)
+		{
+		fail_or_die( catcher, "recording header write failed");
+		return;  // === abort ===
+		}  // write error?
+
+	a_stack->record = out;
+	}  // _________________________________________________________
+
+/**
+ * stop recording, and flush the file,
+ *  raising any error from writing the events.
+ */
+void					bza_record_off
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack			// a stack being recorded
+	)
+	{
+	FILE *				out;
+
+	// TODO: better error handling
+	assert( a_stack != NULL);
+
+	out = a_stack->record;
+	a_stack->record = NULL;
+	if ( ( out != NULL) &&
+		 ( ( fflush( out) != 0) || ferror( out) ) )
+		{
+		fail_or_die( catcher, "recording write failed");
+		}  // lost some events?
+
+	}  // _________________________________________________________
+
+/** write a compaction (and the frames it moved) to a recording */
+static
+void					bza_record_compact
+	(
+	FILE *				out,			// recording, not null!
+	const
+	t_remap *			remap			// translation from bza_compact
+	)
+	{
+	t_record_move		move;
+	size_t				idx;
+
+	bza_record_ev( out, BZA_EV_COMPACT, 0, remap->num);
+	for ( idx = 0; idx < remap->num; idx++)
+
+		{
+		move.old_off = remap->ents[ idx ].old_off;
+		move.new_off = remap->ents[ idx ].new_off;
+		fwrite( &move, sizeof( move), 1, out);
+		}  // write each move
+
+	}  // _________________________________________________________
+
+/**
+ * Slide all live frames down over any dead frames beneath them,
+ *  and return the translation of old to new frame offsets.
+ *  (Not while child stacks live in the stack's frames:
+ *  their frames would move under them.)
+ */
+t_remap *				bza_compact
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack			// a stack to be compacted
+	)
+	{
+	size_t				num_frames;
+	size_t				marker_off;
+	t_remap *			remap;
+	size_t				idx;
+	size_t				frame_sz;
+	int					ref_cnt;
+	size_t				new_sz;
+	size_t				start;
+	size_t				dst;
+	size_t				prev_off;
+
+	// TODO: better error handling
+	assert( a_stack != NULL);
+
+	num_frames = 0;
+	for ( marker_off = bza_get_top_frame_marker_offset( a_stack);
+		  marker_off != 0;
+		  marker_off = bza_frame_prev( a_stack, marker_off))
+
+		{
+		num_frames++;
+		}  // count each frame
+
+	// list the frames bottom up, in the space for the translation
+	remap = alloc_or_die( catcher, NULL,
+			sizeof( t_remap) + ( num_frames * sizeof( t_remap_ent) ) );
+	idx = num_frames;
+	for ( marker_off = bza_get_top_frame_marker_offset( a_stack);
+		  marker_off != 0;
+		  marker_off = bza_frame_prev( a_stack, marker_off))
+
+		{
+		remap->ents[ --idx ].old_off = marker_off;
+		}  // note each frame
+
+	// slide the live ones down (dead ones are only ever in holes)
+	remap->num = 0;
+	dst = 0;
+	prev_off = 0;
+	memset( a_stack->holes, 0, sizeof( a_stack->holes) );
+	a_stack->hole_map = 0;
+	a_stack->num_holes = 0;
+	a_stack->hole_bytes = 0;
+	for ( idx = 0; idx < num_frames; idx++)
+
+		{
+		marker_off = remap->ents[ idx ].old_off;
+		ref_cnt = *bza_frame_refs( a_stack, marker_off);
+		if ( ref_cnt == 0)
+			{
+			continue;  // === skip ===
+			}  // dead?
+
+		frame_sz = bza_frame_size( a_stack, marker_off);
+		new_sz = frame_sz;
+		start = bza_seg_fit( catcher, a_stack, dst, &new_sz);
+		if ( start != ( marker_off - frame_sz) )
+			{
+			memmove( bza_addr( a_stack, start),
+					bza_addr( a_stack, marker_off - frame_sz),
+					frame_sz);
+			a_stack->bytes_copied += frame_sz;
+			}  // something to close up?
 
-    You should have received a copy of the GNU Lesser General Public License
-    along with this program.  If not, see <http://www.gnu.org/licenses/>.
- */
+		if ( start != dst)
+			{
+			prev_off = bza_add_filler( a_stack, prev_off, dst, start);
+			}  // skipped the end of a segment?
 
-#include <malloc.h>
-#include <assert.h>
-#include <stdio.h>
+		remap->ents[ remap->num ].old_off = marker_off;
+		remap->ents[ remap->num ].new_off = start + new_sz;
+		remap->ents[ remap->num ].shift = start - ( marker_off - frame_sz);
+		bza_set_frame( a_stack, start + new_sz, new_sz, ref_cnt, prev_off);
+		prev_off = start + new_sz;
+		dst = prev_off + bza_hdr_sz( a_stack);
+		remap->num++;
+		}  // move each live frame
 
-#include "bzrt_alloc.h"
+	a_stack->top = dst;
+	a_stack->num_marks = 0;  // (frames moved under them)
+	bza_remap_slabs( a_stack, remap);
 
-// #define DO_LOG	1
-#include "_log.h"
+	// (segment end slivers may have been folded into frames)
+	a_stack->stats_stale = 1;
 
-/** stack frame marker */
-typedef struct 			t_frame_marker
-	{
-	size_t				size;			// size of this stack frame,
-										//  usable space, excluding overhead
-	int					ref_cnt;		// reference count
-	// TODO: remove redundant field (size vs prev offset)
-	size_t				prev_off;		// offset to previous frame
-	}					t_frame_marker;
+	BZA_TRACE( a_stack, BZA_EV_COMPACT, dst, remap->num);
+	if ( a_stack->record != NULL)
+		{
+		bza_record_compact( a_stack->record, remap);
+		}  // recording?
 
-/** return offset of marker structure for top frame */
-static  // inline?
-size_t					bza_get_top_frame_marker_offset
-	(
-	t_stack *			stack			// a stack to be accessed,
-										//  not null!
-	)
-	{
-	// the frame marker is just underneathh the stack top, unless empty
-	return ( stack->top > sizeof( t_frame_marker) ) ?
-			( stack->top - sizeof( t_frame_marker) ) : 0;
+	return remap;
 	}  // _________________________________________________________
 
 /**
- * Return marker structure for indicated frame.
- *  WARNING:  this is a volatile value,
- *  which will often be invalidated by a stack resize.
+ * return the new offset of a frame moved by bza_compact
+ *  (0 if the given offset was not a live frame);
+ *  slab slots move with their slab.
  */
-static  // inline?
-t_frame_marker *		bza_get_frame_marker
+size_t					bza_remap_off
 	(
-	t_stack *			stack,			// a stack to be displayed,
-										//  not null!
-	size_t				marker_off		// offset to desired frame marker
+	const
+	t_remap *			remap,			// translation from bza_compact
+	size_t				old_off			// frame offset before compaction
 	)
 	{
-	if ( marker_off == 0)
-		{
-		return NULL;  // === skip ===
-		}  // empty?
+	size_t				low;
+	size_t				high;
+	size_t				mid;
+	size_t				slot;
 
-	return (t_frame_marker *) &( stack->data[ marker_off ]);
-	}  // _________________________________________________________
+	assert( remap != NULL);
 
-// TODO: macro to enable / disable
-/** dump stack / heap structure */
-static
-void					bza_dump_stack
-	(
-	t_stack *			stack			// a stack to be displayed
-	)
-	{
-	size_t				marker_off;
-	t_frame_marker *	cur_marker;
+	slot = 0;
+	if ( old_off & BZA_SLOT_TAG)
+		{
+		// look for the slab (marker) just above the slot
+		slot = old_off & ~BZA_SLOT_TAG;
+		old_off = slot + 1;
+		}  // slab slot?
+
+	// binary search:  the entries are in (old) offset order
+	low = 0;
+	high = remap->num;
+	while ( low < high)
 
-	if ( stack == NULL)
 		{
-		MLOG_PRINTF( stderr, "No stack!");
-		return;  // === done ===
-		}  // no stack???
+		mid = low + ( ( high - low) >> 1);
+		if ( remap->ents[ mid ].old_off < old_off)
+			{
+			low = mid + 1;
+			}  // look higher?
+		else
+			{
+			high = mid;
+			}  // look lower (or here)?
 
-	MLOG_PRINTF( stderr, "STK: %d bytes @ %x\n",
-			(int) stack->size, (int) stack);
-	for ( marker_off = bza_get_top_frame_marker_offset( stack);
-		  marker_off != 0;
-		  marker_off = cur_marker->prev_off)
+		}  // narrow down each half
 
+	if ( slot != 0)
 		{
-		cur_marker = bza_get_frame_marker( stack, marker_off);
-		MLOG_PRINTF( stderr, "\tFRM: %d b, %d refs (prev %d) @ %d\n",
-				(int) cur_marker->size,
-				(int) cur_marker->ref_cnt,
-				(int) cur_marker->prev_off,
-				(int) marker_off);
-		}  // dump each frame
+		return ( low < remap->num) ?
+				( ( slot + remap->ents[ low ].shift) | BZA_SLOT_TAG) : 0;
+		}  // slab slot?
 
+	return ( ( low < remap->num) && ( remap->ents[ low ].old_off == old_off) ) ?
+			remap->ents[ low ].new_off : 0;
 	}  // _________________________________________________________
 
-/** create a new (empty) stack */
-t_stack *				bza_cons_stack
+/** free up the translation returned by bza_compact */
+void					bza_dest_remap
 	(
-	jmp_buf *			catcher			// error handler (or null for immediate death)
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_remap * *			a_remap			// translation to be freed
 	)
 	{
-	return bza_cons_stack_rt( catcher, 0, 0);
+	// TODO: better error handling
+	assert( a_remap != NULL);
+
+	free( *a_remap);
+	*a_remap = NULL;
 	}  // _________________________________________________________
 
 /**
- * allocate the requested amount of memory,
- * possibly resizing an existing block
- * TODO:  set policy for releasing existing block if realloc fails.
+ * save the frames of a (contiguous) stack to a new file,
+ *  with a t_save_hdr, for bza_map_stack.
  */
-static
-void *					alloc_or_die
+void					bza_save_stack
 	(
 	jmp_buf *			catcher,		// error handler (or null for immediate death)
-	void *				existing,		// existing block (if not null)
-	size_t				new_size		// number of bytes requested
+	t_stack *			a_stack,		// a stack to be saved
+	size_t				root,			// offset of a root frame (e.g. a
+										//  table) to be returned by
+										//  bza_map_stack (or 0)
+	int					fd				// file descriptor of a new,
+										//  empty file (not closed)
 	)
 	{
-	void *				new_blk;
+	t_save_hdr			hdr;
+	int					cls;
+	int					bucket;
 
-	// TODO: determine if alloc is thread safe
-	new_blk = realloc( existing, new_size);
-	if ( new_blk != NULL)
+	// TODO: better error handling
+	assert( a_stack != NULL);
+
+	if ( a_stack->seg_shift != 0)
 		{
-		return new_blk;  // === done ===
-		}  // it worked?
+		fail_or_die( catcher, "segmented stack can't be saved");
+		}  // frames not in one piece?
+
+	memset( &hdr, 0, sizeof( hdr) );
+	memcpy( hdr.magic, BZA_SAVE_MAGIC, sizeof( hdr.magic) );
+	hdr.version = BZA_SAVE_VERSION;
+	hdr.word_size = sizeof( size_t);
+	hdr.flags = a_stack->flags & ~( BZA_OPT_RT_MASK | BZA_OPT_SHARED);
+	hdr.root = root;
+	hdr.top = a_stack->top;
+	for ( bucket = 0; bucket < BZA_HOLE_BUCKETS; bucket++)
 
-	if ( catcher != NULL)
 		{
-		longjmp( *catcher, 1);  // === abort ===
-		}  // error handler?
+		hdr.holes[ bucket ] = a_stack->holes[ bucket ];
+		}  // each hole list
+
+	hdr.num_holes = a_stack->num_holes;
+	hdr.hole_bytes = a_stack->hole_bytes;
+	for ( cls = 0; cls < BZA_SLAB_CLASSES; cls++)
+
+		{
+		hdr.slabs[ cls ] = a_stack->slabs[ cls ];
+		}  // each size class
+
+	// (the gap after the header is left as a hole in the file)
+	if ( ( cow_write( fd, &hdr, sizeof( hdr), 0) != 0) ||
+		 ( cow_write( fd, a_stack->data, a_stack->top, BZA_SAVE_DATA_OFF)
+				!= 0) )
+		{
+		fail_or_die( catcher, "write failed");
+		}  // disk full, etc?
 
-	// just die, then
-	assert( new_blk != NULL);
-	return NULL;  // dummy
 	}  // _________________________________________________________
 
-/**
- * ALWAYS FAIL to allocate memory,
- * TODO:  set policy for releasing existing block if realloc fails.
- */
+/** release a stack from bza_map_stack */
 static
-void *					no_alloc_just_die
+void					saved_release
 	(
 	jmp_buf *			catcher,		// error handler (or null for immediate death)
-	void *				existing,		// existing block (if not null)
-	size_t				new_size		// number of bytes requested
+	void *				existing		// existing block
 	)
 	{
-	if ( catcher != NULL)
-		{
-		MLOG_PUTS( "\tResize not allowed\n");
-		longjmp( *catcher, 1);  // === abort ===
-		}  // error handler?
+	size_t				hdr_len;
 
-	// just die, then
-	assert( "Resize not allowed" == NULL);
-	return NULL;  // dummy
+	// the housekeeping fields sit at the end of their own page(s)
+	hdr_len = BZA_ROUND_UP( sizeof( t_stack), get_page_size() );
+	munmap( ( (t_stack *) existing)->data - hdr_len,
+			( (t_stack *) existing)->mapped);
 	}  // _________________________________________________________
 
-/** create a new (empty) stack, with "real time" support options */
-t_stack *				bza_cons_stack_rt
+/**
+ * return true if an offset read from a saved stack could be a frame
+ *  in it:  0 (none), or in range and aligned as a marker (or,
+ *  if allowed, a slot handle) would be.
+ */
+static
+int						bza_saved_off_ok
 	(
-	jmp_buf *			catcher,		// error handler (or null for immediate death)
-	size_t				initial_size,	// initial size of stack
-	int					is_fixed		// true if fixed to "initial" size
+	t_stack *			stack,			// the mapped stack, not null!
+	uint64_t			off,			// offset from the file header
+	int					may_be_slot		// true if a slot handle is OK
 	)
 	{
-	size_t				stk_sz;
-	t_stack *			stack;
-	const char *		fx;
+	size_t				hdr_sz;
 
-	stk_sz = ( initial_size > sizeof( t_stack) ) ?
-			initial_size : sizeof( t_stack);
-	stack = alloc_or_die( catcher, NULL, stk_sz);
-
-	// TODO: define boundary better, so I can recognize an empty stack
+	if ( off == 0)
+		{
+		return 1;  // === done ===
+		}  // none?
 
-	stack->size = stk_sz;
-	stack->top = 0;
-	stack->alloc = is_fixed ?
-			no_alloc_just_die :
-			alloc_or_die ;
+	if ( off & BZA_SLOT_TAG)
+		{
+		off &= ~BZA_SLOT_TAG;
+		return may_be_slot &&
+				( off < stack->top) && ( ( off % BZA_ALIGN) == 0);
+		}  // slot handle (payload offset)?
 
-	fx = is_fixed ? "fix" : "init";
-	MLOG_PRINTF( stderr, "*** STK: construct (%d b %s):\n", (int) stk_sz, fx);  // TEMP
-	bza_dump_stack( stack);  // TEMP
-	return stack;
+	hdr_sz = bza_hdr_sz( stack);
+	return ( off < stack->top) && ( ( stack->top - off) >= hdr_sz) &&
+			( ( ( off + hdr_sz) % BZA_ALIGN) == 0);
 	}  // _________________________________________________________
 
-/** free up a stack (run any needed / practical cleanup) */
-void					bza_dest_stack
+/**
+ * map a stack saved by bza_save_stack, return it (fixed size:
+ *  it cannot grow).
+ */
+t_stack *				bza_map_stack
 	(
 	jmp_buf *			catcher,		// error handler (or null for immediate death)
-	t_stack * *			a_stack			// a stack to be torn down
+	const
+	char *				path,			// saved stack file
+	int					writable,		// true for copy-on-write,
+										//  false for read-only
+	size_t *			a_root			// root frame offset given
+										//  to bza_save_stack (output,
+										//  may be null)
 	)
 	{
+	t_save_hdr			hdr;
+	t_stack_opts		opts;
+	int					fd;
+	size_t				hdr_len;
+	size_t				data_len;
+	char *				base;
+	t_stack *			stack;
+	struct stat			st;
+	int					cls;
+	int					bucket;
+	int					is_ok;
+
 	// TODO: better error handling
-	assert( a_stack != NULL);
-	assert( *a_stack != NULL);
+	assert( path != NULL);
 
-	free( *a_stack);
-	*a_stack = NULL;
-	}  // _________________________________________________________
+	fd = open( path, O_RDONLY);
+	if ( fd < 0)
+		{
+		fail_or_die( catcher, "open failed");
+		return NULL;  // dummy
+		}  // no such file?
 
-/** create a new frame on the stack (set reference count to 1) */
-size_t					bza_cons_stk_frame
-	(
-	jmp_buf *			catcher,		// error handler (or null for immediate death)
-	t_stack * *			a_stack,		// a stack on/in which to
-										// allocate the frame
-										// (which may be relocated!)
-	size_t				frame_sz		// size of frame, excluding overhead
-	)
-	{
-	size_t				cur_marker_off;
-	t_frame_marker *	cur_marker;
-	size_t				next_marker_off;
-	size_t				next_top;
-	size_t				next_size;
-	size_t				frame_start;
-	t_frame_marker *	marker;
-	void *				ptr;
-	size_t				sz;
+	if ( ( pread( fd, &hdr, sizeof( hdr), 0) != sizeof( hdr) ) ||
+		 ( memcmp( hdr.magic, BZA_SAVE_MAGIC, sizeof( hdr.magic) ) != 0) ||
+		 ( hdr.version != BZA_SAVE_VERSION) ||
+		 ( hdr.word_size != sizeof( size_t) ) )
+		{
+		close( fd);
+		fail_or_die( catcher, "not a saved stack (of this version)");
+		return NULL;  // dummy
+		}  // bad header?
 
-	// TODO: better error handling
-	assert( a_stack != NULL);
-	assert( *a_stack != NULL);
-	assert( frame_sz >= 0);
-	MLOG_PRINTF( stderr, "*** STK: alloc %d\n", (int) frame_sz);  // TEMP
-	bza_dump_stack( *a_stack);  // TEMP
+	// (pages past the end of the file would fault when touched)
+	if ( ( fstat( fd, &st) != 0) ||
+		 ( st.st_size < BZA_SAVE_DATA_OFF) ||
+		 ( ( (uint64_t) st.st_size - BZA_SAVE_DATA_OFF) < hdr.top) ||
+		 ( ( hdr.top % BZA_ALIGN) != 0) )
+		{
+		close( fd);
+		fail_or_die( catcher, "saved stack is truncated");
+		return NULL;  // dummy
+		}  // frames missing?
 
-	// TODO:  call (make) stack-walk dumping routine
+	// the housekeeping fields go in anonymous page(s) of their own,
+	//  just below the frames, which are mapped from the file
+	hdr_len = BZA_ROUND_UP( sizeof( t_stack), get_page_size() );
+	data_len = BZA_ROUND_UP( hdr.top, get_page_size() );
+	base = mmap( NULL, hdr_len + data_len, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if ( base == MAP_FAILED)
+		{
+		close( fd);
+		fail_or_die( catcher, "mmap failed");
+		return NULL;  // dummy
+		}  // no address space?
 
-	// "overname" stuff, let the C optimizer strip out redundancy
+	if ( ( data_len > 0) &&
+		 ( mmap( base + hdr_len, data_len,
+				writable ? ( PROT_READ | PROT_WRITE) : PROT_READ,
+				MAP_PRIVATE | MAP_FIXED, fd, BZA_SAVE_DATA_OFF) ==
+				MAP_FAILED) )
+		{
+		munmap( base, hdr_len + data_len);
+		close( fd);
+		fail_or_die( catcher, "mmap failed");
+		return NULL;  // dummy
+		}  // can't map the frames?
 
-	// current, before we added something:
-	cur_marker_off = bza_get_top_frame_marker_offset( *a_stack);
+	close( fd);  // (the mapping keeps the file)
 
-	// get the bookkeeping stuff (MIGHT BE RELOCATED!)
-	cur_marker = bza_get_frame_marker( *a_stack, cur_marker_off);
+	memset( &opts, 0, sizeof( opts) );
+	opts.is_fixed = 1;
+	opts.flags = (int) hdr.flags;
+	stack = (t_stack *) ( base + hdr_len - sizeof( t_stack) );
+	stack->alloc = no_alloc_just_die;
+	stack->release = saved_release;
+	stack->reserved = 0;
+	stack->mapped = hdr_len + data_len;
+	stack->cow = NULL;
+	bza_init_stack( stack, sizeof( t_stack) +
+			( writable ? data_len : hdr.top), &opts);
 
-	// where will bookkeeping for next frame go:
-	next_marker_off = ( cur_marker != NULL) ?
-			( frame_sz + ( *a_stack)->top) :
-			frame_sz;
+	stack->top = hdr.top;
+	stack->high_water = hdr.top;
 
-	// where will the next payload (on subsequent call) go:
-	next_top = next_marker_off + sizeof( t_frame_marker);
+	// offsets which are followed later must land on frames
+	is_ok = bza_saved_off_ok( stack, hdr.root, 1) &&
+			( hdr.hole_bytes <= hdr.top);
+	for ( bucket = 0; bucket < BZA_HOLE_BUCKETS; bucket++)
 
-	// how big must stack be to hold new payload + overhead:
-	next_size = next_top;
+		{
+		is_ok = is_ok && bza_saved_off_ok( stack, hdr.holes[ bucket ], 0);
+		}  // each hole list
 
-	frame_start = ( *a_stack)->top + sizeof( t_frame_marker);
+	for ( cls = 0; cls < BZA_SLAB_CLASSES; cls++)
 
-	// TODO:  fix excess reallocation
+		{
+		is_ok = is_ok && bza_saved_off_ok( stack, hdr.slabs[ cls ], 0);
+		}  // each size class
 
-	if ( next_size > ( *a_stack)->size)
+	if ( ! is_ok)
 		{
-		// TODO: minimize allocation calls
-		// grow stack
-		// (more excess debug visibility vars)
-		ptr = *a_stack;
-		sz = next_size + sizeof( t_stack);
-		ptr = ( ( *a_stack)->alloc)( catcher, ptr, sz);
-		*a_stack = ptr;
-		( *a_stack)->size = next_size;
-		}  // new "high water" mark?
-	// else:  use/reuse existing space
+		munmap( base, hdr_len + data_len);
+		fail_or_die( catcher, "saved stack is corrupt");
+		return NULL;  // dummy
+		}  // bad offset?
 
-	( *a_stack)->top = next_top;
+	for ( bucket = 0; bucket < BZA_HOLE_BUCKETS; bucket++)
 
-	marker = bza_get_frame_marker( *a_stack, next_marker_off);
-	marker->size = frame_sz;
-	marker->ref_cnt = 1;
-	marker->prev_off = cur_marker_off;  // 0 for first thing added
-	bza_dump_stack( *a_stack);  // TEMP
-	return next_marker_off;
+		{
+		stack->holes[ bucket ] = hdr.holes[ bucket ];
+		if ( hdr.holes[ bucket ] != 0)
+			{
+			stack->hole_map |= ( (uint32_t) 1) << bucket;
+			}  // list not empty?
+
+		}  // each hole list
+
+	stack->num_holes = hdr.num_holes;
+	stack->hole_bytes = hdr.hole_bytes;
+	for ( cls = 0; cls < BZA_SLAB_CLASSES; cls++)
+
+		{
+		stack->slabs[ cls ] = hdr.slabs[ cls ];
+		}  // each size class
+
+	stack->stats_stale = 1;  // (counted on demand, by bza_get_stats)
+
+	if ( a_root != NULL)
+		{
+		*a_root = hdr.root;
+		}  // root wanted?
+
+	return stack;
 	}  // _________________________________________________________
 
-/** reference a frame on the stack (increment reference count) */
-void					bza_ref_stk_frame
+/** clear the fields of a new clone which belong to the original alone */
+static
+void					bza_detach_clone
 	(
-	jmp_buf *			catcher,		// error handler (or null for immediate death)
-	t_stack *			a_stack,		// a stack on/in which 
-										// the frame is allocated
-	size_t				stk_frame_off	// offset of stack frame
+	t_stack *			clone			// a stack copied from another,
+										//  not null!
 	)
 	{
-	t_frame_marker *	marker;
+	clone->trace = NULL;
+	clone->record = NULL;
+	clone->marks = NULL;
+	clone->num_marks = 0;
+	clone->max_marks = 0;
+	clone->lock = 0;
+	clone->parent = NULL;
+	clone->parent_frame = 0;
+	}  // _________________________________________________________
 
-	// TODO: better error handling
-	assert( a_stack != NULL);
-	MLOG_PRINTF( stderr, "*** STK: ref frame off %d\n", (int) stk_frame_off);  // TEMP
-	bza_dump_stack( a_stack);  // TEMP
+/** clone a stack (other than a BZA_OPT_COW one) by copying it */
+static
+t_stack *				bza_copy_stack
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack			// a stack to be copied
+	)
+	{
+	t_stack_opts		opts;
+	t_stack				storage;
+	t_stack *			clone;
 
-	// increment count
-	marker = bza_get_frame_marker( a_stack, stk_frame_off);
-	assert( marker->ref_cnt > 0);
-	( marker->ref_cnt)++;
+	if ( a_stack->seg_shift != 0)
+		{
+		fail_or_die( catcher, "segmented stack can't be cloned");
+		return NULL;  // dummy
+		}  // frames not in one piece?
 
-	// TODO: check for counter overflow?
+	memset( &opts, 0, sizeof( opts) );
+	opts.initial_size = sizeof( t_stack) + a_stack->top;
+	opts.flags = ( a_stack->flags & ~( BZA_OPT_RT_MASK | BZA_OPT_SHARED) ) |
+			BZA_OPT_COW;
+	opts.grow = a_stack->grow;
+	opts.grow_arg = a_stack->grow_arg;
+	clone = bza_cons_stack_opts( catcher, &opts);
 
-	bza_dump_stack( a_stack);  // TEMP
+	// everything but the new storage comes from the original
+	storage = *clone;
+	memcpy( clone, a_stack, sizeof( t_stack) + a_stack->top);
+	clone->alloc = storage.alloc;
+	clone->release = storage.release;
+	clone->reserved = storage.reserved;
+	clone->mapped = storage.mapped;
+	clone->cow = storage.cow;
+	clone->cow_shared = storage.cow_shared;
+	clone->flags = storage.flags;
+	clone->size = storage.size;
+	clone->bytes_copied += a_stack->top;
+	bza_detach_clone( clone);
+	return clone;
 	}  // _________________________________________________________
 
-/** de-reference a frame on the stack (decrement reference count) */
-void					bza_deref_stk_frame
+/**
+ * return a logically independent copy of a (contiguous) stack,
+ *  sharing the pages of a BZA_OPT_COW stack copy-on-write.
+ */
+t_stack *				bza_clone_stack
 	(
 	jmp_buf *			catcher,		// error handler (or null for immediate death)
-	t_stack *			a_stack,		// a stack on/in which 
-										// the frame is allocated
-	size_t				stk_frame_off	// offset of stack frame
+	t_stack *			a_stack			// a stack to be cloned
 	)
 	{
-	t_frame_marker *	marker;
-	size_t				marker_off;
-	t_frame_marker *	cur_marker;
+	t_cow_file *		old_cow;
+	t_stack *			clone;
 
 	// TODO: better error handling
 	assert( a_stack != NULL);
-	MLOG_PRINTF( stderr, "*** STK: deref frame off %d\n", (int) stk_frame_off);  // TEMP
-	bza_dump_stack( a_stack);  // TEMP
 
-	// decrement count
-	marker = bza_get_frame_marker( a_stack, stk_frame_off);
-	assert( marker->ref_cnt > 0);
-	( marker->ref_cnt)--;
-	if ( marker->ref_cnt > 0)
+	if ( a_stack->cow == NULL)
 		{
-		return;  // === done ===
-		}  // frame still in use?
+		return bza_copy_stack( catcher, a_stack);  // === done ===
+		}  // nothing to share?
 
-	if ( stk_frame_off != bza_get_top_frame_marker_offset( a_stack) )
+	// first, the file must hold the stack as it is (and stay so)
+	old_cow = NULL;
+	if ( a_stack->cow_shared)
 		{
-		return;  // === done ===
-		}  // frame not top-most?
+		// (written through to the file, so far:  from now on, neither is)
+		a_stack->cow_shared = 0;
+		}  // first clone?
+	else if ( __atomic_load_n( &( a_stack->cow->refs), __ATOMIC_ACQUIRE) == 1)
+		{
+		if ( cow_write_back( a_stack) != 0)
+			{
+			fail_or_die( catcher, "write failed");
+			}  // no room?
 
-	// so, the top frame has no remaining references, pop all we can:
+		}  // earlier clones all gone:  just bring the file up to date?
+	else
+		{
+		old_cow = a_stack->cow;
+		a_stack->cow = cow_file_or_die( catcher, a_stack->mapped);
+		if ( cow_write( a_stack->cow->fd, a_stack, a_stack->mapped, 0) != 0)
+			{
+			cow_unref( a_stack->cow);
+			a_stack->cow = old_cow;
+			fail_or_die( catcher, "write failed");
+			}  // no room?
 
-	for ( marker_off = bza_get_top_frame_marker_offset( a_stack);
-		  marker_off != 0;
-		  marker_off = cur_marker->prev_off)
+		}  // the file is still shared with another clone:  start another
 
+	// the same contents, from the file (any private copies are dropped)
+	if ( cow_map( a_stack->cow, a_stack, a_stack->mapped, 0) == MAP_FAILED)
 		{
-		cur_marker = bza_get_frame_marker( a_stack, marker_off);
-		if ( cur_marker->ref_cnt > 0)
-			{
-			break;  // === done ===
-			}  // still in use?
+		fail_or_die( catcher, "mmap failed");
+		}  // can't remap?
 
-		// discard *this* frame
-		a_stack->top = ( cur_marker->prev_off > 0) ?
-			( cur_marker->prev_off + sizeof( t_frame_marker) ) : 0;
-		}  // walk down each frame
+	if ( old_cow != NULL)
+		{
+		cow_unref( old_cow);
+		}  // moved to a new file?
+
+	clone = cow_map( a_stack->cow, NULL, a_stack->mapped, 0);
+	if ( clone == MAP_FAILED)
+		{
+		fail_or_die( catcher, "mmap failed");
+		return NULL;  // dummy
+		}  // no address space?
 
-	bza_dump_stack( a_stack);  // TEMP
+	__atomic_add_fetch( &( a_stack->cow->refs), 1, __ATOMIC_ACQ_REL);
+	bza_detach_clone( clone);
+	return clone;
 	}  // _________________________________________________________
 
-/** return the reference count of the indicated block */
-int						bza_get_ref_count
+/**
+ * copy a frame (its whole payload) from one stack onto another,
+ *  return the offset of the copy (reference count 1).
+ */
+size_t					bza_transfer
 	(
 	jmp_buf *			catcher,		// error handler (or null for immediate death)
-	t_stack *			a_stack,		// a stack on/in which 
-										// the frame is allocated
-	size_t				stk_frame_off	// offset of stack frame
+	t_stack *			src,			// stack on/in which the frame is
+										//  allocated (not changed)
+	t_stack * *			a_dst,			// a (different) stack on/in which to
+										// allocate the copy
+										// (which may be relocated!)
+	size_t				frame			// offset of frame in "src"
 	)
 	{
-	t_frame_marker *	marker;
-	int					cnt;
+	size_t				frame_sz;
+	size_t				copy;
+	t_slot *			slot;
 
 	// TODO: better error handling
-	assert( a_stack != NULL);
-	MLOG_PRINTF( stderr, "*** STK: ref-cnt frame off %d\n", (int) stk_frame_off);  // TEMP
+	assert( src != NULL);
+	assert( ( a_dst != NULL) && ( *a_dst != NULL) );
+	assert( src != *a_dst);
 
-	marker = bza_get_frame_marker( a_stack, stk_frame_off);
-	cnt = marker->ref_cnt;
-	MLOG_PRINTF( stderr, "    ref-cnt %d\n", cnt);
-	return cnt;
+	if ( frame & BZA_SLOT_TAG)
+		{
+		slot = bza_get_slot( src, frame);
+		frame_sz = BZA_SLAB_MIN <<
+				( (t_slab *) ( ( (char *) slot) - slot->back) )->cls;
+		}  // slab slot?
+	else
+		{
+		frame_sz = bza_frame_size( src, frame);
+		}  // normal frame
+
+	// ("src" is not touched by allocation, so its pointers stay put)
+	copy = bza_cons_stk_frame( catcher, a_dst, frame_sz);
+	memcpy( bza_fast_frame_ptr( *a_dst, copy),
+			bza_fast_frame_ptr( src, frame), frame_sz);
+	return copy;
 	}  // _________________________________________________________
 
 /**
@@ -423,31 +4372,12 @@ void *					bza_get_frame_ptr
 	size_t				stk_frame_off	// offset of stack frame
 	)
 	{
-	t_frame_marker *	cur_marker;
-	int					data_off;
-
-	MLOG_PRINTF( stderr, "*** STK: ptr for frame off %d\n", (int) stk_frame_off);  // TEMP
-
 	// TODO: better error handling
 	assert( a_stack != NULL);
 	assert( ( 0 < stk_frame_off) && ( stk_frame_off < a_stack->top) );
+	assert( *bza_frame_refs( a_stack, stk_frame_off) > 0);
 
-	// get the bookkeeping stuff
-	cur_marker = bza_get_frame_marker( a_stack, stk_frame_off);
-	MLOG_PRINTF( stderr, "\tFRM: %d b, %d refs (prev %d) @ %d\n",  // TEMP
-			(int) cur_marker->size,
-			(int) cur_marker->ref_cnt,
-			(int) cur_marker->prev_off,
-			(int) stk_frame_off);
-
-	// TODO: better error handling
-	assert( cur_marker->ref_cnt > 0);
-
-	// use *signed* arithmetic for offset:
-	data_off = ( (int) stk_frame_off) - ( (int) cur_marker->size);
-	MLOG_PRINTF( stderr, "\tDATA @ %d\n", data_off);  // TEMP
-	fflush( stderr);  // TODO: make flushing debug log routines
-	return (void *) &( a_stack->data[ data_off ]);
+	return bza_fast_frame_ptr( a_stack, stk_frame_off);
 	}  // _________________________________________________________
 
 
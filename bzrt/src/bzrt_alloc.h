@@ -11,8 +11,11 @@
 #ifndef _BZRT_ALLOC_H
 #define _BZRT_ALLOC_H
 
+#include <assert.h>
 #include <unistd.h>
 #include <setjmp.h>
+#include <stdio.h>
+#include <stdint.h>
 
 /** memory allocation handler (internal use only!) */
 typedef
@@ -24,15 +27,410 @@ void *					( * tf_allocator)
 	)
 	;
 
+/** stack memory release handler (internal use only!) */
+typedef
+void					( * tf_releaser)
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	void *				existing		// existing block
+	)
+	;
+
+/**
+ * stack growth policy:  return the new usable size for a stack
+ *  which must hold at least "needed" bytes.
+ */
+typedef
+size_t					( * tf_grow_policy)
+	(
+	size_t				cur_size,		// current usable size of stack
+	size_t				needed,			// minimum usable size required
+	size_t				grow_arg		// policy specific parameter
+										//  (e.g. chunk size), 0 for default
+	)
+	;
+
+/** traced allocator operations (see bza_trace_on) */
+typedef enum			e_trace_op
+	{
+	BZA_EV_CONS = 1,					// frame made:  offset, size
+	BZA_EV_REF,							// frame referenced:  offset, new count
+	BZA_EV_DEREF,						// frame dereferenced:  offset,
+										//  new count (0:  freed)
+	BZA_EV_GROW,						// stack reallocated:  new size
+	BZA_EV_RESET,						// stack emptied
+	BZA_EV_RELEASE,						// cut back:  checkpoint (offset)
+	BZA_EV_COMPACT,						// compacted:  new top (offset),
+										//  live frames
+	BZA_EV_NUM_OPS
+	}					e_trace_op;
+
+/** one traced event, as recorded (and saved) */
+typedef struct			t_trace_ev
+	{
+	uint64_t			ticks;			// time stamp (see t_trace_hdr)
+	uint64_t			off;			// frame offset (or as per op)
+	uint32_t			size;			// size, count (or as per op),
+										//  clamped to 32 bits
+	uint32_t			op;				// e_trace_op
+	}					t_trace_ev;
+
+/** event ring buffer of a traced stack (internal use only!) */
+typedef struct			t_trace
+	{
+	uint64_t			mask;			// number of event slots - 1
+	uint64_t			head;			// number of events recorded so far
+	uint64_t			ticks0;			// time stamp when tracing started
+	uint64_t			nsec0;			// clock (nanoseconds) at same time
+	t_trace_ev			evs[0];			// event slots (a power of 2)
+	}					t_trace;
+
+/** magic string at the start of a saved trace */
+#define BZA_TRACE_MAGIC		"BZTRACE1"
+
+/** saved trace header (followed by the events, oldest first) */
+typedef struct			t_trace_hdr
+	{
+	char				magic[ 8 ];		// BZA_TRACE_MAGIC (no nul)
+	uint64_t			first;			// sequence number of first event
+	uint64_t			num;			// number of events that follow
+	uint64_t			ticks0;			// time stamp when tracing started
+	double				ticks_per_ns;	// time stamp rate
+	}					t_trace_hdr;
+
+/** magic string at the start of a recording */
+#define BZA_RECORD_MAGIC	"BZREC001"
+
+/** recording header (followed by the events, in order) */
+typedef struct			t_record_hdr
+	{
+	char				magic[ 8 ];		// BZA_RECORD_MAGIC (no nul)
+	uint64_t			flags;			// BZA_OPT_* bits of the stack
+	}					t_record_hdr;
+
+/**
+ * one recorded call:  as a traced event (t_trace_ev), without the
+ *  time stamp, and with the size as requested.
+ *  A BZA_EV_COMPACT event is followed by "size" t_record_move entries.
+ */
+typedef struct			t_record_ev
+	{
+	uint64_t			off;			// frame offset (or as per op)
+	uint32_t			size;			// size, count (or as per op)
+	uint32_t			op;				// e_trace_op
+	}					t_record_ev;
+
+/** a frame moved by a recorded compaction */
+typedef struct			t_record_move
+	{
+	uint64_t			old_off;		// frame offset before compaction
+	uint64_t			new_off;		// frame offset after compaction
+	}					t_record_move;
+
+/** number of slab size classes (see BZA_OPT_SLAB) */
+#define BZA_SLAB_CLASSES	4
+
+/**
+ * number of frame size buckets in the statistics:
+ *  bucket "i" counts payloads up to 16 << i bytes,
+ *  the last one everything bigger.
+ */
+#define BZA_STAT_BUCKETS	16
+
+/**
+ * number of hole lists:  list "i" holds dead frames with payloads
+ *  of 2^i up to 2^(i+1) - 1 bytes, the last one everything bigger.
+ */
+#define BZA_HOLE_BUCKETS	32
+
+/** magic string at the start of a saved stack (see bza_save_stack) */
+#define BZA_SAVE_MAGIC		"BZSTACK1"
+
+/** format version of a saved stack */
+#define BZA_SAVE_VERSION	2
+
+/**
+ * where the frames start in a saved stack file
+ *  (a multiple of any page size, so they can be mapped in place).
+ */
+#define BZA_SAVE_DATA_OFF	( 64 * 1024)
+
+/**
+ * saved stack header, at the start of the file;
+ *  the frames ("top" bytes of "data") follow at BZA_SAVE_DATA_OFF.
+ */
+typedef struct			t_save_hdr
+	{
+	char				magic[ 8 ];		// BZA_SAVE_MAGIC (no nul)
+	uint32_t			version;		// BZA_SAVE_VERSION
+	uint32_t			word_size;		// sizeof( size_t) of the writer
+	uint64_t			flags;			// BZA_OPT_* bits of the stack
+	uint64_t			root;			// offset of the caller's root frame
+	uint64_t			top;			// bytes of frames saved
+	uint64_t			holes[ BZA_HOLE_BUCKETS ];
+										// "holes" lists (see t_stack)
+	uint64_t			num_holes;		// number of holes
+	uint64_t			hole_bytes;		// bytes stranded in holes
+	uint64_t			slabs[ BZA_SLAB_CLASSES ];
+										// slab rings (see t_stack)
+	}					t_save_hdr;
+
 /** stub of a stack instance -- allocation is within a stack */
 typedef struct 			t_stack
 	{
 	tf_allocator		alloc;			// memory [re]allocator
+	tf_releaser			release;		// memory release for "alloc"
+	size_t				reserved;		// address space reserved
+										//  (including these fields),
+										//  0 if not a "vm" stack
+	size_t				mapped;			// bytes mapped (including these
+										//  fields), 0 if not a "mapped"
+										//  stack (see BZA_OPT_PREFAULT)
+	struct t_cow_file *	cow;			// memory file holding a "mapped"
+										//  stack (see BZA_OPT_COW),
+										//  null if none
+	int					cow_shared;		// true if the stack is mapped shared
+										//  (written through to "cow"),
+										//  false if copy-on-write
+	tf_grow_policy		grow;			// how much to ask "alloc" for
+	size_t				grow_arg;		// parameter for "grow"
+	size_t				num_grows;		// number of [re]allocations so far
+	size_t				trim_floor;		// usable size kept by automatic
+										//  trimming (see BZA_OPT_AUTO_TRIM)
+	int					flags;			// BZA_OPT_* option bits
+	size_t				holes[ BZA_HOLE_BUCKETS ];
+										// per size bucket, first of a list
+										//  of dead frames beneath live ones
+										//  (marker offsets), 0 if none
+	uint32_t			hole_map;		// bit "i" set if holes[ i ] != 0
+	size_t				num_holes;		// number of such dead frames
+	size_t				hole_bytes;		// bytes stranded in such frames
+										//  (including overhead)
+	size_t				slabs[ BZA_SLAB_CLASSES ];
+										// per size class, first of a ring of
+										//  slabs (marker offsets), 0 if none
+	int					seg_shift;		// log2 of segment size,
+										//  0 if "data" is contiguous
+	char * *			segs;			// segment table, if segmented
+										//  (offset = segment, local offset)
+	size_t				num_segs;		// number of segments allocated
 	size_t				top;			// offset to next available space
 	size_t				size;			// total size of stack so far
-	char				data[0];		// variable size data buffer
+	size_t				high_water;		// highest "top" so far
+	size_t *			marks;			// checkpoints (from bza_mark) which
+										//  "top" has not dropped below,
+										//  ascending
+	size_t				num_marks;		// number of such checkpoints
+	size_t				max_marks;		// room in "marks"
+	size_t				bytes_copied;	// bytes moved by reallocation
+										//  or compaction, so far
+	int					stats_stale;	// true if the live counts below
+										//  must be recounted (frames were
+										//  dropped without being visited)
+	size_t				live_frames;	// frames with references
+	size_t				live_bytes;		// payload bytes in such frames
+	size_t				size_hist[ BZA_STAT_BUCKETS ];
+										// live frames, by payload size
+	size_t				slot_counts[ BZA_SLAB_CLASSES ];
+										// slab slots in use, per size class
+	t_trace *			trace;			// event ring, null if not tracing
+	FILE *				record;			// recording, null if not recording
+	int					lock;			// spin lock (see BZA_OPT_SHARED)
+	struct t_stack *	parent;			// stack holding this one in a frame
+										//  (see bza_cons_child_stack),
+										//  null if none
+	size_t				parent_frame;	// offset of that frame in "parent"
+	char				data[0]			// variable size data buffer,
+		__attribute__ ((aligned (16)));	//  aligned like malloc's
 	}					t_stack;
 
+/**
+ * option bit:  do not satisfy new frames from dead frames
+ *  beneath live ones (the dead frames are still counted).
+ */
+#define BZA_OPT_NO_HOLE_REUSE	0x0001
+
+/**
+ * option bit:  use an 8 byte frame marker (32 bit size and count)
+ *  instead of the 24 byte one, for stacks of many tiny frames;
+ *  frames are then limited to 4 GB.
+ */
+#define BZA_OPT_COMPACT_HDR		0x0002
+
+/**
+ * option bit:  carve small frames (up to 128 bytes) out of slabs,
+ *  one size class (16/32/64/128) per slab, so freed ones are reused
+ *  at once even when not on top.  Slot handles work like frame offsets;
+ *  one empty slab per class is kept until the stack is reset,
+ *  and slots in slabs below a checkpoint survive bza_release_to.
+ */
+#define BZA_OPT_SLAB			0x0004
+
+/**
+ * option bit:  make bza_cons_stk_frames allocate one frame at a time
+ *  (for comparison).
+ */
+#define BZA_OPT_NO_BATCH		0x0008
+
+/**
+ * "real time" option bit:  touch every page as it is added to the stack,
+ *  so that later frames never take a page fault.
+ *  A plain stack with any of the "real time" bits is mmap'd
+ *  (MAP_POPULATE) rather than taken from the heap, and grows by mremap.
+ */
+#define BZA_OPT_PREFAULT		0x0010
+
+/**
+ * "real time" option bit:  mlock the stack's pages as they are added,
+ *  so they are never swapped out (subject to RLIMIT_MEMLOCK:
+ *  failure is reported as an allocation failure).
+ */
+#define BZA_OPT_LOCK			0x0020
+
+/**
+ * "real time" option bit:  back the stack with huge pages:
+ *  explicit (MAP_HUGETLB) ones if any are available,
+ *  otherwise transparent ones (madvise), if the kernel allows.
+ *  Sizes are rounded up to 2 MB.
+ */
+#define BZA_OPT_HUGE			0x0040
+
+/**
+ * option bit:  share the stack between threads.
+ *  Reference counts change atomically, so frames can be read
+ *  (referenced / de-referenced) from any thread, and frames are
+ *  created and freed under a lock.
+ *  Only for stacks which are never relocated ("vm" or fixed),
+ *  and not segmented, since the segment table is reallocated as it grows.
+ *  Reset, release, compaction, tracing and recording are still
+ *  for one thread at a time (with no frames in use elsewhere).
+ */
+#define BZA_OPT_SHARED			0x0080
+
+/**
+ * option bit:  keep the stack in a memory file (memfd),
+ *  so that bza_clone_stack can share its pages copy-on-write
+ *  rather than copy them.  Not with the "real time" bits,
+ *  nor for "vm" or segmented stacks.
+ */
+#define BZA_OPT_COW				0x0100
+
+/**
+ * option bit:  trim the stack (see bza_trim) automatically,
+ *  when a frame is pushed while less than a quarter of it is in use:
+ *  it is cut back to twice what is in use, but never below
+ *  its initial size (or 64 KB), so that a stack which shrinks
+ *  does not thrash between growing and trimming.
+ */
+#define BZA_OPT_AUTO_TRIM		0x0200
+
+/**
+ * option bit:  keep offsets and lengths to 32 bits where they are
+ *  stored inside frames (byte array headers, table nodes' children),
+ *  for stacks of very many small frames.  Implies BZA_OPT_COMPACT_HDR;
+ *  the stack is then limited to 4 GB.
+ */
+#define BZA_OPT_OFF32			0x0400
+
+/** snapshot of a stack's statistics (see bza_get_stats) */
+typedef struct			t_stack_stats
+	{
+	size_t				live_frames;	// frames with references
+										//  (a slab counts as one frame)
+	size_t				live_bytes;		// payload bytes in such frames
+	size_t				live_slots;		// slab slots in use
+	size_t				slot_bytes;		// payload bytes in such slots
+	size_t				stranded_bytes;	// bytes in dead frames beneath
+										//  live ones (including overhead)
+	size_t				num_holes;		// number of such dead frames
+	size_t				top;			// bytes in use (offset of top)
+	size_t				size;			// usable size of stack
+	size_t				high_water;		// highest "top" so far
+	size_t *			marks;			// checkpoints (from bza_mark) which
+										//  "top" has not dropped below,
+										//  ascending
+	size_t				num_marks;		// number of such checkpoints
+	size_t				max_marks;		// room in "marks"
+	size_t				num_grows;		// number of [re]allocations so far
+	size_t				bytes_copied;	// bytes moved by reallocation
+										//  or compaction, so far
+	size_t				size_hist[ BZA_STAT_BUCKETS ];
+										// live frames, by payload size
+										//  (see BZA_STAT_BUCKETS)
+	size_t				slot_hist[ BZA_SLAB_CLASSES ];
+										// slab slots in use, per size class
+	}					t_stack_stats;
+
+/** stack construction options (zero fill for defaults) */
+typedef struct			t_stack_opts
+	{
+	size_t				initial_size;	// initial size of stack
+	int					is_fixed;		// true if fixed to "initial" size
+	tf_grow_policy		grow;			// growth policy,
+										//  null for bza_grow_double
+	size_t				grow_arg;		// parameter for growth policy
+	size_t				vm_reserve;		// if not 0:  address space to reserve
+										//  for a stack which is never
+										//  relocated (see bza_cons_stack_vm)
+	int					flags;			// BZA_OPT_* option bits
+	int					seg_shift;		// if not 0:  log2 of segment size
+										//  for a stack which grows
+										//  by adding segments
+										//  (see bza_cons_stack_seg)
+	}					t_stack_opts;
+
+/** growth policy:  exactly what is needed (many reallocations!) */
+size_t					bza_grow_exact
+	(
+	size_t				cur_size,		// current usable size of stack
+	size_t				needed,			// minimum usable size required
+	size_t				grow_arg		// (ignored)
+	)
+	;
+
+/** growth policy:  double the current size until large enough */
+size_t					bza_grow_double
+	(
+	size_t				cur_size,		// current usable size of stack
+	size_t				needed,			// minimum usable size required
+	size_t				grow_arg		// (ignored)
+	)
+	;
+
+/** growth policy:  add 50% to the current size until large enough */
+size_t					bza_grow_half
+	(
+	size_t				cur_size,		// current usable size of stack
+	size_t				needed,			// minimum usable size required
+	size_t				grow_arg		// (ignored)
+	)
+	;
+
+/** growth policy:  round up to a multiple of a fixed chunk size */
+size_t					bza_grow_chunk
+	(
+	size_t				cur_size,		// current usable size of stack
+	size_t				needed,			// minimum usable size required
+	size_t				grow_arg		// chunk size (0 for default)
+	)
+	;
+
+/** translation of one live frame's offset by bza_compact */
+typedef struct			t_remap_ent
+	{
+	size_t				old_off;		// frame offset before compaction
+	size_t				new_off;		// frame offset after compaction
+	size_t				shift;			// payload move (new - old start)
+	}					t_remap_ent;
+
+/** translation of all live frames' offsets by bza_compact */
+typedef struct			t_remap
+	{
+	size_t				num;			// number of entries
+	t_remap_ent			ents[0];		// entries, sorted by old (and new)
+										//  offset
+	}					t_remap;
+
 /** create a new (empty) stack */
 t_stack *				bza_cons_stack
 	(
@@ -40,7 +438,11 @@ t_stack *				bza_cons_stack
 	)
 	;
 
-/** create a new (empty) stack, with "real time" support options */
+/**
+ * create a new (empty) stack, with "real time" support options.
+ *  See also BZA_OPT_PREFAULT, BZA_OPT_LOCK and BZA_OPT_HUGE
+ *  (via bza_cons_stack_opts).
+ */
 t_stack *				bza_cons_stack_rt
 	(
 	jmp_buf *			catcher,		// error handler (or null for immediate death)
@@ -49,6 +451,101 @@ t_stack *				bza_cons_stack_rt
 	)
 	;
 
+/**
+ * create a new (empty) stack which is NEVER relocated:
+ *  the given amount of address space is reserved up front,
+ *  and pages are committed as the stack grows into it.
+ *  Pointers from bza_get_frame_ptr remain valid
+ *  for as long as the frame is referenced.
+ */
+t_stack *				bza_cons_stack_vm
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	size_t				reserve_size	// address space to reserve
+										//  (maximum size of stack)
+	)
+	;
+
+/**
+ * create a new (empty) segmented stack, which is NEVER relocated:
+ *  the stack grows by adding fixed size segments,
+ *  and no frame may span two segments,
+ *  so a frame (plus overhead) must fit within one segment.
+ */
+t_stack *				bza_cons_stack_seg
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	int					seg_shift		// log2 of segment size
+	)
+	;
+
+/** create a new (empty) stack, with the given options */
+t_stack *				bza_cons_stack_opts
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	const
+	t_stack_opts *		opts			// construction options (null for defaults)
+	)
+	;
+
+/**
+ * create a new (empty) child stack inside a frame of a parent stack,
+ *  for nested scopes:  no malloc, and bza_dest_stack just drops the frame.
+ *  A fixed child ("is_fixed") fails when full;  otherwise it spills
+ *  into a bigger frame of the parent (the child is then relocated).
+ *  The parent must never be relocated ("vm", segmented or fixed,
+ *  including a fixed child), and must outlive the child.
+ *  While the child lives, the parent must not be compacted, reset,
+ *  or released to a checkpoint below the child's frame:
+ *  the child's frame would be moved or dropped under it.
+ *  The "real time" and copy-on-write options are refused,
+ *  as is BZA_OPT_SHARED unless the child is fixed.
+ */
+t_stack *				bza_cons_child_stack
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			parent,			// stack in which to carve the child
+	const
+	t_stack_opts *		opts			// construction options (null for
+										//  defaults);  "initial_size" is
+										//  the size of the frame,
+										//  "vm_reserve" and "seg_shift"
+										//  must be 0
+	)
+	;
+
+/**
+ * make sure that the stack can hold at least "size" bytes
+ *  (frames + overhead) without further reallocation.
+ */
+void					bza_reserve
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack * *			a_stack,		// a stack to be expanded
+										// (which may be relocated!)
+	size_t				size			// usable size needed
+	)
+	;
+
+/**
+ * give memory back to the system after a spike:  shrink a stack's
+ *  storage to what its frames use (up to "top"), but no smaller than
+ *  "keep" usable bytes.  A plain stack is reallocated;  the unused
+ *  pages of a mapped, "vm" or segmented stack are released in place.
+ *  Fixed size stacks are left alone, as are child stacks
+ *  (bza_cons_child_stack):  moving one into a smaller frame would only
+ *  add to its parent.
+ *  Return the number of usable bytes given up.
+ */
+size_t					bza_trim
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack * *			a_stack,		// a stack to be trimmed
+										// (which may be relocated!)
+	size_t				keep			// usable size to keep, at least
+	)
+	;
+
 /** free up a stack (run any needed / practical cleanup) */
 void					bza_dest_stack
 	(
@@ -57,6 +554,43 @@ void					bza_dest_stack
 	)
 	;
 
+/**
+ * drop every frame on the stack, regardless of reference counts,
+ *  but keep the space for reuse.
+ *  (Not while child stacks live in its frames.)
+ */
+void					bza_reset_stack
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack			// a stack to be emptied
+	)
+	;
+
+/** return a checkpoint for bza_release_to (the current top of stack) */
+size_t					bza_mark
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack			// a stack to be checkpointed
+	)
+	;
+
+/**
+ * drop every frame allocated above the checkpoint, regardless of
+ *  reference counts, without visiting them.
+ *  Frames carved out of dead space below the checkpoint are kept.
+ *  (Not below the frame of a live child stack.)
+ *  A checkpoint is stale (an error) once the top of stack has dropped
+ *  below it, even if it has grown past it again since, and after
+ *  compaction;  a clone or saved stack starts with none.
+ */
+void					bza_release_to
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack,		// a stack to be cut back
+	size_t				mark			// checkpoint from bza_mark
+	)
+	;
+
 /** create a new frame on the stack (set reference count to 1) */
 size_t					bza_cons_stk_frame
 	(
@@ -68,6 +602,42 @@ size_t					bza_cons_stk_frame
 	)
 	;
 
+/**
+ * create a new frame on the stack (set reference count to 1),
+ *  with its payload address a multiple of "align".
+ * Every frame is 16 byte aligned anyway;  larger alignments hold
+ *  only until the stack is relocated (never, for vm or segmented
+ *  stacks) or compacted.
+ */
+size_t					bza_cons_stk_frame_aligned
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack * *			a_stack,		// a stack on/in which to
+										// allocate the frame
+										// (which may be relocated!)
+	size_t				frame_sz,		// size of frame, excluding overhead
+	size_t				align			// required payload alignment,
+										//  a power of 2
+	)
+	;
+
+/**
+ * create several new frames on the stack (each with a reference count of 1)
+ *  with a single capacity check, putting their offsets in "offs".
+ */
+void					bza_cons_stk_frames
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack * *			a_stack,		// a stack on/in which to
+										// allocate the frames
+										// (which may be relocated!)
+	const
+	size_t *			sizes,			// size of each frame, excluding overhead
+	size_t				num,			// number of frames
+	size_t *			offs			// offset of each new frame (output)
+	)
+	;
+
 /** reference a frame on the stack (increment reference count) */
 void					bza_ref_stk_frame
 	(
@@ -98,6 +668,207 @@ int						bza_get_ref_count
 	)
 	;
 
+/**
+ * return the number of bytes (including overhead) stranded in dead frames
+ *  which cannot be popped because a live frame sits on top of them.
+ *  These are reused by later allocations when they fit.
+ */
+size_t					bza_get_stranded_bytes
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack			// a stack to be measured
+	)
+	;
+
+/**
+ * fill in a snapshot of the stack's statistics.
+ *  These are kept up to date as frames come and go, so this is cheap,
+ *  except for the first call after bza_release_to or bza_compact,
+ *  which walks the stack to recount the live frames.
+ */
+void					bza_get_stats
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack,		// a stack to be measured
+	t_stack_stats *		stats			// statistics (output)
+	)
+	;
+
+/**
+ * start recording allocator events for the stack in a ring buffer
+ *  holding the most recent "num_events" (rounded up to a power of 2).
+ *  Recording costs a time stamp and a few stores per event;
+ *  the ring is only written by the (one) thread using the stack.
+ */
+void					bza_trace_on
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack,		// a stack to be traced
+	size_t				num_events		// ring buffer size
+	)
+	;
+
+/** stop recording allocator events, and discard the ring buffer */
+void					bza_trace_off
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack			// a stack being traced
+	)
+	;
+
+/**
+ * write the recorded events (oldest first) to a file,
+ *  after a t_trace_hdr, for the bz_trace decoder;
+ *  recording continues.
+ */
+void					bza_trace_save
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack,		// a stack being traced
+	FILE *				out				// file to write to
+	)
+	;
+
+/**
+ * start writing every frame construction, reference and dereference
+ *  (plus resets, releases and compactions) on the stack to a file,
+ *  for replay by test/bin/replay.
+ *  Batches are recorded as single frames, and alignments are not kept.
+ */
+void					bza_record_on
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack,		// a stack to be recorded
+	FILE *				out				// file to write to
+										//  (left open by bza_record_off)
+	)
+	;
+
+/** stop recording, and flush the file */
+void					bza_record_off
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack			// a stack being recorded
+	)
+	;
+
+/**
+ * Slide all live frames down over any dead frames beneath them,
+ *  and return the translation of old to new frame offsets,
+ *  which must be freed by bza_dest_remap.
+ *  IMPORTANT:  every offset held outside the stack,
+ *  or inside any frame (e.g. via bzt_relocate), must be translated.
+ *  Not while child stacks (bza_cons_child_stack) live in its frames:
+ *  they are not told that their frames moved.
+ */
+t_remap *				bza_compact
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack			// a stack to be compacted
+	)
+	;
+
+/**
+ * return the new offset of a frame moved by bza_compact
+ *  (0 if the given offset was not a live frame).
+ */
+size_t					bza_remap_off
+	(
+	const
+	t_remap *			remap,			// translation from bza_compact
+	size_t				old_off			// frame offset before compaction
+	)
+	;
+
+/** free up the translation returned by bza_compact */
+void					bza_dest_remap
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_remap * *			a_remap			// translation to be freed
+	)
+	;
+
+/**
+ * save the frames of a (contiguous) stack to a new file,
+ *  with a t_save_hdr, for bza_map_stack.
+ *  Frames are saved as they are (with their reference counts),
+ *  so a saved stack is used in place, with no parsing.
+ */
+void					bza_save_stack
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack,		// a stack to be saved
+	size_t				root,			// offset of a root frame (e.g. a
+										//  table) to be returned by
+										//  bza_map_stack (or 0)
+	int					fd				// file descriptor of a new,
+										//  empty file (not closed)
+	)
+	;
+
+/**
+ * map a stack saved by bza_save_stack, return it (fixed size:
+ *  it cannot grow).  Read-only, its frames are just for looking up
+ *  (e.g. bzt_get, but NOT ref / deref, or anything else which writes);
+ *  otherwise it is copy-on-write (the file is never changed),
+ *  and only the pages written are copied.
+ *  A file shorter than its header says, or whose root, hole or slab
+ *  offsets do not land on frames, is refused;  the frames themselves
+ *  are trusted.
+ *  Free it with bza_dest_stack.
+ */
+t_stack *				bza_map_stack
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	const
+	char *				path,			// saved stack file
+	int					writable,		// true for copy-on-write,
+										//  false for read-only
+	size_t *			a_root			// root frame offset given
+										//  to bza_save_stack (output,
+										//  may be null)
+	)
+	;
+
+/**
+ * return a logically independent copy of a (contiguous) stack,
+ *  e.g. to try a change which may be thrown away.
+ *  A BZA_OPT_COW stack shares its pages with the clone, so each
+ *  only pays for the pages it writes afterwards (the first write
+ *  to a page, by either, copies it);  any other stack is copied
+ *  up front, into a new BZA_OPT_COW stack.
+ *  Cloning a stack whose pages are already shared with a live clone
+ *  copies it once more (into a new memory file).
+ *  The clone has no trace or recording;  free it with bza_dest_stack.
+ */
+t_stack *				bza_clone_stack
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack			// a stack to be cloned
+										//  (not moved, but its pages
+										//  become copy-on-write)
+	)
+	;
+
+/**
+ * copy a frame (its whole payload) from one stack onto another,
+ *  return the offset of the copy (reference count 1).
+ *  Offsets held inside the payload are copied as is:
+ *  type-aware wrappers (e.g. bzt_transfer) translate them,
+ *  copying each frame they lead to in the same pass.
+ */
+size_t					bza_transfer
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			src,			// stack on/in which the frame is
+										//  allocated (not changed)
+	t_stack * *			a_dst,			// a (different) stack on/in which to
+										// allocate the copy
+										// (which may be relocated!)
+	size_t				frame			// offset of frame in "src"
+	)
+	;
+
 /**
  * return a pointer to the payload data in the indicated frame.
  *  WARNING:  the data may be relocated by a subsequent allocation,
@@ -112,6 +883,183 @@ void *					bza_get_frame_ptr
 	)
 	;
 
+/*
+ * Inline accessors (bza_fast_*), for hot loops.
+ *  A bad offset is caught by assert, as in the functions above,
+ *  unless compiled with BZA_UNCHECKED defined (e.g. -DBZA_UNCHECKED),
+ *  in which case it is not caught at all.
+ *  The types and helpers up to bza_fast_frame_ptr are for these
+ *  (internal use only!).
+ */
+
+#ifdef BZA_UNCHECKED
+#define BZA_CHECK( cond)	( (void) 0)
+#else
+#define BZA_CHECK( cond)	assert( cond)
+#endif  // BZA_UNCHECKED defined?
+
+/** low bit set in a frame "offset":  it's a slab slot handle */
+#define BZA_SLOT_TAG	( (size_t) 1)
+
+/**
+ * low bits of a frame marker's "size" used for hole bookkeeping
+ *  (payload sizes are always a multiple of 8).
+ */
+#define BZA_SIZE_FLAGS	( (size_t) 7)
+
+/** stack frame marker */
+typedef struct 			t_frame_marker
+	{
+	size_t				size;			// size of this stack frame,
+										//  usable space, excluding overhead
+										//  (and BZA_SIZE_FLAGS)
+	int					ref_cnt;		// reference count
+	// redundant (frames are contiguous), see t_compact_marker
+	size_t				prev_off;		// offset to previous frame
+	}					t_frame_marker;
+
+/**
+ * compact stack frame marker (BZA_OPT_COMPACT_HDR):
+ *  the previous frame's marker is found from the size,
+ *  since each payload starts right after the marker below it.
+ */
+typedef struct 			t_compact_marker
+	{
+	uint32_t			size;			// size of this stack frame,
+										//  usable space, excluding overhead
+										//  (and BZA_SIZE_FLAGS)
+	int32_t				ref_cnt;		// reference count
+	}					t_compact_marker;
+
+/** slab slot header (just below each slot's payload) */
+typedef struct			t_slot
+	{
+	uint32_t			back;			// offset of this slot in its slab
+	int32_t				ref_cnt;		// reference count
+	size_t				link;			// next free slot (offset in slab),
+										//  0 if none, while free
+	}					t_slot;
+
+/**
+ * Return the address of the given offset in the stack's data.
+ *  WARNING:  this is a volatile value,
+ *  which will often be invalidated by a stack resize.
+ */
+static inline
+char *					bza_addr
+	(
+	t_stack *			stack,			// a stack to be accessed,
+										//  not null!
+	size_t				off				// offset into the stack's data
+	)
+	{
+	if ( stack->seg_shift == 0)
+		{
+		return &( stack->data[ off ]);  // === done ===
+		}  // contiguous?
+
+	return stack->segs[ off >> stack->seg_shift ] +
+			( off & ( ( ( (size_t) 1) << stack->seg_shift) - 1) );
+	}  // _________________________________________________________
+
+/**
+ * Return marker structure for indicated frame.
+ *  WARNING:  this is a volatile value,
+ *  which will often be invalidated by a stack resize.
+ */
+static inline
+t_frame_marker *		bza_get_frame_marker
+	(
+	t_stack *			stack,			// a stack to be displayed,
+										//  not null!
+	size_t				marker_off		// offset to desired frame marker
+	)
+	{
+	if ( marker_off == 0)
+		{
+		return NULL;  // === skip ===
+		}  // empty?
+
+	return (t_frame_marker *) bza_addr( stack, marker_off);
+	}  // _________________________________________________________
+
+/** return the size of the indicated frame (payload, excluding overhead) */
+static inline
+size_t					bza_frame_size
+	(
+	t_stack *			stack,			// a stack to be accessed,
+										//  not null!
+	size_t				marker_off		// offset to desired frame marker
+	)
+	{
+	if ( stack->flags & BZA_OPT_COMPACT_HDR)
+		{
+		return ( (t_compact_marker *) bza_addr( stack, marker_off) )->size &
+				~BZA_SIZE_FLAGS;
+		}  // short form?
+
+	return bza_get_frame_marker( stack, marker_off)->size & ~BZA_SIZE_FLAGS;
+	}  // _________________________________________________________
+
+/**
+ * Return the location of the reference count of the indicated frame.
+ *  WARNING:  this is a volatile value,
+ *  which will often be invalidated by a stack resize.
+ */
+static inline
+int *					bza_frame_refs
+	(
+	t_stack *			stack,			// a stack to be accessed,
+										//  not null!
+	size_t				marker_off		// offset to desired frame marker
+										//  (or slab slot handle)
+	)
+	{
+	if ( marker_off & BZA_SLOT_TAG)
+		{
+		// the slot header is just under the payload
+		return &( ( (t_slot *) bza_addr( stack,
+				( marker_off & ~BZA_SLOT_TAG) - sizeof( t_slot) ) )->ref_cnt);
+		}  // slab slot?
+
+	if ( stack->flags & BZA_OPT_COMPACT_HDR)
+		{
+		return &( ( (t_compact_marker *) bza_addr( stack, marker_off) )->ref_cnt);
+		}  // short form?
+
+	return &( bza_get_frame_marker( stack, marker_off)->ref_cnt);
+	}  // _________________________________________________________
+
+/**
+ * return a pointer to the payload data in the indicated frame,
+ *  as bza_get_frame_ptr does, but inline (for hot loops):
+ *  no error handler, and no checks if compiled with BZA_UNCHECKED.
+ *  WARNING:  the data may be relocated by a subsequent allocation,
+ *  so use and discard this value BEFORE anything else is allocated.
+ */
+static inline
+void *					bza_fast_frame_ptr
+	(
+	t_stack *			a_stack,		// a stack on/in which 
+										// the frame is allocated
+	size_t				stk_frame_off	// offset of stack frame
+	)
+	{
+	BZA_CHECK( a_stack != NULL);
+	BZA_CHECK( ( 0 < stk_frame_off) && ( stk_frame_off < a_stack->top) );
+	BZA_CHECK( *bza_frame_refs( a_stack, stk_frame_off) > 0);
+
+	if ( stk_frame_off & BZA_SLOT_TAG)
+		{
+		return (void *) bza_addr( a_stack, stk_frame_off & ~BZA_SLOT_TAG);
+		// === done ===
+		}  // slab slot:  the handle is the payload offset
+
+	// the payload is just under the marker
+	return (void *) bza_addr( a_stack,
+			stk_frame_off - bza_frame_size( a_stack, stk_frame_off) );
+	}  // _________________________________________________________
+
 #endif  // BZRT_ALLOC_H
 
 // vi: ts=4 sw=4 ai
@@ -34,17 +34,89 @@
 // #define DO_LOG	1
 #include "_log.h"
 
-/** data structure to manage byte array */
-typedef struct			t_bytes
+/** most byte arrays made per bza_cons_stk_frames call */
+#define BZB_MAX_BATCH	16
+
+/** return the size of a byte array header on the given stack */
+static inline
+size_t					bzb_hdr_size
+	(
+	t_stack *			a_stack			// a stack on/in which 
+										// byte arrays are allocated
+	)
+	{
+	return ( a_stack->flags & BZA_OPT_OFF32) ?
+			sizeof( t_bytes32) : sizeof( t_bytes);
+	}  // _________________________________________________________
+
+/** set the length of a byte array (in either header layout) */
+static inline
+void					bzb_set_len
+	(
+	t_stack *			a_stack,		// a stack on/in which 
+										// the frame is allocated
+	size_t				bytes,			// offset of byte array
+	size_t				len				// length in usable bytes
+	)
+	{
+	void *				barr;
+
+	barr = bza_fast_frame_ptr( a_stack, bytes);
+	if ( a_stack->flags & BZA_OPT_OFF32)
+		{
+		( (t_bytes32 *) barr)->len = (uint32_t) len;
+		}  // 32 bit header?
+	else
+		{
+		( (t_bytes *) barr)->len = len;
+		}  // full header
+
+	}  // _________________________________________________________
+
+/**
+ * set up the header of a new byte array, return its data
+ *  (see bzb_fast_data).
+ */
+static inline
+char *					bzb_set_hdr
+	(
+	t_stack *			a_stack,		// a stack on/in which 
+										// the frame is allocated
+	size_t				bytes,			// offset of byte array
+	size_t				len,			// length in usable bytes
+	size_t				alloc			// size allocated
+	)
+	{
+	void *				barr;
+
+	barr = bza_fast_frame_ptr( a_stack, bytes);
+	if ( a_stack->flags & BZA_OPT_OFF32)
+		{
+		( (t_bytes32 *) barr)->len = (uint32_t) len;
+		( (t_bytes32 *) barr)->alloc = (uint32_t) alloc;
+		return ( (t_bytes32 *) barr)->data;  // === done ===
+		}  // 32 bit header?
+
+	( (t_bytes *) barr)->len = len;
+	( (t_bytes *) barr)->alloc = alloc;
+	return ( (t_bytes *) barr)->data;
+	}  // _________________________________________________________
+
+/** return the size allocated for a byte array */
+static inline
+size_t					bzb_alloc_size
+	(
+	t_stack *			a_stack,		// a stack on/in which 
+										// the frame is allocated
+	size_t				bytes			// offset of byte array
+	)
 	{
-	// TODO: immutable
-	size_t				len;			// length in usable bytes,
-										//  excludes hidden terminator (\0)
-										//  added just in case used as asciiz
-	size_t				alloc;			// size allocated,
-										//  may be larger than len.
-	char				data[ 0 ];		// variable size buffer for bytes
-	}					t_bytes;
+	void *				barr;
+
+	barr = bza_fast_frame_ptr( a_stack, bytes);
+	return ( a_stack->flags & BZA_OPT_OFF32) ?
+			( (t_bytes32 *) barr)->alloc : ( (t_bytes *) barr)->alloc;
+	}  // _________________________________________________________
 
 /** create a (mutable) byte array from an asciiz string, return offset */
 size_t					bzb_from_asciiz
@@ -60,18 +132,15 @@ size_t					bzb_from_asciiz
 	size_t				str_len;
 	size_t				alloc_len;
 	size_t				bytes;
-	t_bytes *			barr;
 
 	assert( src != NULL);
 	MLOG_PRINTF( stderr, "*** B-A: from ascii \"%s\"\n", src);
 	str_len = strlen( src);
 
-	alloc_len = sizeof( t_bytes) + str_len + 1;
+	alloc_len = bzb_hdr_size( *a_stack) + str_len + 1;
 	bytes = bza_cons_stk_frame( catcher, a_stack, alloc_len);
-	barr = (t_bytes *) bza_get_frame_ptr( catcher, *a_stack, bytes);
-	barr->len = str_len;
-	barr->alloc = str_len + 1;  // TODO: reuse size in container
-	strcpy( barr->data, src);
+	// TODO: reuse size in container
+	strcpy( bzb_set_hdr( *a_stack, bytes, str_len, str_len + 1), src);
 	return bytes;
 	}  // _________________________________________________________
 
@@ -93,21 +162,79 @@ size_t					bzb_from_fixed_mem
 	{
 	size_t				alloc_len;
 	size_t				bytes;
-	t_bytes *			barr;
+	char *				data;
 
 	assert( val != NULL);
 	MLOG_PRINTF( stderr, "*** B-A: from fixed mem \"%d b at %d\"\n", val_len, ( (int) val) );
 
-	alloc_len = sizeof( t_bytes) + val_len + 1;
+	alloc_len = bzb_hdr_size( *a_stack) + val_len + 1;
 	bytes = bza_cons_stk_frame( catcher, a_stack, alloc_len);
-	barr = (t_bytes *) bza_get_frame_ptr( catcher, *a_stack, bytes);
-	barr->len = val_len;
-	barr->alloc = val_len + 1;  // TODO: reuse size in container
-	memcpy( barr->data, val, val_len);
-	barr->data[ val_len ] = '\0';
+	// TODO: reuse size in container
+	data = bzb_set_hdr( *a_stack, bytes, val_len, val_len + 1);
+	memcpy( data, val, val_len);
+	data[ val_len ] = '\0';
 	return bytes;
 	}  // _________________________________________________________
 
+/**
+ * create several (mutable) byte arrays from sized memory buffers
+ *  in one batch, putting their offsets in "offs".
+ */
+void					bzb_from_fixed_mems
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack * *			a_stack,		// a stack on/in which to
+										// allocate the frames
+										// (which may be relocated!)
+	const
+	char * const *		vals,			// value data bytes  --
+										//  MUST BE "IMMOVABLE"
+										//  for the duration of this call
+										//  (should not be in given stack)
+										//  copies will be saved at completion
+	const
+	size_t *			val_lens,		// sizeof each val
+	size_t				num,			// number of byte arrays
+	size_t *			offs			// offset of each byte array (output)
+	)
+	{
+	size_t				alloc_lens[ BZB_MAX_BATCH ];
+	size_t				batch;
+	size_t				idx;
+	char *				data;
+
+	assert( ( vals != NULL) && ( val_lens != NULL) && ( offs != NULL) );
+	MLOG_PRINTF( stderr, "*** B-A: from %d fixed mems\n", (int) num);
+
+	for ( ; num > 0; num -= batch)
+
+		{
+		batch = ( num < BZB_MAX_BATCH) ? num : BZB_MAX_BATCH;
+		for ( idx = 0; idx < batch; idx++)
+
+			{
+			assert( vals[ idx ] != NULL);
+			alloc_lens[ idx ] = bzb_hdr_size( *a_stack) + val_lens[ idx ] + 1;
+			}  // size each array
+
+		bza_cons_stk_frames( catcher, a_stack, alloc_lens, batch, offs);
+		for ( idx = 0; idx < batch; idx++)
+
+			{
+			// TODO: reuse size in container
+			data = bzb_set_hdr( *a_stack, offs[ idx ], val_lens[ idx ],
+					val_lens[ idx ] + 1);
+			memcpy( data, vals[ idx ], val_lens[ idx ]);
+			data[ val_lens[ idx ] ] = '\0';
+			}  // fill each array
+
+		vals += batch;
+		val_lens += batch;
+		offs += batch;
+		}  // each batch
+
+	}  // _________________________________________________________
+
 /** create a (mutable) byte array buffer with an initial size */
 size_t					bzb_init_size
 	(
@@ -120,16 +247,13 @@ size_t					bzb_init_size
 	{
 	size_t				alloc_len;
 	size_t				bytes;
-	t_bytes *			barr;
 
 	MLOG_PRINTF( stderr, "*** B-A: reserved size %d\n", (int) size);
 
-	alloc_len = sizeof( t_bytes) + ( size + 1);
+	alloc_len = bzb_hdr_size( *a_stack) + ( size + 1);
 	bytes = bza_cons_stk_frame( catcher, a_stack, alloc_len);
-	barr = (t_bytes *) bza_get_frame_ptr( catcher, *a_stack, bytes);
-	barr->len = 0;
-	barr->alloc = ( size + 1);  // TODO: reuse size in container
-	barr->data[ 0 ] = '\0';
+	// TODO: reuse size in container
+	bzb_set_hdr( *a_stack, bytes, 0, ( size + 1) )[ 0 ] = '\0';
 	return bytes;
 	}  // _________________________________________________________
 
@@ -205,33 +329,18 @@ size_t					bzb_subarray
 	int					eff_len;
 	size_t				alloc_len;
 	size_t				bytes;
-	t_bytes *			barr;
-	char *				dptr;
-	const
-	char *				sptr;
-	int					sidx;
+	char *				data;
 
 	MLOG_PRINTF( stderr, "*** B-A: from subarray @%d[ %d, %d ]\n", (int) src, from, len);
 
-	calc_bounds( catcher, bzb_size( catcher, *a_stack, src), from, len,
+	calc_bounds( catcher, bzb_fast_size( *a_stack, src), from, len,
 			&start, &stop, &eff_len);
-	alloc_len = sizeof( t_bytes) + ( stop - start) + 2;
+	alloc_len = bzb_hdr_size( *a_stack) + ( stop - start) + 2;
 	bytes = bza_cons_stk_frame( catcher, a_stack, alloc_len);
-	barr = (t_bytes *) bza_get_frame_ptr( catcher, *a_stack, bytes);
-	barr->len = eff_len;
-	barr->alloc = eff_len + 1;  // TODO: reuse size in container
-	dptr = &( barr->data[ 0 ]);
-	sptr = bzb_to_asciiz( catcher, *a_stack, src);  // just get the pointer
-	// TODO: tune this tight
-	// or, just replace it with memcpy call!
-	for ( sidx = start; sidx <= stop; sidx++)
-
-		{
-		*dptr = sptr[ sidx ];
-		dptr++;
-		}  // copy each byte
-
-	*dptr = '\0';
+	// TODO: reuse size in container
+	data = bzb_set_hdr( *a_stack, bytes, eff_len, eff_len + 1);
+	memcpy( data, &( bzb_fast_data( *a_stack, src)[ start ]), eff_len);
+	data[ eff_len ] = '\0';
 
 	return bytes;
 	}  // _________________________________________________________
@@ -256,7 +365,7 @@ size_t					get_cat_src_len
 
 		{
 		assert( ( *src_ptr) <= ( ( *a_stack)->top) );
-		src_len += bzb_size( catcher, *a_stack, *src_ptr);
+		src_len += bzb_fast_size( *a_stack, *src_ptr);
 		}  // sum each src size
 
 	return src_len;
@@ -278,24 +387,21 @@ size_t					bzb_concat
 	size_t *			src_ptr;
 	size_t				alloc_len;
 	size_t				bytes;
-	t_bytes *			barr;
 	char *				dptr;
 
 	assert( srcs != NULL);
 	MLOG_PRINTF( stderr, "*** B-A: concat arrays @%d...\n", (int) srcs[ 0 ]);
 
 	src_len = get_cat_src_len( catcher, a_stack, srcs);
-	alloc_len = sizeof( t_bytes) + src_len + 1;
+	alloc_len = bzb_hdr_size( *a_stack) + src_len + 1;
 	bytes = bza_cons_stk_frame( catcher, a_stack, alloc_len);
-	barr = (t_bytes *) bza_get_frame_ptr( catcher, *a_stack, bytes);
-	barr->len = src_len;
-	barr->alloc = src_len + 1;  // TODO: reuse size in container
-	dptr = &( barr->data[ 0 ]);
+	// TODO: reuse size in container
+	dptr = bzb_set_hdr( *a_stack, bytes, src_len, src_len + 1);
 	for ( src_ptr = srcs; *src_ptr; src_ptr++)
 
 		{
-		src_len = bzb_size( catcher, *a_stack, *src_ptr);
-		memcpy( dptr, bzb_to_asciiz( catcher, *a_stack, *src_ptr), src_len);
+		src_len = bzb_fast_size( *a_stack, *src_ptr);
+		memcpy( dptr, bzb_fast_data( *a_stack, *src_ptr), src_len);
 		dptr += src_len;
 		}  // sum each src size
 
@@ -318,14 +424,14 @@ size_t					bzb_concat_to
 	{
 	size_t				srcs[] = { dst, src, 0 };
 	size_t				tot_len;
-	t_bytes *			barr;
 	size_t				new_dst;
+	size_t				dst_len;
 	size_t				src_len;
 
 	tot_len = get_cat_src_len( catcher, a_stack, srcs);
-	barr = (t_bytes *) bza_get_frame_ptr( catcher, *a_stack, dst);
+	dst_len = bzb_fast_size( *a_stack, dst);
 
-	if ( tot_len < barr->alloc)
+	if ( tot_len < bzb_alloc_size( *a_stack, dst) )
 		{
 		// "un-discard" the original, which we are reusing
 		bzb_ref( catcher, *a_stack,
@@ -338,18 +444,15 @@ size_t					bzb_concat_to
 				( tot_len + ( tot_len >> 1) ) );
 
 		// copy existing bytes
-		barr = (t_bytes *) bza_get_frame_ptr( catcher, *a_stack, new_dst);
-		src_len = bzb_size( catcher, *a_stack, dst);
-		memcpy( barr->data,
-				bzb_to_asciiz( catcher, *a_stack, dst), src_len);
-		barr->len = src_len;
+		memcpy( bzb_fast_data( *a_stack, new_dst),
+				bzb_fast_data( *a_stack, dst), dst_len);
 		}  // outgrew current buffer?
 
-	src_len = bzb_size( catcher, *a_stack, src);
-	memcpy( &( barr->data[ barr->len ]),
-			bzb_to_asciiz( catcher, *a_stack, src), src_len);
-	barr->len += src_len;
-	barr->data[ barr->len ] = '\0';
+	src_len = bzb_fast_size( *a_stack, src);
+	memcpy( &( bzb_fast_data( *a_stack, new_dst)[ dst_len ]),
+			bzb_fast_data( *a_stack, src), src_len);
+	bzb_set_len( *a_stack, new_dst, dst_len + src_len);
+	bzb_fast_data( *a_stack, new_dst)[ dst_len + src_len ] = '\0';
 
 	return new_dst;
 	}  // _________________________________________________________
@@ -469,6 +572,57 @@ void					bzb_deref
 	bza_deref_stk_frame( catcher, a_stack, bytes);
 	}  // _________________________________________________________
 
+/**
+ * return the offset of a byte array after its stack was compacted
+ *  (byte arrays hold no other offsets, so nothing inside changes).
+ */
+size_t					bzb_relocate
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack,		// a stack on/in which 
+										// the frame is allocated
+	size_t				bytes,			// offset of byte array
+										//  before compaction (or 0)
+	const
+	t_remap *			remap			// translation from bza_compact
+	)
+	{
+	MLOG_PRINTF( stderr, "*** B-A: relocate frame off %d\n", (int) bytes);  // TEMP
+	return ( bytes != 0) ? bza_remap_off( remap, bytes) : 0;
+	}  // _________________________________________________________
+
+/**
+ * copy a byte array from one stack onto another, return the offset
+ *  of the copy (0 for 0).
+ *  (byte arrays hold no other offsets, so the frame is copied as is,
+ *  unless just one of the stacks is BZA_OPT_OFF32).
+ */
+size_t					bzb_transfer
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			src,			// stack on/in which the byte array
+										//  is allocated (not changed)
+	t_stack * *			a_dst,			// a (different) stack on/in which to
+										// allocate the copy
+										// (which may be relocated!)
+	size_t				bytes			// offset of byte array in "src"
+										//  (or 0)
+	)
+	{
+	if ( bytes == 0)
+		{
+		return 0;  // === done ===
+		}  // nothing to copy?
+
+	if ( ( src->flags ^ ( *a_dst)->flags) & BZA_OPT_OFF32)
+		{
+		return bzb_from_fixed_mem( catcher, a_dst,
+				bzb_fast_data( src, bytes), bzb_fast_size( src, bytes) );
+		}  // different header layout?
+
+	return bza_transfer( catcher, src, a_dst, bytes);
+	}  // _________________________________________________________
+
 /** return the size of the byte array (usable bytes) */
 size_t					bzb_size
 	(
@@ -478,10 +632,8 @@ size_t					bzb_size
 	size_t				bytes			// offset of byte array
 	)
 	{
-	t_bytes *			barr;
-
-	barr = (t_bytes *) bza_get_frame_ptr( catcher, a_stack, bytes);
-	return barr->len;
+	bza_get_frame_ptr( catcher, a_stack, bytes);  // (checks "bytes")
+	return bzb_fast_size( a_stack, bytes);
 	}  // _________________________________________________________
 
 /**
@@ -497,11 +649,9 @@ char *					bzb_to_asciiz
 	size_t				bytes			// offset of byte array
 	)
 	{
-	t_bytes *			barr;
-
-	barr = (t_bytes *) bza_get_frame_ptr( catcher, a_stack, bytes);
+	bza_get_frame_ptr( catcher, a_stack, bytes);  // (checks "bytes")
 	// note that we always have an extra '\0' just pass the end of the array
-	return barr->data;
+	return bzb_fast_data( a_stack, bytes);
 	}  // _________________________________________________________
 
 
@@ -40,6 +40,29 @@ size_t					bzb_from_fixed_mem
 	)
 	;
 
+/**
+ * create several (mutable) byte arrays from sized memory buffers
+ *  in one batch, putting their offsets in "offs".
+ */
+void					bzb_from_fixed_mems
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack * *			a_stack,		// a stack on/in which to
+										// allocate the frames
+										// (which may be relocated!)
+	const
+	char * const *		vals,			// value data bytes  --
+										//  MUST BE "IMMOVABLE"
+										//  for the duration of this call
+										//  (should not be in given stack)
+										//  copies will be saved at completion
+	const
+	size_t *			val_lens,		// sizeof each val
+	size_t				num,			// number of byte arrays
+	size_t *			offs			// offset of each byte array (output)
+	)
+	;
+
 /** create a (mutable) byte array buffer with an initial size */
 size_t					bzb_init_size
 	(
@@ -136,6 +159,39 @@ void					bzb_deref
 	)
 	;
 
+/**
+ * return the offset of a byte array after its stack was compacted
+ *  (byte arrays hold no other offsets, so nothing inside changes).
+ */
+size_t					bzb_relocate
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack,		// a stack on/in which 
+										// the frame is allocated
+	size_t				bytes,			// offset of byte array
+										//  before compaction (or 0)
+	const
+	t_remap *			remap			// translation from bza_compact
+	)
+	;
+
+/**
+ * copy a byte array from one stack onto another, return the offset
+ *  of the copy (0 for 0).
+ */
+size_t					bzb_transfer
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			src,			// stack on/in which the byte array
+										//  is allocated (not changed)
+	t_stack * *			a_dst,			// a (different) stack on/in which to
+										// allocate the copy
+										// (which may be relocated!)
+	size_t				bytes			// offset of byte array in "src"
+										//  (or 0)
+	)
+	;
+
 /** return the size of the byte array (usable bytes) */
 size_t					bzb_size
 	(
@@ -162,6 +218,71 @@ char *					bzb_to_asciiz
 	)
 	;
 
+/**
+ * byte array layout (internal use only!  for the inline accessors below)
+ */
+typedef struct			t_bytes
+	{
+	// TODO: immutable
+	size_t				len;			// length in usable bytes,
+										//  excludes hidden terminator (\0)
+										//  added just in case used as asciiz
+	size_t				alloc;			// size allocated,
+										//  may be larger than len.
+	char				data[ 0 ];		// variable size buffer for bytes
+	}					t_bytes;
+
+/**
+ * byte array layout on a BZA_OPT_OFF32 stack (internal use only!)
+ */
+typedef struct			t_bytes32
+	{
+	uint32_t			len;			// as t_bytes
+	uint32_t			alloc;			// as t_bytes
+	char				data[ 0 ];		// as t_bytes
+	}					t_bytes32;
+
+/**
+ * return the size of the byte array (usable bytes),
+ *  as bzb_size does, but inline (see bza_fast_frame_ptr).
+ */
+static inline
+size_t					bzb_fast_size
+	(
+	t_stack *			a_stack,		// a stack on/in which 
+										// the frame is allocated
+	size_t				bytes			// offset of byte array
+	)
+	{
+	void *				barr;
+
+	barr = bza_fast_frame_ptr( a_stack, bytes);
+	return ( a_stack->flags & BZA_OPT_OFF32) ?
+			( (t_bytes32 *) barr)->len : ( (t_bytes *) barr)->len;
+	}  // _________________________________________________________
+
+/**
+ * return the bytes of a byte array (with a hidden \0 after them),
+ *  as bzb_to_asciiz does, but inline (see bza_fast_frame_ptr)
+ *  and writable.
+ *  WARNING:  the data may be relocated by a subsequent allocation,
+ *  so use and discard this value BEFORE anything else is allocated.
+ */
+static inline
+char *					bzb_fast_data
+	(
+	t_stack *			a_stack,		// a stack on/in which 
+										// the frame is allocated
+	size_t				bytes			// offset of byte array
+	)
+	{
+	void *				barr;
+
+	barr = bza_fast_frame_ptr( a_stack, bytes);
+	return ( a_stack->flags & BZA_OPT_OFF32) ?
+			( (t_bytes32 *) barr)->data : ( (t_bytes *) barr)->data;
+	}  // _________________________________________________________
+
 #endif  // BZRT_BYTES_H
 
 // vi: ts=4 sw=4 ai
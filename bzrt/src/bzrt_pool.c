@@ -0,0 +1,362 @@
+/**
+ * Stack pool primitives for buzzard.
+ *
+ * $Id: $
+ */
+/*
+    buzzard:  blaze runtime (so far, just a simple memory management library)
+
+    Copyright (C) 2010, Robin R Anderson
+    roboprog@yahoo.com
+    PO 1608
+    Shingle Springs, CA 95682
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "bzrt_pool.h"
+
+// #define DO_LOG	1
+#include "_log.h"
+
+/** a thread's cache of idle stacks, for one pool */
+typedef struct			t_pool_cache
+	{
+	t_stack_pool *		pool;			// pool to which the stacks belong
+	int					num;			// number of stacks cached
+	t_stack *			stacks[0];		// cached stacks (pool->opts.cache_max)
+	}					t_pool_cache;
+
+/** raise an error (e.g. for a failed system call) */
+static
+void					pool_fail_or_die
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	const
+	char *				what			// description of what failed
+	)
+	{
+	MLOG_PRINTF( stderr, "\t%s\n", what);
+	if ( catcher != NULL)
+		{
+		longjmp( *catcher, 1);  // === abort ===
+		}  // error handler?
+
+	// just die, then
+	assert( what == NULL);
+	}  // _________________________________________________________
+
+/** allocate a block of memory, or die */
+static
+void *					pool_alloc_or_die
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	size_t				size			// number of bytes requested
+	)
+	{
+	void *				blk;
+
+	blk = malloc( size);
+	if ( blk == NULL)
+		{
+		pool_fail_or_die( catcher, "malloc failed");
+		}  // out of memory?
+
+	return blk;
+	}  // _________________________________________________________
+
+/**
+ * put an idle stack on the shared list, or free it if the list is full.
+ *  The pool must NOT be locked.
+ */
+static
+void					pool_share
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack_pool *		pool,			// pool to which the stack belongs
+	t_stack *			stack			// idle (reset) stack
+	)
+	{
+	pthread_mutex_lock( &( pool->lock) );
+	if ( pool->num_shared < pool->opts.shared_max)
+		{
+		pool->shared[ pool->num_shared++ ] = stack;
+		stack = NULL;
+		}  // room?
+	else
+		{
+		pool->num_freed++;
+		}  // no room:  free it
+
+	pthread_mutex_unlock( &( pool->lock) );
+
+	if ( stack != NULL)
+		{
+		bza_dest_stack( catcher, &stack);
+		}  // not kept?
+
+	}  // _________________________________________________________
+
+/** move a thread's cached stacks to the shared list */
+static
+void					pool_flush_cache
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_pool_cache *		cache			// a thread's cache
+	)
+	{
+	while ( cache->num > 0)
+
+		{
+		pool_share( catcher, cache->pool, cache->stacks[ --( cache->num) ]);
+		}  // give up each stack
+
+	}  // _________________________________________________________
+
+/** thread exit:  give up the thread's cached stacks, free the cache */
+static
+void					pool_cache_dtor
+	(
+	void *				arg				// a thread's cache
+	)
+	{
+	pool_flush_cache( NULL, (t_pool_cache *) arg);
+	free( arg);
+	}  // _________________________________________________________
+
+/** create a new (empty) pool of stacks */
+t_stack_pool *			bza_cons_pool
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	const
+	t_pool_opts *		opts			// construction options (null for defaults)
+	)
+	{
+	static const
+	t_pool_opts			DEFAULT_OPTS;	// all 0s
+
+	t_stack_pool *		pool;
+
+	if ( opts == NULL)
+		{
+		opts = &DEFAULT_OPTS;
+		}  // use defaults?
+
+	pool = pool_alloc_or_die( catcher, sizeof( t_stack_pool) );
+	pool->opts = *opts;
+	if ( pool->opts.trim_size == 0)
+		{
+		pool->opts.trim_size = ( opts->stack_opts.initial_size > 0) ?
+				opts->stack_opts.initial_size : SIZE_MAX;
+		}  // default:  back to the initial size (if any)?
+
+	if ( pool->opts.cache_max <= 0)
+		{
+		pool->opts.cache_max = BZA_POOL_DEF_CACHE;
+		}  // default cache size?
+
+	if ( pool->opts.shared_max <= 0)
+		{
+		pool->opts.shared_max = BZA_POOL_DEF_SHARED;
+		}  // default shared list size?
+
+	if ( pthread_key_create( &( pool->cache_key), pool_cache_dtor) != 0)
+		{
+		free( pool);
+		pool_fail_or_die( catcher, "pthread_key_create failed");
+		return NULL;  // dummy
+		}  // out of thread keys?
+
+	pool->shared = pool_alloc_or_die( catcher,
+			pool->opts.shared_max * sizeof( t_stack *) );
+
+	pthread_mutex_init( &( pool->lock), NULL);
+	pool->num_shared = 0;
+	pool->num_created = 0;
+	pool->num_freed = 0;
+	pool->num_trimmed = 0;
+	return pool;
+	}  // _________________________________________________________
+
+/**
+ * take an empty stack from the pool (from the calling thread's cache,
+ *  else the shared list, else a new one).
+ */
+t_stack *				bza_pool_get
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack_pool *		pool			// pool from which to take a stack
+	)
+	{
+	t_pool_cache *		cache;
+	t_stack *			stack;
+
+	// TODO: better error handling
+	assert( pool != NULL);
+
+	cache = pthread_getspecific( pool->cache_key);
+	if ( ( cache != NULL) && ( cache->num > 0) )
+		{
+		return cache->stacks[ --( cache->num) ];  // === done ===
+		}  // cached (no locking)?
+
+	stack = NULL;
+	pthread_mutex_lock( &( pool->lock) );
+	if ( pool->num_shared > 0)
+		{
+		stack = pool->shared[ --( pool->num_shared) ];
+		}  // shared?
+	else
+		{
+		pool->num_created++;
+		}  // must make one
+
+	pthread_mutex_unlock( &( pool->lock) );
+
+	if ( stack == NULL)
+		{
+		stack = bza_cons_stack_opts( catcher, &( pool->opts.stack_opts) );
+		}  // none idle?
+
+	return stack;
+	}  // _________________________________________________________
+
+/**
+ * return a stack to the pool:  it is reset (all frames dropped),
+ *  trimmed if it grew past the pool's trim size,
+ *  and kept for reuse (or freed if the pool is full).
+ */
+void					bza_pool_put
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack_pool *		pool,			// pool to which the stack belongs
+	t_stack * *			a_stack			// stack to be returned
+										//  (set to null)
+	)
+	{
+	t_stack *			stack;
+	t_pool_cache *		cache;
+
+	// TODO: better error handling
+	assert( pool != NULL);
+	assert( a_stack != NULL);
+	assert( *a_stack != NULL);
+
+	stack = *a_stack;
+	*a_stack = NULL;
+	bza_reset_stack( catcher, stack);
+	if ( ( pool->opts.trim_size > sizeof( t_stack) ) &&
+		 ( bza_trim( catcher, &stack,
+				pool->opts.trim_size - sizeof( t_stack) ) > 0) )
+		{
+		pthread_mutex_lock( &( pool->lock) );
+		pool->num_trimmed++;
+		pthread_mutex_unlock( &( pool->lock) );
+		}  // grew past the trim size?
+
+	cache = pthread_getspecific( pool->cache_key);
+	if ( cache == NULL)
+		{
+		cache = pool_alloc_or_die( catcher, sizeof( t_pool_cache) +
+				( pool->opts.cache_max * sizeof( t_stack *) ) );
+		cache->pool = pool;
+		cache->num = 0;
+		pthread_setspecific( pool->cache_key, cache);
+		}  // thread's first return?
+
+	if ( cache->num < pool->opts.cache_max)
+		{
+		cache->stacks[ cache->num++ ] = stack;
+		return;  // === done ===
+		}  // room in the cache (no locking)?
+
+	pool_share( catcher, pool, stack);
+	}  // _________________________________________________________
+
+/**
+ * move the calling thread's cached stacks to the shared list
+ *  (done automatically when a thread exits).
+ */
+void					bza_pool_flush
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack_pool *		pool			// pool of the cache to be flushed
+	)
+	{
+	t_pool_cache *		cache;
+
+	// TODO: better error handling
+	assert( pool != NULL);
+
+	cache = pthread_getspecific( pool->cache_key);
+	if ( cache != NULL)
+		{
+		pool_flush_cache( catcher, cache);
+		}  // anything cached?
+
+	}  // _________________________________________________________
+
+/**
+ * free up a pool and all of its idle stacks.
+ *  Other threads must have returned their stacks and exited
+ *  (or called bza_pool_flush) first.
+ */
+void					bza_dest_pool
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack_pool * *	a_pool			// pool to be torn down
+	)
+	{
+	t_stack_pool *		pool;
+	t_pool_cache *		cache;
+
+	// TODO: better error handling
+	assert( a_pool != NULL);
+	assert( *a_pool != NULL);
+
+	pool = *a_pool;
+	cache = pthread_getspecific( pool->cache_key);
+	if ( cache != NULL)
+		{
+		while ( cache->num > 0)
+
+			{
+			bza_dest_stack( catcher, &( cache->stacks[ --( cache->num) ]) );
+			}  // free each cached stack
+
+		pthread_setspecific( pool->cache_key, NULL);
+		free( cache);
+		}  // calling thread has a cache?
+
+	while ( pool->num_shared > 0)
+
+		{
+		bza_dest_stack( catcher, &( pool->shared[ --( pool->num_shared) ]) );
+		}  // free each shared stack
+
+	pthread_key_delete( pool->cache_key);
+	pthread_mutex_destroy( &( pool->lock) );
+	free( pool->shared);
+	free( pool);
+	*a_pool = NULL;
+	}  // _________________________________________________________
+
+// vi: ts=4 sw=4 ai
+// *** EOF ***
@@ -0,0 +1,118 @@
+/**
+ * stack pool primitives for buzzard:
+ *  pre-sized, reset stacks handed out to (and taken back from)
+ *  worker threads, so that steady state tasks never touch malloc.
+ * Each thread keeps a small cache of stacks;  beyond that,
+ *  stacks go to (and come from) a list shared by all threads.
+ * Note that none of these routines will return or set an error value  --
+ * they will either exit or longjmp (throw an exception)
+ *
+ * $Id: $
+ */
+
+#ifndef _BZRT_POOL_H
+#define _BZRT_POOL_H
+
+#include <pthread.h>
+
+#include "bzrt_alloc.h"
+
+/** pool construction options (zero fill for defaults) */
+typedef struct			t_pool_opts
+	{
+	t_stack_opts		stack_opts;		// options for each new stack
+										//  ("initial_size" pre-sizes it)
+	size_t				trim_size;		// a returned stack which grew past
+										//  this size (including housekeeping
+										//  fields, like "initial_size")
+										//  is shrunk back to it (see
+										//  bza_trim), 0 for
+										//  stack_opts.initial_size
+										//  (no trimming if that is 0 too)
+	int					cache_max;		// stacks kept per thread,
+										//  0 for BZA_POOL_DEF_CACHE
+	int					shared_max;		// stacks kept in the shared list,
+										//  0 for BZA_POOL_DEF_SHARED
+										//  (any more are freed)
+	}					t_pool_opts;
+
+/** default number of stacks cached per thread */
+#define BZA_POOL_DEF_CACHE	4
+
+/** default number of stacks kept in a pool's shared list */
+#define BZA_POOL_DEF_SHARED	64
+
+/** a pool of stacks */
+typedef struct			t_stack_pool
+	{
+	t_pool_opts			opts;			// options (defaults filled in)
+	pthread_key_t		cache_key;		// per thread cache (t_pool_cache)
+	pthread_mutex_t		lock;			// guards the fields below
+	t_stack * *			shared;			// shared list of idle stacks
+	int					num_shared;		// number of stacks in list
+	size_t				num_created;	// stacks constructed, so far
+	size_t				num_freed;		// stacks destroyed (no room), so far
+	size_t				num_trimmed;	// stacks shrunk on return, so far
+	}					t_stack_pool;
+
+/** create a new (empty) pool of stacks */
+t_stack_pool *			bza_cons_pool
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	const
+	t_pool_opts *		opts			// construction options (null for defaults)
+	)
+	;
+
+/**
+ * take an empty stack from the pool (from the calling thread's cache,
+ *  else the shared list, else a new one).
+ */
+t_stack *				bza_pool_get
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack_pool *		pool			// pool from which to take a stack
+	)
+	;
+
+/**
+ * return a stack to the pool:  it is reset (all frames dropped),
+ *  trimmed if it grew past the pool's trim size,
+ *  and kept for reuse (or freed if the pool is full).
+ */
+void					bza_pool_put
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack_pool *		pool,			// pool to which the stack belongs
+	t_stack * *			a_stack			// stack to be returned
+										//  (set to null)
+	)
+	;
+
+/**
+ * move the calling thread's cached stacks to the shared list
+ *  (done automatically when a thread exits).
+ */
+void					bza_pool_flush
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack_pool *		pool			// pool of the cache to be flushed
+	)
+	;
+
+/**
+ * free up a pool and all of its idle stacks.
+ *  Other threads must have returned their stacks and exited
+ *  (or called bza_pool_flush) first.
+ */
+void					bza_dest_pool
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack_pool * *	a_pool			// pool to be torn down
+	)
+	;
+
+#endif  // _BZRT_POOL_H
+
+// vi: ts=4 sw=4 ai
+// *** EOF ***
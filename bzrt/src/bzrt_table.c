@@ -47,6 +47,9 @@ typedef struct			t_table_interior
 	size_t				byte_val_nodes;	// variable size array of t_table
 										//  entries, indexed by 0..255
 										//  byte value for currrent position
+										//  (0 if none yet)
+	size_t				val_off;		// value byte array for a key
+										//  ending at this level (or 0)
 	}					t_table_interior;
 
 /** recursive data structure to interior nodes and leaves. */
@@ -67,6 +70,71 @@ typedef struct			t_table
 static
 size_t					ZERO_BYTES[ 256 ];  // assume 0 filled static data
 
+/**
+ * return the size of a child entry in an interior node's array:
+ *  32 bits on a BZA_OPT_OFF32 stack.
+ */
+static inline
+size_t					bzt_child_size
+	(
+	t_stack *			a_stack			// a stack on/in which 
+										// the table is allocated
+	)
+	{
+	return ( a_stack->flags & BZA_OPT_OFF32) ?
+			sizeof( uint32_t) : sizeof( size_t);
+	}  // _________________________________________________________
+
+/** return the number of entries in an array of children */
+static inline
+int						bzt_num_children
+	(
+	t_stack *			a_stack,		// a stack on/in which 
+										// the table is allocated
+	size_t				nodes			// offset of array of children
+	)
+	{
+	return (int) ( bzb_fast_size( a_stack, nodes) / bzt_child_size( a_stack) );
+	}  // _________________________________________________________
+
+/** return a child (node offset, or 0) from an array of children */
+static inline
+size_t					bzt_child
+	(
+	t_stack *			a_stack,		// a stack on/in which 
+										// the table is allocated
+	size_t				nodes,			// offset of array of children
+	int					idx				// byte value (0..255)
+	)
+	{
+	return ( a_stack->flags & BZA_OPT_OFF32) ?
+			( (uint32_t *) bzb_fast_data( a_stack, nodes) )[ idx ] :
+			( (size_t *) bzb_fast_data( a_stack, nodes) )[ idx ];
+	}  // _________________________________________________________
+
+/** set a child (node offset, or 0) in an array of children */
+static inline
+void					bzt_put_child
+	(
+	t_stack *			a_stack,		// a stack on/in which 
+										// the table is allocated
+	size_t				nodes,			// offset of array of children
+	int					idx,			// byte value (0..255)
+	size_t				child			// offset of child node
+	)
+	{
+	if ( a_stack->flags & BZA_OPT_OFF32)
+		{
+		( (uint32_t *) bzb_fast_data( a_stack, nodes) )[ idx ] =
+				(uint32_t) child;
+		}  // 32 bit entries?
+	else
+		{
+		( (size_t *) bzb_fast_data( a_stack, nodes) )[ idx ] = child;
+		}  // full size entries
+
+	}  // _________________________________________________________
+
 /** Create an empty table (return offset). */
 size_t					bzt_init
 	(
@@ -80,7 +148,7 @@ size_t					bzt_init
 	t_table *			innards;
 
 	table = bza_cons_stk_frame( catcher, a_stack, sizeof( t_table) );
-	innards = (t_table *) bza_get_frame_ptr( catcher, *a_stack, table);
+	innards = (t_table *) bza_fast_frame_ptr( *a_stack, table);
 	innards->is_leaf = 1;
 	innards->td.leaf.key_off = 0;
 	innards->td.leaf.val_off = 0;
@@ -97,15 +165,54 @@ void					bzt_deref
 	)
 	{
 	t_table *			innards;
+	size_t				nodes;
+	size_t				val_off;
+	size_t				child;
+	int					num_nodes;
+	int					idx;
 
 	// check for 1 -> 0 transition, release contents
 	if ( bza_get_ref_count( catcher, a_stack, table) == 1)
 		{
-		// TODO: recursive deallocation of multiple values
-		// TODO:  check for nothing in fact stored (likely handled by real implementation anyway, unlike placholder)
-		innards = (t_table *) bza_get_frame_ptr( catcher, a_stack, table);
-		bzb_deref( catcher, a_stack, innards->td.leaf.key_off);
-		bzb_deref( catcher, a_stack, innards->td.leaf.val_off);
+		// (nothing moves while releasing, so the pointers stay put)
+		innards = (t_table *) bza_fast_frame_ptr( a_stack, table);
+		if ( innards->is_leaf)
+			{
+			if ( innards->td.leaf.key_off != 0)
+				{
+				bzb_deref( catcher, a_stack, innards->td.leaf.key_off);
+				bzb_deref( catcher, a_stack, innards->td.leaf.val_off);
+				}  // anything stored?
+
+			}  // leaf node?
+		else
+			{
+			nodes = innards->td.interior.byte_val_nodes;
+			val_off = innards->td.interior.val_off;
+			if ( nodes != 0)
+				{
+				num_nodes = bzt_num_children( a_stack, nodes);
+				for ( idx = 0; idx < num_nodes; idx++)
+
+					{
+					child = bzt_child( a_stack, nodes, idx);
+					if ( child != 0)
+						{
+						bzt_deref( catcher, a_stack, child);
+						}  // subtree for this byte value?
+
+					}  // release each child
+
+				bzb_deref( catcher, a_stack, nodes);
+				}  // any children?
+
+			if ( val_off != 0)
+				{
+				bzb_deref( catcher, a_stack, val_off);
+				}  // key ending here?
+
+			}  // interior node?
+
 		}  // final reference dropping away?
 	// else:  another reference is pending
 
@@ -113,55 +220,236 @@ void					bzt_deref
 	}  // _________________________________________________________
 
 /**
- * Save a key-value pair in an empty (leaf) level in the table.
- * */
+ * Return any value (byte-array containing the value),
+ *  matching the given key, from a leaf node in modified trie.
+ */
 static
-void					bzt_put_leaf
+size_t					bzt_get_leaf
 	(
 	jmp_buf *			catcher,		// error handler (or null for immediate death)
-	t_stack * *			a_stack,		// a stack on/in which to
+	t_stack *			a_stack,		// a stack on/in which to
 										// allocate the frame(s)
-										// (which may be relocated!)
 	t_table *			innards,		// current node in trie
 										//  IMMOVABLE for duration of call
 	const
-	char *				key,			// key data bytes  --
+	char *				key,			// (remainder of) key data bytes  --
 										//  MUST BE "IMMOVABLE"
 										//  for the duration of this call
 										//  (should not be in given stack)
 										//  a copy will be saved at completion
-	size_t				key_len,		// sizeof key
+	size_t				key_len			// sizeof key (remainder)
+	)
+	{
+	size_t				cur_key_len;
+	size_t				val_off;
+
+	if ( ! innards->td.leaf.key_off)
+		{
+		return 0;  // === done ===
+		}  // nothing stored yet?
+
+	cur_key_len = bzb_fast_size( a_stack, innards->td.leaf.key_off);
+	if ( key_len != cur_key_len)
+		{
+		return 0;  // === done ===
+		}  // different length key?
+
+	val_off = ( memcmp( key, 
+				bzb_fast_data( a_stack, innards->td.leaf.key_off),
+				cur_key_len) == 0) ?
+			innards->td.leaf.val_off : 0;
+	return val_off;
+	}  // _________________________________________________________
+
+/**
+ * Return the offset of the data for the next node in the (modified) trie,
+ *  based on the current byte value of the key.
+ */
+static
+size_t					bzt_get_interior
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack,		// a stack on/in which to
+										// allocate the frame(s)
+	t_table *			innards,		// current node in trie
+										//  IMMOVABLE for duration of call
+	char 				key_byte		// current byte from key
+										//  to be considered for a match
+	)
+	{
+	size_t				byte_val_nodes;
+	int					num_nodes;
+	int					node_idx;
+
+	byte_val_nodes = innards->td.interior.byte_val_nodes;
+	if ( byte_val_nodes == 0)
+		{
+		return 0;  // === fail ===
+		}  // no children yet?
+
+	num_nodes = bzt_num_children( a_stack, byte_val_nodes);
+	node_idx = ( (int) ( (unsigned char) key_byte) );
+	if ( node_idx >= num_nodes)
+		{
+		return 0;  // === fail ===
+		}  // no value defined for this byte (position)?
+
+	return bzt_child( a_stack, byte_val_nodes, node_idx);
+	}  // _________________________________________________________
+
+/**
+ * Return the offset of a table after its stack was compacted,
+ *  translating the offsets of all of its nodes, keys and values.
+ */
+size_t					bzt_relocate
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack,		// a stack on/in which 
+										// the frame is allocated
+	size_t				table,			// offset of lookup table
+										//  before compaction
 	const
-	char *				val,			// value data bytes  --
-										//  MUST BE "IMMOVABLE"
-										//  for the duration of this call
-										//  (should not be in given stack)
-										//  a copy will be saved at completion
-	size_t				val_len			// sizeof val
+	t_remap *			remap			// translation from bza_compact
 	)
 	{
-	size_t				prev_val;
+	size_t				new_table;
+	t_table *			innards;
+	size_t				nodes;
+	size_t				child;
+	int					num_children;
+	int					idx;
+
+	new_table = bza_remap_off( remap, table);
+	assert( new_table != 0);
+	innards = (t_table *) bza_fast_frame_ptr( a_stack, new_table);
+	if ( innards->is_leaf)
+		{
+		innards->td.leaf.key_off = bzb_relocate( catcher, a_stack,
+				innards->td.leaf.key_off, remap);
+		innards->td.leaf.val_off = bzb_relocate( catcher, a_stack,
+				innards->td.leaf.val_off, remap);
+		return new_table;  // === done ===
+		}  // leaf node?
 
-	innards->is_leaf = 1;
-	prev_val = innards->td.leaf.val_off;
+	// nothing is allocated here, so the pointers stay put
+	innards->td.interior.val_off = bzb_relocate( catcher, a_stack,
+			innards->td.interior.val_off, remap);
+	innards->td.interior.byte_val_nodes = bzb_relocate( catcher, a_stack,
+			innards->td.interior.byte_val_nodes, remap);
+	if ( innards->td.interior.byte_val_nodes == 0)
+		{
+		return new_table;  // === done ===
+		}  // no children?
+
+	nodes = innards->td.interior.byte_val_nodes;
+	num_children = bzt_num_children( a_stack, nodes);
+	for ( idx = 0; idx < num_children; idx++)
 
-	// TODO: dereference prev_val
-	// TODO: dereference any old value
+		{
+		child = bzt_child( a_stack, nodes, idx);
+		if ( child != 0)
+			{
+			bzt_put_child( a_stack, nodes, idx,
+					bzt_relocate( catcher, a_stack, child, remap) );
+			}  // subtree for this byte value?
 
-	innards->td.leaf.key_off = bzb_from_fixed_mem( catcher, a_stack, key, key_len);
-	innards->td.leaf.val_off = bzb_from_fixed_mem( catcher, a_stack, val, val_len);
+		}  // relocate each child
+
+	return new_table;
 	}  // _________________________________________________________
 
 /**
- * Save a key-value pair in the table.
+ * Copy a table, with all of its nodes, keys and values,
+ *  from one stack onto another (each frame is visited once),
+ *  return the offset of the copy.
+ */
+size_t					bzt_transfer
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			src,			// stack on/in which the table
+										//  is allocated (not changed)
+	t_stack * *			a_dst,			// a (different) stack on/in which to
+										// allocate the copy
+										// (which may be relocated!)
+	size_t				table			// offset of lookup table in "src"
+	)
+	{
+	size_t				new_table;
+	const
+	t_table *			innards;
+	t_table *			new_innards;
+	size_t				new_nodes;
+	size_t				key_off;
+	size_t				val_off;
+	size_t				nodes;
+	size_t				child;
+	int					num_children;
+	int					idx;
+
+	// the source is never allocated in, so its pointers stay put;
+	//  the copies are re-located after each allocation
+	new_table = bza_transfer( catcher, src, a_dst, table);
+	innards = (const t_table *) bza_fast_frame_ptr( src, table);
+	if ( innards->is_leaf)
+		{
+		key_off = bzb_transfer( catcher, src, a_dst, innards->td.leaf.key_off);
+		val_off = bzb_transfer( catcher, src, a_dst, innards->td.leaf.val_off);
+		new_innards = (t_table *) bza_fast_frame_ptr( *a_dst,
+				new_table);
+		new_innards->td.leaf.key_off = key_off;
+		new_innards->td.leaf.val_off = val_off;
+		return new_table;  // === done ===
+		}  // leaf node?
+
+	val_off = bzb_transfer( catcher, src, a_dst,
+			innards->td.interior.val_off);
+	nodes = innards->td.interior.byte_val_nodes;
+	num_children = ( nodes != 0) ? bzt_num_children( src, nodes) : 0;
+	if ( ( nodes != 0) && ( bzt_child_size( src) != bzt_child_size( *a_dst) ) )
+		{
+		// (every child is filled in below)
+		new_nodes = bzb_from_fixed_mem( catcher, a_dst, (char *) ZERO_BYTES,
+				num_children * bzt_child_size( *a_dst) );
+		}  // different entry size (BZA_OPT_OFF32 on one side only)?
+	else
+		{
+		new_nodes = bzb_transfer( catcher, src, a_dst, nodes);
+		}  // copy the array as is
+	new_innards = (t_table *) bza_fast_frame_ptr( *a_dst, new_table);
+	new_innards->td.interior.val_off = val_off;
+	new_innards->td.interior.byte_val_nodes = new_nodes;
+	if ( new_nodes == 0)
+		{
+		return new_table;  // === done ===
+		}  // no children?
+
+	for ( idx = 0; idx < num_children; idx++)
+
+		{
+		child = bzt_child( src, nodes, idx);
+		if ( child != 0)
+			{
+			child = bzt_transfer( catcher, src, a_dst, child);
+			bzt_put_child( *a_dst, new_nodes, idx, child);
+			}  // subtree for this byte value?
+
+		}  // copy each child
+
+	return new_table;
+	}  // _________________________________________________________
+
+/**
+ * Save a key-value pair in an empty leaf level in the table
+ *  (key and value arrays are made in one batch).
  * */
-void					bzt_put
+static
+void					bzt_put_leaf
 	(
 	jmp_buf *			catcher,		// error handler (or null for immediate death)
 	t_stack * *			a_stack,		// a stack on/in which to
 										// allocate the frame(s)
 										// (which may be relocated!)
-	size_t				table,			// offset of lookup table
+	size_t				table,			// offset of (leaf) node in trie
 	const
 	char *				key,			// key data bytes  --
 										//  MUST BE "IMMOVABLE"
@@ -178,148 +466,215 @@ void					bzt_put
 	size_t				val_len			// sizeof val
 	)
 	{
+	const
+	char *				mems[ 2 ];
+	size_t				lens[ 2 ];
+	size_t				offs[ 2 ];
 	t_table *			innards;
-	size_t				cur_key_len;
-	size_t				new_leaf;
-	t_table *			new_leaf_innards;
-	size_t				next_table_level;
-	int					cur_byte_idx;
-	size_t *			children;
 
-	// TODO:  make this beautiful, not hideous  :-(
+	mems[ 0 ] = key;
+	lens[ 0 ] = key_len;
+	mems[ 1 ] = val;
+	lens[ 1 ] = val_len;
+	bzb_from_fixed_mems( catcher, a_stack, mems, lens, 2, offs);
 
-	innards = (t_table *) bza_get_frame_ptr( catcher, *a_stack, table);
-	if ( innards->is_leaf)
-		{
-		// TODO: refactor bzt_put_leaf, so less duplication, useful for "split" of key
-
-		if ( innards->td.leaf.key_off == 0)
-			{
-			bzt_put_leaf( catcher, a_stack, innards, key, key_len, val, val_len);
-			return;  // === done ===
-			}  // empty leaf node?
+	// (the stack may have moved)
+	innards = (t_table *) bza_fast_frame_ptr( *a_stack, table);
+	innards->is_leaf = 1;
+	innards->td.leaf.key_off = offs[ 0 ];
+	innards->td.leaf.val_off = offs[ 1 ];
+	}  // _________________________________________________________
 
-		cur_key_len = bzb_size( catcher, *a_stack, innards->td.leaf.key_off);
-		if ( ( key_len == cur_key_len) &&
-			 ( memcmp( key, 
-					bzb_to_asciiz( catcher, *a_stack, innards->td.leaf.key_off),
-					cur_key_len) == 0) )
-			{
-			bzt_put_leaf( catcher, a_stack, innards, key, key_len, val, val_len);
-			return;  // === done ===
-			}  // update value for existing key in leaf node?
-
-		new_leaf = bza_cons_stk_frame( catcher, a_stack, sizeof( t_table) );
-		new_leaf_innards = (t_table *) bza_get_frame_ptr( catcher, *a_stack, table);
-		bzt_put_leaf( catcher, a_stack, new_leaf_innards,
-			key + 1, key_len - 1,
-			val, val_len);
-
-		bzb_deref( catcher, *a_stack, innards->td.leaf.key_off);
-		innards->td.leaf.key_off = 0;
-		innards->is_leaf = 0;
-		cur_byte_idx = (int) ( (unsigned char) key[ 0 ]);
-		innards->td.interior.byte_val_nodes = bzb_from_fixed_mem(
-				catcher, a_stack,
-				(char *) ZERO_BYTES,
-				( cur_byte_idx + 1) * sizeof( size_t) );
-		children = (size_t *) bzb_to_asciiz( catcher, *a_stack,
-			innards->td.interior.byte_val_nodes);
-		children[ cur_byte_idx ] = new_leaf;
-
-		assert( "TODO:  create another empty leaf for existing key/val" == NULL);
-		// TODO:  create another empty leaf for existing key/val
-		}  // current level is a leaf?
-	else
+/**
+ * Make room in an interior node for the given byte value,
+ *  and point it at the given child node.
+ */
+static
+void					bzt_set_child
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack * *			a_stack,		// a stack on/in which to
+										// allocate the frame(s)
+										// (which may be relocated!)
+	size_t				table,			// offset of (interior) node in trie
+	int					byte_val,		// byte value (0..255)
+	size_t				child			// offset of child node
+	)
+	{
+	t_table *			innards;
+	size_t				old_nodes;
+	size_t				old_sz;
+	size_t				new_nodes;
+	size_t				new_sz;
+
+	innards = (t_table *) bza_fast_frame_ptr( *a_stack, table);
+	old_nodes = innards->td.interior.byte_val_nodes;
+	old_sz = ( old_nodes != 0) ? bzb_fast_size( *a_stack, old_nodes) : 0;
+	if ( ( byte_val * bzt_child_size( *a_stack) ) >= old_sz)
 		{
-		assert( "TODO:  descend from interior node..." == NULL);
-		}  // current level is an interior node?
-
-
-	// TODO: dereference prev_val
-	// TODO: dereference any old value
+		// grow in steps of 16 entries, up to all 256
+		new_sz = ( ( byte_val | 0xf) + 1) * bzt_child_size( *a_stack);
+		new_nodes = bzb_from_fixed_mem( catcher, a_stack,
+				(char *) ZERO_BYTES, new_sz);
+		if ( old_nodes != 0)
+			{
+			memcpy( bzb_fast_data( *a_stack, new_nodes),
+					bzb_fast_data( *a_stack, old_nodes), old_sz);
+			bzb_deref( catcher, *a_stack, old_nodes);
+			}  // keep the existing children?
 
-	// TODO: trie/tree
+		innards = (t_table *) bza_fast_frame_ptr( *a_stack, table);
+		innards->td.interior.byte_val_nodes = new_nodes;
+		}  // need a bigger array?
 
-	next_table_level = 0;  // TODO: create / lookup
-	bzt_put( catcher, a_stack, next_table_level,
-			key + 1, key_len - 1, val, val_len);
+	bzt_put_child( *a_stack, innards->td.interior.byte_val_nodes, byte_val,
+			child);
 	}  // _________________________________________________________
 
 /**
- * Return any value (byte-array containing the value),
- *  matching the given key, from a leaf node in modified trie.
+ * Turn a leaf holding a different key into an interior node,
+ *  pushing the existing key/val down a level.
  */
 static
-size_t					bzt_get_leaf
+void					bzt_split_leaf
 	(
 	jmp_buf *			catcher,		// error handler (or null for immediate death)
-	t_stack *			a_stack,		// a stack on/in which to
+	t_stack * *			a_stack,		// a stack on/in which to
 										// allocate the frame(s)
-	t_table *			innards,		// current node in trie
-										//  IMMOVABLE for duration of call
-	const
-	char *				key,			// (remainder of) key data bytes  --
-										//  MUST BE "IMMOVABLE"
-										//  for the duration of this call
-										//  (should not be in given stack)
-										//  a copy will be saved at completion
-	size_t				key_len			// sizeof key (remainder)
+										// (which may be relocated!)
+	size_t				table			// offset of (leaf) node in trie
 	)
 	{
-	size_t				cur_key_len;
+	t_table *			innards;
+	size_t				key_off;
 	size_t				val_off;
-
-	if ( ! innards->td.leaf.key_off)
+	size_t				key_len;
+	int					byte_val;
+	size_t				rest;
+	size_t				child;
+	t_table *			child_innards;
+
+	innards = (t_table *) bza_fast_frame_ptr( *a_stack, table);
+	key_off = innards->td.leaf.key_off;
+	val_off = innards->td.leaf.val_off;
+	innards->is_leaf = 0;
+	innards->td.interior.byte_val_nodes = 0;
+	innards->td.interior.val_off = 0;
+
+	key_len = bzb_fast_size( *a_stack, key_off);
+	if ( key_len == 0)
 		{
-		return 0;  // === done ===
-		}  // nothing stored yet?
-
-	cur_key_len = bzb_size( catcher, a_stack, innards->td.leaf.key_off);
-	if ( key_len != cur_key_len)
+		innards->td.interior.val_off = val_off;
+		}  // key ends here?
+	else
 		{
-		return 0;  // === done ===
-		}  // different length key?
-
-	val_off = ( memcmp( key, 
-				bzb_to_asciiz( catcher, a_stack, innards->td.leaf.key_off),
-				cur_key_len) == 0) ?
-			innards->td.leaf.val_off : 0;
-	return val_off;
+		byte_val = (int) ( (unsigned char)
+				bzb_fast_data( *a_stack, key_off)[ 0 ]);
+		rest = bzb_subarray( catcher, a_stack, key_off, 1, key_len - 1);
+		child = bza_cons_stk_frame( catcher, a_stack, sizeof( t_table) );
+		child_innards = (t_table *) bza_fast_frame_ptr( *a_stack, child);
+		child_innards->is_leaf = 1;
+		child_innards->td.leaf.key_off = rest;
+		child_innards->td.leaf.val_off = val_off;
+		bzt_set_child( catcher, a_stack, table, byte_val, child);
+		}  // move down a level
+
+	bzb_deref( catcher, *a_stack, key_off);
 	}  // _________________________________________________________
 
 /**
- * Return the offset of the data for the next node in the (modified) trie,
- *  based on the current byte value of the key.
- */
-static
-size_t					bzt_get_interior
+ * Save a key-value pair in the table.
+ * */
+void					bzt_put
 	(
 	jmp_buf *			catcher,		// error handler (or null for immediate death)
-	t_stack *			a_stack,		// a stack on/in which to
+	t_stack * *			a_stack,		// a stack on/in which to
 										// allocate the frame(s)
-	t_table *			innards,		// current node in trie
-										//  IMMOVABLE for duration of call
-	char 				key_byte		// current byte from key
-										//  to be considered for a match
+										// (which may be relocated!)
+	size_t				table,			// offset of lookup table
+	const
+	char *				key,			// key data bytes  --
+										//  MUST BE "IMMOVABLE"
+										//  for the duration of this call
+										//  (should not be in given stack)
+										//  a copy will be saved at completion
+	size_t				key_len,		// sizeof key
+	const
+	char *				val,			// value data bytes  --
+										//  MUST BE "IMMOVABLE"
+										//  for the duration of this call
+										//  (should not be in given stack)
+										//  a copy will be saved at completion
+	size_t				val_len			// sizeof val
 	)
 	{
-	size_t				byte_val_nodes;
-	int					num_nodes;
-	int					node_idx;
-	size_t *			nodes;
+	t_table *			innards;
+	size_t				cur_key_len;
+	size_t				old_val;
+	size_t				new_val;
+	size_t				child;
+
+	for ( ; ; )
 
-	byte_val_nodes = innards->td.interior.byte_val_nodes;
-	num_nodes = ( bzb_size( catcher, a_stack, byte_val_nodes) /
-			sizeof( size_t) );
-	node_idx = ( (int) ( (unsigned char) key_byte) );
-	if ( node_idx >= num_nodes)
 		{
-		return 0;  // === fail ===
-		}  // no value defined for this byte (position)?
+		innards = (t_table *) bza_fast_frame_ptr( *a_stack, table);
+		if ( innards->is_leaf)
+			{
+			if ( innards->td.leaf.key_off == 0)
+				{
+				bzt_put_leaf( catcher, a_stack, table,
+						key, key_len, val, val_len);
+				return;  // === done ===
+				}  // empty leaf node?
+
+			cur_key_len = bzb_fast_size( *a_stack, innards->td.leaf.key_off);
+			if ( ( key_len == cur_key_len) &&
+				 ( memcmp( key, 
+						bzb_fast_data( *a_stack, innards->td.leaf.key_off),
+						cur_key_len) == 0) )
+				{
+				old_val = innards->td.leaf.val_off;
+				new_val = bzb_from_fixed_mem( catcher, a_stack, val, val_len);
+				innards = (t_table *) bza_fast_frame_ptr( *a_stack, table);
+				innards->td.leaf.val_off = new_val;
+				bzb_deref( catcher, *a_stack, old_val);
+				return;  // === done ===
+				}  // update value for existing key in leaf node?
+
+			bzt_split_leaf( catcher, a_stack, table);
+			continue;  // === now an interior node ===
+			}  // current level is a leaf?
+
+		if ( key_len == 0)
+			{
+			old_val = innards->td.interior.val_off;
+			new_val = bzb_from_fixed_mem( catcher, a_stack, val, val_len);
+			innards = (t_table *) bza_fast_frame_ptr( *a_stack, table);
+			innards->td.interior.val_off = new_val;
+			if ( old_val != 0)
+				{
+				bzb_deref( catcher, *a_stack, old_val);
+				}  // replaced a value?
+
+			return;  // === done ===
+			}  // key ends here?
+
+		child = bzt_get_interior( catcher, *a_stack, innards, key[ 0 ]);
+		if ( child == 0)
+			{
+			child = bzt_init( catcher, a_stack);
+			bzt_put_leaf( catcher, a_stack, child,
+					key + 1, key_len - 1, val, val_len);
+			bzt_set_child( catcher, a_stack, table,
+					(int) ( (unsigned char) key[ 0 ]), child);
+			return;  // === done ===
+			}  // nothing yet for this byte value?
+
+		table = child;
+		key++;
+		key_len--;
+		}  // descend each level
 
-	nodes = (size_t *) bzb_to_asciiz( catcher, a_stack, byte_val_nodes);
-	return nodes[ node_idx ];
 	}  // _________________________________________________________
 
 /**
@@ -342,28 +697,32 @@ size_t					bzt_get
 	)
 	{
 	t_table *			innards;
-	size_t				next_level;
 
-	innards = (t_table *) bza_get_frame_ptr( catcher, a_stack, table);
-	if ( innards->is_leaf)
-		{
-		return bzt_get_leaf( catcher, a_stack, innards, key, key_len);
-		// === done ===
-		}  // leaf node?
+	for ( ; ; )
 
-	// TODO: fixme - key may be consumed on prior levels!
-	if ( key_len == 0)
 		{
-		return 0;  // === fail ===
-		}  // no key data?
+		innards = (t_table *) bza_fast_frame_ptr( a_stack, table);
+		if ( innards->is_leaf)
+			{
+			return bzt_get_leaf( catcher, a_stack, innards, key, key_len);
+			// === done ===
+			}  // leaf node?
 
-	next_level = bzt_get_interior( catcher, a_stack, innards, key[ 0 ]);
-	if ( ! next_level)
-		{
-		return 0;  // === fail ===
-		}  // no partial match for current byte?
+		if ( key_len == 0)
+			{
+			return innards->td.interior.val_off;  // === done ===
+			}  // key ends here?
+
+		table = bzt_get_interior( catcher, a_stack, innards, key[ 0 ]);
+		if ( ! table)
+			{
+			return 0;  // === fail ===
+			}  // no partial match for current byte?
+
+		key++;
+		key_len--;
+		}  // descend each level
 
-	return 0;  // === fail ===
 	}  // _________________________________________________________
 
 
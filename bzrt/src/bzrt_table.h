@@ -41,6 +41,41 @@ void					bzt_deref
 	)
 	;
 
+/**
+ * Return the offset of a table after its stack was compacted,
+ *  translating the offsets of all of its nodes, keys and values.
+ *  Call once per table (root), after bza_compact.
+ */
+size_t					bzt_relocate
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			a_stack,		// a stack on/in which 
+										// the frame is allocated
+	size_t				table,			// offset of lookup table
+										//  before compaction
+	const
+	t_remap *			remap			// translation from bza_compact
+	)
+	;
+
+/**
+ * Copy a table, with all of its nodes, keys and values,
+ *  from one stack onto another (each frame is visited once),
+ *  return the offset of the copy.
+ *  The source stack is not changed (it may then be discarded).
+ */
+size_t					bzt_transfer
+	(
+	jmp_buf *			catcher,		// error handler (or null for immediate death)
+	t_stack *			src,			// stack on/in which the table
+										//  is allocated (not changed)
+	t_stack * *			a_dst,			// a (different) stack on/in which to
+										// allocate the copy
+										// (which may be relocated!)
+	size_t				table			// offset of lookup table in "src"
+	)
+	;
+
 /**
  * Save a key-value pair in the table.
  * */
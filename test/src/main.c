@@ -24,13 +24,20 @@
  */
 
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <pthread.h>
 
 #include "bzrt_alloc.h"
 #include "bzrt_bytes.h"
 #include "bzrt_table.h"
+#include "bzrt_pool.h"
 
 /**
  * Test (very basic) stack creation / destruction.
@@ -177,287 +184,420 @@ void					test_rt_stack_alloc( void)
 
 	bza_dest_stack( NULL, &stack);
 
-	// TODO: take timings, figure how to test acceptability
+	// (timings:  see bench/src/bench_api.c, "make bench")
 	}  // _________________________________________________________
 
 /**
- * Test basic (immutable) byte array functionality
+ * Test stack growth policies and space reservation.
  */
 static
-void					test_byte_array( void)
+void					test_stack_grow( void)
 	{
 	static const
-	char *				TEST_STR = "Testing, 123";
+	tf_grow_policy		POLICIES[] = {
+			bza_grow_double, bza_grow_half, bza_grow_chunk, NULL };
 	const
-	size_t				TS_LEN = strlen( TEST_STR);
+	int					NUM_FRAMES = 1000;
 
+	t_stack_opts		opts;
 	t_stack *			stack;
-	size_t				empty_top;
-	size_t				barr;
-	size_t				head;
-	size_t				tail;
-	size_t				srcs[ 4 ];
-	size_t				big;
+	size_t				frame;
+	size_t				grows;
+	size_t				huge;
+	int					pidx;
+	int					idx;
 	jmp_buf				catcher;
 	int					is_err;
 
-	puts( "\nTest immutable byte array use"); fflush( stdout);
-
-	stack = bza_cons_stack( NULL);
-	empty_top = stack->top;
-
-	// asciiz array init / access
-
-	barr = bzb_from_asciiz( NULL, &stack, TEST_STR);
-	assert( bzb_size( NULL, stack, barr) == TS_LEN);
-	assert( strcmp( bzb_to_asciiz( NULL, stack, barr), TEST_STR) == 0);
-	bzb_deref( NULL, stack, barr);
-	assert( stack->top == empty_top);
-
-	// test sub-array access
+	puts( "\nTest stack growth policies"); fflush( stdout);
 
-	barr = bzb_from_asciiz( NULL, &stack, TEST_STR);
+	// each policy should need far fewer reallocations than frames
 
-	head = bzb_subarray( NULL, &stack, barr, 0, 3);
-	assert( memcmp( bzb_to_asciiz( NULL, stack, head), TEST_STR, 3) == 0);
-	bzb_deref( NULL, stack, head);
+	for ( pidx = 0; POLICIES[ pidx ] != NULL; pidx++)
 
-	tail = bzb_subarray( NULL, &stack, barr, 9, -1);
-	assert( memcmp( bzb_to_asciiz( NULL, stack, tail), TEST_STR + 9, 3) == 0);
-	bzb_deref( NULL, stack, tail);
+		{
+		memset( &opts, 0, sizeof( opts) );
+		opts.grow = POLICIES[ pidx ];
+		stack = bza_cons_stack_opts( NULL, &opts);
+		for ( idx = 0; idx < NUM_FRAMES; idx++)
 
-	tail = bzb_subarray( NULL, &stack, barr, -1, 3);
-	assert( memcmp( bzb_to_asciiz( NULL, stack, tail), TEST_STR + 9, 3) == 0);
-	bzb_deref( NULL, stack, tail);
+			{
+			frame = bza_cons_stk_frame( NULL, &stack, 16);
+			memset( bza_get_frame_ptr( NULL, stack, frame), 'G', 16);
+			}  // allocate each frame
 
-	bzb_deref( NULL, stack, barr);
-	assert( stack->top == empty_top);
+		assert( stack->num_grows < ( NUM_FRAMES / 10) );
+		assert( stack->top <= stack->size);
+		bza_dest_stack( NULL, &stack);
+		}  // try each policy
 
-	// test array concatenation
+	// no policy may loop (or wrap around) on a size near the limit
 
-	barr = bzb_from_asciiz( NULL, &stack, TEST_STR);
-	srcs[ 0 ] = srcs[ 1 ] = srcs[ 2 ] = barr;
-	srcs[ 3 ] = 0;
-	big = bzb_concat( NULL, &stack, srcs);
-	bzb_deref( NULL, stack, barr);
-	assert( bzb_size( NULL, stack, big) == ( 3 * TS_LEN) );
-	assert( memcmp(
-			&( bzb_to_asciiz( NULL, stack, big)[ 0 ]),
-			TEST_STR, TS_LEN) == 0);
-	assert( memcmp(
-			&( bzb_to_asciiz( NULL, stack, big)[ TS_LEN ]),
-			TEST_STR, TS_LEN) == 0);
-	assert( memcmp(
-			&( bzb_to_asciiz( NULL, stack, big)[ 2 * TS_LEN ]),
-			TEST_STR, TS_LEN) == 0);
-	bzb_deref( NULL, stack, big);
-	assert( stack->top == empty_top);
+	huge = SIZE_MAX - 100;
+	for ( pidx = 0; POLICIES[ pidx ] != NULL; pidx++)
 
-	// TODO: test update attempt to immutable array
+		{
+		assert( ( POLICIES[ pidx ])( 1 << 20, huge, 0) >= huge);
+		}  // try each policy
 
-	// test bounds checking
+	// ... and the size with the housekeeping may not wrap either
 
-	barr = bzb_from_asciiz( NULL, &stack, TEST_STR);
+	stack = bza_cons_stack( NULL);
 	is_err = setjmp( catcher);
 	if ( ! is_err)
 		{
-		bzb_subarray( &catcher, &stack, barr, 0, 1000);
+		bza_reserve( &catcher, &stack, huge);
 		assert( "Error check failed, this should not be reached" == NULL);
-		}  // initial "try" to overallocate?
-	// else:  falling through from the error check + longjmp
-	is_err = setjmp( catcher);
-	if ( ! is_err)
+		}  // initial "try" to reserve too much?
+	assert( stack->size < huge);
+	bza_dest_stack( NULL, &stack);
+
+	// reserved space should not need any more reallocation
+
+	stack = bza_cons_stack( NULL);
+	bza_reserve( NULL, &stack, 64 * 1024);
+	assert( stack->size >= ( 64 * 1024) );
+	grows = stack->num_grows;
+	for ( idx = 0; idx < NUM_FRAMES; idx++)
+
 		{
-		bzb_subarray( &catcher, &stack, barr, 1000, 1);
-		assert( "Error check failed, this should not be reached" == NULL);
-		}  // initial "try" to overallocate?
-	// else:  falling through from the error check + longjmp
-	bzb_deref( NULL, stack, barr);
+		bza_cons_stk_frame( NULL, &stack, 16);
+		}  // allocate each frame
+
+	assert( stack->num_grows == grows);
+	bza_dest_stack( NULL, &stack);
+	}  // _________________________________________________________
+
+/**
+ * Test reuse of dead frames stranded under a live frame.
+ */
+static
+void					test_stack_holes( void)
+	{
+	t_stack *			stack;
+	size_t				empty_top;
+	size_t				frames[ 4 ];
+	size_t				top;
+	size_t				stranded;
+	size_t				reused;
+	size_t				big;
+
+	puts( "\nTest reuse of dead frames under live ones"); fflush( stdout);
+
+	stack = bza_cons_stack( NULL);
+	empty_top = stack->top;
+
+	frames[ 0 ] = bza_cons_stk_frame( NULL, &stack, 256);
+	frames[ 1 ] = bza_cons_stk_frame( NULL, &stack, 256);
+	frames[ 2 ] = bza_cons_stk_frame( NULL, &stack, 256);
+	frames[ 3 ] = bza_cons_stk_frame( NULL, &stack, 32);  // "long lived"
+	top = stack->top;
+	assert( bza_get_stranded_bytes( NULL, stack) == 0);
+
+	// out of order frees are stranded, adjacent ones merge
+
+	bza_deref_stk_frame( NULL, stack, frames[ 1 ]);
+	stranded = bza_get_stranded_bytes( NULL, stack);
+	assert( stranded >= 256);
+	assert( stack->num_holes == 1);
+	bza_deref_stk_frame( NULL, stack, frames[ 0 ]);
+	bza_deref_stk_frame( NULL, stack, frames[ 2 ]);
+	assert( stack->num_holes == 1);
+	assert( bza_get_stranded_bytes( NULL, stack) >= ( 3 * stranded) );
+	stranded = bza_get_stranded_bytes( NULL, stack);
+
+	// a small frame is carved out of the hole, not the top
+
+	reused = bza_cons_stk_frame( NULL, &stack, 64);
+	assert( reused < frames[ 3 ]);
+	assert( stack->top == top);
+	assert( bza_get_stranded_bytes( NULL, stack) < stranded);
+	memset( bza_get_frame_ptr( NULL, stack, reused), 'H', 64);
+
+	// too big for what is left:  goes on top
+
+	big = bza_cons_stk_frame( NULL, &stack, 1024);
+	assert( big > frames[ 3 ]);
+	bza_deref_stk_frame( NULL, stack, big);
+	assert( stack->top == top);
+
+	// releasing everything pops the holes as well
+
+	bza_deref_stk_frame( NULL, stack, reused);
+	assert( stack->num_holes == 1);
+	assert( bza_get_stranded_bytes( NULL, stack) == stranded);
+	bza_deref_stk_frame( NULL, stack, frames[ 3 ]);
 	assert( stack->top == empty_top);
+	assert( stack->num_holes == 0);
+	assert( bza_get_stranded_bytes( NULL, stack) == 0);
 
 	bza_dest_stack( NULL, &stack);
 	}  // _________________________________________________________
 
 /**
- * Helper routine to test byte array concatenation.
+ * Test merging of holes with their neighbours (either side),
+ *  including minimum size ones, with both kinds of frame marker.
  */
 static
-void					help_test_ba_concat
-	(
-	t_stack * *			stack,			// stack from which to allocate
-	size_t				in_dst			// the byte array to be appended to
-	)
+void					test_hole_merge( void)
 	{
+	static
 	const
-	char *				CAT_RESULT = "cha, cha, cha";
+	size_t				sizes[ 6 ] = { 8, 100, 8, 300, 8, 40 };
+	t_stack_opts		opts;
+	t_stack *			stack;
+	size_t				frames[ 6 ];
+	size_t				keep;
+	size_t				reused;
+	int					pass;
+	int					idx;
 
-	size_t				dst;
-	size_t				src;
-	size_t				src2;
-	int					cnt;
-	size_t				result;
+	puts( "\nTest merging of holes"); fflush( stdout);
 
-	dst = in_dst ?
-			in_dst :
-			bzb_init_size( NULL, stack, strlen( CAT_RESULT) );
-	src = bzb_from_asciiz( NULL, stack, "cha");
-	src2 = bzb_from_asciiz( NULL, stack, ", ");
-	for ( cnt = 1; ; cnt++)
+	for ( pass = 0; pass < 2; pass++)
 
 		{
-		result = bzb_concat_to( NULL, stack, dst, src);
-		bzb_deref( NULL, *stack, dst);  // code as if no-move not known
-		dst = result;
-		if ( cnt >= 3)
-			{
-			break;  // === stop ===
-			}  // done?
+		memset( &opts, 0, sizeof( opts) );
+		opts.flags = ( pass == 0) ? 0 : BZA_OPT_COMPACT_HDR;
+		stack = bza_cons_stack_opts( NULL, &opts);
+		for ( idx = 0; idx < 6; idx++)
 
-		result = bzb_concat_to( NULL, stack, dst, src2);
-		bzb_deref( NULL, *stack, dst);  // code as if no-move not known
-		dst = result;
-		}  // add each "cha" to output
+			{
+			frames[ idx ] = bza_cons_stk_frame( NULL, &stack, sizes[ idx ]);
+			}  // allocate each frame
+
+		keep = bza_cons_stk_frame( NULL, &stack, 16);
+
+		// small holes are kept apart, then joined by the frames between them
+
+		bza_deref_stk_frame( NULL, stack, frames[ 0 ]);
+		bza_deref_stk_frame( NULL, stack, frames[ 2 ]);
+		bza_deref_stk_frame( NULL, stack, frames[ 4 ]);
+		assert( stack->num_holes == 3);
+		bza_deref_stk_frame( NULL, stack, frames[ 1 ]);
+		assert( stack->num_holes == 2);
+		bza_deref_stk_frame( NULL, stack, frames[ 5 ]);
+		assert( stack->num_holes == 2);
+		bza_deref_stk_frame( NULL, stack, frames[ 3 ]);
+		assert( stack->num_holes == 1);
+
+		// a small frame comes back out of the (one) hole
+
+		reused = bza_cons_stk_frame( NULL, &stack, 8);
+		assert( reused < keep);
+		bza_deref_stk_frame( NULL, stack, reused);
+		assert( stack->num_holes == 1);
+
+		bza_deref_stk_frame( NULL, stack, keep);
+		assert( stack->top == 0);
+		assert( stack->num_holes == 0);
+		assert( bza_get_stranded_bytes( NULL, stack) == 0);
+		bza_dest_stack( NULL, &stack);
+		}  // each marker form
 
-	if ( ! in_dst)
-		{
-		assert( result == dst);  // *not* moved / expanded
-		}  // had to make exact-fit buffer?
-	// else:  we were given a small buffer
-	assert( memcmp( CAT_RESULT,
-			bzb_to_asciiz( NULL, *stack, dst),
-			bzb_size( NULL, *stack, dst) ) == 0);
-	bzb_deref( NULL, *stack, src);
-	bzb_deref( NULL, *stack, src2);
-	bzb_deref( NULL, *stack, dst);
 	}  // _________________________________________________________
 
 /**
- * Test byte array update functionality
+ * Test stack reset, and checkpoint / rollback.
  */
 static
-void					test_mutable_byte_array( void)
+void					test_stack_reset( void)
 	{
-/*
-	const
-	char *				HW = "Hello, world";
-	const
-	char *				NAME = "Wayne's ";
-	const
-	char *				SIMPLE_SPLICE = "Hello, Wayne's world";
-*/
-
 	t_stack *			stack;
-	size_t				empty_top;
-	size_t				dst;
+	t_stack_stats		stats;
+	size_t				frames[ 4 ];
+	size_t				size;
+	size_t				grows;
+	size_t				a_top;
+	size_t				mark;
+	size_t				inner;
+	int					idx;
+	jmp_buf				catcher;
+	int					is_err;
 
-	puts( "\nTest mutable byte array use"); fflush( stdout);
+	puts( "\nTest stack reset and checkpoints"); fflush( stdout);
 
 	stack = bza_cons_stack( NULL);
-	empty_top = stack->top;
-
-	// concatenate to existing largish buffer
 
-	help_test_ba_concat( &stack, 0);
-	assert( stack->top == empty_top);
+	// reset drops everything, keeps the space
 
-	// concatenate to existing too-small buffer
+	for ( idx = 0; idx < 4; idx++)
 
-	dst = bzb_init_size( NULL, &stack, 0);
-	help_test_ba_concat( &stack, dst);
-	assert( stack->top == empty_top);
+		{
+		frames[ idx ] = bza_cons_stk_frame( NULL, &stack, 1000);
+		}  // allocate each frame
 
-	// expand and relocate case:
+	bza_ref_stk_frame( NULL, stack, frames[ 1 ]);
+	bza_deref_stk_frame( NULL, stack, frames[ 2 ]);
+	size = stack->size;
+	grows = stack->num_grows;
+	bza_reset_stack( NULL, stack);
+	assert( stack->top == 0);
+	assert( bza_get_stranded_bytes( NULL, stack) == 0);
+	for ( idx = 0; idx < 4; idx++)
 
-/*
-	dst = bzb_from_asciiz( NULL, &stack, HW);
-	src = bzb_from_asciiz( NULL, &stack, NAME);
-	result = bzb_splice( NULL, &stack,
-			dst, 7, 0,
-			src, 0, -1);
-	bzb_deref( NULL, stack, dst);
-	dst = result;
-	assert( memcmp( SIMPLE_SPLICE,
-			bzb_to_asciiz( NULL, stack, dst),
-			bzb_size( NULL, stack, dst) ) == 0);
-	bzb_deref( NULL, stack, dst);
-	bzb_deref( NULL, stack, src);
-	assert( stack->top == empty_top);
-*/
+		{
+		frames[ idx ] = bza_cons_stk_frame( NULL, &stack, 1000);
+		}  // allocate each frame again
 
-	// reuse large buffer case:
+	assert( stack->size == size);
+	assert( stack->num_grows == grows);
+	bza_reset_stack( NULL, stack);
 
-/*
-	dst = bzb_init_size( NULL, &stack, strlen( SIMPLE_SPLICE) + 1);
+	// roll back to a checkpoint, in spite of references
 
-	src = bzb_from_asciiz( NULL, &stack, HW);
-	result = bzb_splice( NULL, &stack,
-			dst, 0, bzb_size( NULL, stack, src),
-			src, 0, -1);
-	assert( result == dst);  // *not* moved / expanded
-	bzb_deref( NULL, stack, dst);  // code as if no-move not known
-	dst = result;
-	assert( memcmp( HW,
-			bzb_to_asciiz( NULL, stack, dst),
-			bzb_size( NULL, stack, dst) ) == 0);
-	bzb_deref( NULL, stack, src);
+	frames[ 0 ] = bza_cons_stk_frame( NULL, &stack, 100);
+	mark = bza_mark( NULL, stack);
+	frames[ 1 ] = bza_cons_stk_frame( NULL, &stack, 100);
+	frames[ 2 ] = bza_cons_stk_frame( NULL, &stack, 100);
+	bza_ref_stk_frame( NULL, stack, frames[ 2 ]);
+	bza_deref_stk_frame( NULL, stack, frames[ 1 ]);
+	assert( stack->num_holes == 1);
+	bza_release_to( NULL, stack, mark);
+	assert( stack->top == mark);
+	assert( stack->num_holes == 0);
+	assert( bza_get_ref_count( NULL, stack, frames[ 0 ]) == 1);
+
+	// dead space below the checkpoint, merged with space above it
+
+	frames[ 1 ] = bza_cons_stk_frame( NULL, &stack, 100);
+	a_top = mark;
+	mark = bza_mark( NULL, stack);
+	frames[ 2 ] = bza_cons_stk_frame( NULL, &stack, 100);
+	frames[ 3 ] = bza_cons_stk_frame( NULL, &stack, 100);
+	bza_deref_stk_frame( NULL, stack, frames[ 1 ]);
+	bza_deref_stk_frame( NULL, stack, frames[ 2 ]);
+	assert( stack->num_holes == 1);
+	bza_release_to( NULL, stack, mark);
+	assert( stack->top == a_top);
+	assert( stack->num_holes == 0);
+	assert( bza_get_stranded_bytes( NULL, stack) == 0);
 
-	src = bzb_from_asciiz( NULL, &stack, NAME);
-	result = bzb_splice( NULL, &stack,
-			dst, 7, 0,
-			src, 0, -1);
-	assert( result == dst);  // still *not* moved / expanded
-	bzb_deref( NULL, stack, dst);  // code as if no-move not known
-	dst = result;
-	assert( memcmp( SIMPLE_SPLICE,
-			bzb_to_asciiz( NULL, stack, dst),
-			bzb_size( NULL, stack, dst) ) == 0);
-	bzb_deref( NULL, stack, src);
-	bzb_deref( NULL, stack, dst);
+	// a checkpoint above the top is an error
 
-	assert( stack->top == empty_top);
-*/
+	is_err = setjmp( catcher);
+	if ( ! is_err)
+		{
+		bza_release_to( &catcher, stack, mark);
+		assert( "Error check failed, this should not be reached" == NULL);
+		}  // initial "try" to release?
+	// else:  falling through from the error check + longjmp
 
-	// TODO:  test default "-1" in splice args
+	// ... as is one the top dropped below since, though it is back
+	//  above it now (the checkpoint is inside a frame)
+	frames[ 1 ] = bza_cons_stk_frame( NULL, &stack, 16);
+	mark = bza_mark( NULL, stack);
+	bza_deref_stk_frame( NULL, stack, frames[ 1 ]);
+	frames[ 2 ] = bza_cons_stk_frame( NULL, &stack, 256);
+	is_err = setjmp( catcher);
+	if ( ! is_err)
+		{
+		bza_release_to( &catcher, stack, mark);
+		assert( "Error check failed, this should not be reached" == NULL);
+		}  // initial "try" to release to a stale checkpoint?
+	bza_get_stats( NULL, stack, &stats);
+	assert( stats.live_frames == 2);
+
+	// nested checkpoints stay good until the top drops below them
+	mark = bza_mark( NULL, stack);
+	frames[ 3 ] = bza_cons_stk_frame( NULL, &stack, 100);
+	inner = bza_mark( NULL, stack);
+	bza_cons_stk_frame( NULL, &stack, 100);
+	bza_release_to( NULL, stack, inner);
+	assert( stack->top == inner);
+	bza_release_to( NULL, stack, mark);
+	assert( stack->top == mark);
+	bza_deref_stk_frame( NULL, stack, frames[ 2 ]);
 
+	bza_deref_stk_frame( NULL, stack, frames[ 0 ]);
+	assert( stack->top == 0);
 	bza_dest_stack( NULL, &stack);
 	}  // _________________________________________________________
 
 /**
- * Test key-table store/lookup code.
+ * Test compaction of a stack, and translation of offsets.
  */
 static
-void					test_table_access( void)
+void					test_stack_compact( void)
 	{
 	const
 	char *				SOME_KEY = "random bytes";
 	const
 	char *				SOME_VAL = "arbitrary result";
-	const
-	char *				ANOTHER_KEY = "more random bytes";
-	const
-	char *				ANOTHER_VAL = "another arbitrary result";
 
 	t_stack *			stack;
-	size_t				empty_top;
+	size_t				frames[ 5 ];
+	size_t				top;
+	t_remap *			remap;
+	size_t				moved;
+	size_t				junk;
 	size_t				table;
+	size_t				barr;
 	size_t				search_res_ba;
+	int					idx;
 
-	puts( "\nTest lookup table use"); fflush( stdout);
+	puts( "\nTest stack compaction"); fflush( stdout);
 
 	stack = bza_cons_stack( NULL);
-	empty_top = stack->top;
-	table = bzt_init( NULL, &stack);
 
-	// make sure that we don't find anything when nothing is there:
+	for ( idx = 0; idx < 5; idx++)
 
-	search_res_ba = bzt_get( NULL, stack, table,
-			SOME_KEY, strlen( SOME_KEY) );
-	assert( search_res_ba == 0);
+		{
+		frames[ idx ] = bza_cons_stk_frame( NULL, &stack, 100 + idx);
+		memset( bza_get_frame_ptr( NULL, stack, frames[ idx ]),
+				'A' + idx, 100 + idx);
+		}  // allocate and init each frame
 
-	// save something and get it back
+	bza_ref_stk_frame( NULL, stack, frames[ 2 ]);
+	bza_deref_stk_frame( NULL, stack, frames[ 1 ]);
+	bza_deref_stk_frame( NULL, stack, frames[ 3 ]);
+	top = stack->top;
+	assert( bza_get_stranded_bytes( NULL, stack) > 0);
+
+	remap = bza_compact( NULL, stack);
+	assert( remap->num == 3);
+	assert( stack->top < top);
+	assert( bza_get_stranded_bytes( NULL, stack) == 0);
+	assert( bza_remap_off( remap, frames[ 0 ]) == frames[ 0 ]);
+	assert( bza_remap_off( remap, frames[ 1 ]) == 0);
+	assert( bza_remap_off( remap, frames[ 3 ]) == 0);
+	for ( idx = 0; idx < 5; idx += 2)
 
-	bzt_put( NULL, &stack, table,
+		{
+		moved = bza_remap_off( remap, frames[ idx ]);
+		assert( moved <= frames[ idx ]);
+		assert( ( (char *) bza_get_frame_ptr( NULL, stack, moved))[ 0 ] ==
+				( 'A' + idx) );
+		assert( ( (char *) bza_get_frame_ptr( NULL, stack, moved))[ 99 + idx ] ==
+				( 'A' + idx) );
+		frames[ idx ] = moved;
+		}  // check each survivor
+
+	assert( bza_get_ref_count( NULL, stack, frames[ 2 ]) == 2);
+	bza_dest_remap( NULL, &remap);
+	assert( remap == NULL);
+
+	bza_deref_stk_frame( NULL, stack, frames[ 2 ]);
+	bza_deref_stk_frame( NULL, stack, frames[ 2 ]);
+	bza_deref_stk_frame( NULL, stack, frames[ 0 ]);
+	bza_deref_stk_frame( NULL, stack, frames[ 4 ]);
+	assert( stack->top == 0);
+
+	// tables and byte arrays translate their own insides
+
+	junk = bza_cons_stk_frame( NULL, &stack, 1000);
+	barr = bzb_from_asciiz( NULL, &stack, SOME_KEY);
+	table = bzt_init( NULL, &stack);
+	bzt_put( NULL, &stack, table,
 			SOME_KEY, strlen( SOME_KEY), SOME_VAL, strlen( SOME_VAL) );
+	bza_deref_stk_frame( NULL, stack, junk);
+
+	remap = bza_compact( NULL, stack);
+	barr = bzb_relocate( NULL, stack, barr, remap);
+	table = bzt_relocate( NULL, stack, table, remap);
+	bza_dest_remap( NULL, &remap);
+
+	assert( strcmp( bzb_to_asciiz( NULL, stack, barr), SOME_KEY) == 0);
 	search_res_ba = bzt_get( NULL, stack, table,
 			SOME_KEY, strlen( SOME_KEY) );
 	assert( search_res_ba != 0);
@@ -465,36 +605,2277 @@ void					test_table_access( void)
 			bzb_to_asciiz( NULL, stack, search_res_ba),
 			bzb_size( NULL, stack, search_res_ba) ) == 0);
 
-	// check for miss
+	bza_dest_stack( NULL, &stack);
+	}  // _________________________________________________________
 
-	search_res_ba = bzt_get( NULL, stack, table,
-			ANOTHER_KEY, strlen( ANOTHER_KEY) );
-	assert( search_res_ba == 0);
+/**
+ * Test "vm" stacks:  growth never moves the stack or its frames.
+ */
+static
+void					test_vm_stack( void)
+	{
+	const
+	size_t				M64 = ( 1 << 26);
+	const
+	int					NUM_FRAMES = 10000;
 
-	// save multiple items, check for hit/miss
+	t_stack *			stack;
+	t_stack *			orig_stack;
+	size_t				first;
+	char *				first_ptr;
+	size_t				frame;
+	int					idx;
+	jmp_buf				catcher;
+	int					is_err;
 
-	bzt_put( NULL, &stack, table,
-			ANOTHER_KEY, strlen( ANOTHER_KEY), ANOTHER_VAL, strlen( ANOTHER_VAL) );
-	search_res_ba = bzt_get( NULL, stack, table,
-			ANOTHER_KEY, strlen( ANOTHER_KEY) );
-	assert( search_res_ba != 0);
-	assert( memcmp( ANOTHER_VAL,
-			bzb_to_asciiz( NULL, stack, search_res_ba),
-			bzb_size( NULL, stack, search_res_ba) ) == 0);
-	search_res_ba = bzt_get( NULL, stack, table,
-			SOME_KEY, strlen( SOME_KEY) );
-	assert( search_res_ba != 0);
-	assert( memcmp( SOME_VAL,
-			bzb_to_asciiz( NULL, stack, search_res_ba),
-			bzb_size( NULL, stack, search_res_ba) ) == 0);
+	puts( "\nTest reserved address space (vm) stacks"); fflush( stdout);
 
-	// cleanup
+	stack = bza_cons_stack_vm( NULL, M64);
+	orig_stack = stack;
 
-	bzt_deref( NULL, stack, table);
+	first = bza_cons_stk_frame( NULL, &stack, 64);
+	first_ptr = bza_get_frame_ptr( NULL, stack, first);
+	memset( first_ptr, 'V', 64);
+
+	// grow well past the initial commit
+
+	for ( idx = 0; idx < NUM_FRAMES; idx++)
+
+		{
+		frame = bza_cons_stk_frame( NULL, &stack, 1000);
+		memset( bza_get_frame_ptr( NULL, stack, frame), 'W', 1000);
+		}  // allocate each frame
+
+	assert( stack == orig_stack);
+	assert( bza_get_frame_ptr( NULL, stack, first) == first_ptr);
+	assert( ( first_ptr[ 0 ] == 'V') && ( first_ptr[ 63 ] == 'V') );
+
+	// overallocate past the reservation, test error handling
+
+	is_err = setjmp( catcher);
+	if ( ! is_err)
+		{
+		bza_cons_stk_frame( &catcher, &stack, M64);
+		assert( "Error check failed, this should not be reached" == NULL);
+		}  // initial "try" to overallocate?
+	// else:  falling through from the error check + longjmp
+	assert( stack == orig_stack);
+	assert( first_ptr[ 0 ] == 'V');
+
+	bza_dest_stack( NULL, &stack);
+	assert( stack == NULL);
+	}  // _________________________________________________________
+
+/**
+ * Test segmented stacks:  growth adds segments, frames never move.
+ */
+static
+void					test_seg_stack( void)
+	{
+	const
+	int					NUM_FRAMES = 300;
+	const
+	char *				TEST_STR = "Testing, 123";
+
+	t_stack *			stack;
+	t_stack *			orig_stack;
+	size_t				frames[ NUM_FRAMES ];
+	char *				ptrs[ NUM_FRAMES ];
+	size_t				sizes[ NUM_FRAMES ];
+	size_t				srcs[ 4 ];
+	size_t				barr;
+	size_t				big;
+	t_remap *			remap;
+	int					idx;
+	jmp_buf				catcher;
+	int					is_err;
+
+	puts( "\nTest segmented stacks"); fflush( stdout);
+
+	stack = bza_cons_stack_seg( NULL, 12);  // 4 KB segments
+	orig_stack = stack;
+
+	for ( idx = 0; idx < NUM_FRAMES; idx++)
+
+		{
+		sizes[ idx ] = 8 + ( ( idx * 997) % 3000);
+		frames[ idx ] = bza_cons_stk_frame( NULL, &stack, sizes[ idx ]);
+		ptrs[ idx ] = bza_get_frame_ptr( NULL, stack, frames[ idx ]);
+		memset( ptrs[ idx ], idx & 0x7f, sizes[ idx ]);
+		}  // allocate and init each frame
+
+	assert( stack == orig_stack);
+	assert( stack->num_segs > 1);
+	for ( idx = 0; idx < NUM_FRAMES; idx++)
+
+		{
+		assert( bza_get_frame_ptr( NULL, stack, frames[ idx ]) == ptrs[ idx ]);
+		assert( ptrs[ idx ][ 0 ] == ( idx & 0x7f) );
+		assert( ptrs[ idx ][ sizes[ idx ] - 1 ] == ( idx & 0x7f) );
+		}  // nothing moved or overlapped?
+
+	// byte arrays work unchanged
+
+	barr = bzb_from_asciiz( NULL, &stack, TEST_STR);
+	srcs[ 0 ] = srcs[ 1 ] = srcs[ 2 ] = barr;
+	srcs[ 3 ] = 0;
+	big = bzb_concat( NULL, &stack, srcs);
+	assert( bzb_size( NULL, stack, big) == ( 3 * strlen( TEST_STR) ) );
+	assert( memcmp(
+			&( bzb_to_asciiz( NULL, stack, big)[ 2 * strlen( TEST_STR) ]),
+			TEST_STR, strlen( TEST_STR) ) == 0);
+	bzb_deref( NULL, stack, big);
+	bzb_deref( NULL, stack, barr);
+
+	// a frame can't be bigger than a segment
+
+	is_err = setjmp( catcher);
+	if ( ! is_err)
+		{
+		bza_cons_stk_frame( &catcher, &stack, 4096);
+		assert( "Error check failed, this should not be reached" == NULL);
+		}  // initial "try" to overallocate?
+	// else:  falling through from the error check + longjmp
+
+	// compaction keeps frames within segments
+
+	for ( idx = 0; idx < NUM_FRAMES; idx += 2)
+
+		{
+		bza_deref_stk_frame( NULL, stack, frames[ idx ]);
+		}  // free every other frame
+
+	remap = bza_compact( NULL, stack);
+	for ( idx = 1; idx < NUM_FRAMES; idx += 2)
+
+		{
+		frames[ idx ] = bza_remap_off( remap, frames[ idx ]);
+		ptrs[ idx ] = bza_get_frame_ptr( NULL, stack, frames[ idx ]);
+		assert( ptrs[ idx ][ 0 ] == ( idx & 0x7f) );
+		assert( ptrs[ idx ][ sizes[ idx ] - 1 ] == ( idx & 0x7f) );
+		}  // check each survivor
+
+	bza_dest_remap( NULL, &remap);
+	for ( idx = 1; idx < NUM_FRAMES; idx += 2)
+
+		{
+		bza_deref_stk_frame( NULL, stack, frames[ idx ]);
+		}  // free each survivor
+
+	assert( stack->top == 0);
+	assert( bza_get_stranded_bytes( NULL, stack) == 0);
+	bza_dest_stack( NULL, &stack);
+	}  // _________________________________________________________
+
+/**
+ * Test basic (immutable) byte array functionality
+ */
+static
+void					test_byte_array( void)
+	{
+	static const
+	char *				TEST_STR = "Testing, 123";
+	const
+	size_t				TS_LEN = strlen( TEST_STR);
+
+	t_stack *			stack;
+	size_t				empty_top;
+	size_t				barr;
+	size_t				head;
+	size_t				tail;
+	size_t				srcs[ 4 ];
+	size_t				big;
+	jmp_buf				catcher;
+	int					is_err;
+
+	puts( "\nTest immutable byte array use"); fflush( stdout);
+
+	stack = bza_cons_stack( NULL);
+	empty_top = stack->top;
+
+	// asciiz array init / access
+
+	barr = bzb_from_asciiz( NULL, &stack, TEST_STR);
+	assert( bzb_size( NULL, stack, barr) == TS_LEN);
+	assert( strcmp( bzb_to_asciiz( NULL, stack, barr), TEST_STR) == 0);
+	bzb_deref( NULL, stack, barr);
+	assert( stack->top == empty_top);
+
+	// test sub-array access
+
+	barr = bzb_from_asciiz( NULL, &stack, TEST_STR);
+
+	head = bzb_subarray( NULL, &stack, barr, 0, 3);
+	assert( memcmp( bzb_to_asciiz( NULL, stack, head), TEST_STR, 3) == 0);
+	bzb_deref( NULL, stack, head);
+
+	tail = bzb_subarray( NULL, &stack, barr, 9, -1);
+	assert( memcmp( bzb_to_asciiz( NULL, stack, tail), TEST_STR + 9, 3) == 0);
+	bzb_deref( NULL, stack, tail);
+
+	tail = bzb_subarray( NULL, &stack, barr, -1, 3);
+	assert( memcmp( bzb_to_asciiz( NULL, stack, tail), TEST_STR + 9, 3) == 0);
+	bzb_deref( NULL, stack, tail);
+
+	bzb_deref( NULL, stack, barr);
+	assert( stack->top == empty_top);
+
+	// test array concatenation
+
+	barr = bzb_from_asciiz( NULL, &stack, TEST_STR);
+	srcs[ 0 ] = srcs[ 1 ] = srcs[ 2 ] = barr;
+	srcs[ 3 ] = 0;
+	big = bzb_concat( NULL, &stack, srcs);
+	bzb_deref( NULL, stack, barr);
+	assert( bzb_size( NULL, stack, big) == ( 3 * TS_LEN) );
+	assert( memcmp(
+			&( bzb_to_asciiz( NULL, stack, big)[ 0 ]),
+			TEST_STR, TS_LEN) == 0);
+	assert( memcmp(
+			&( bzb_to_asciiz( NULL, stack, big)[ TS_LEN ]),
+			TEST_STR, TS_LEN) == 0);
+	assert( memcmp(
+			&( bzb_to_asciiz( NULL, stack, big)[ 2 * TS_LEN ]),
+			TEST_STR, TS_LEN) == 0);
+	bzb_deref( NULL, stack, big);
+	assert( stack->top == empty_top);
+
+	// TODO: test update attempt to immutable array
+
+	// test bounds checking
+
+	barr = bzb_from_asciiz( NULL, &stack, TEST_STR);
+	is_err = setjmp( catcher);
+	if ( ! is_err)
+		{
+		bzb_subarray( &catcher, &stack, barr, 0, 1000);
+		assert( "Error check failed, this should not be reached" == NULL);
+		}  // initial "try" to overallocate?
+	// else:  falling through from the error check + longjmp
+	is_err = setjmp( catcher);
+	if ( ! is_err)
+		{
+		bzb_subarray( &catcher, &stack, barr, 1000, 1);
+		assert( "Error check failed, this should not be reached" == NULL);
+		}  // initial "try" to overallocate?
+	// else:  falling through from the error check + longjmp
+	bzb_deref( NULL, stack, barr);
 	assert( stack->top == empty_top);
+
 	bza_dest_stack( NULL, &stack);
 	}  // _________________________________________________________
 
+/**
+ * Helper routine to test byte array concatenation.
+ */
+static
+void					help_test_ba_concat
+	(
+	t_stack * *			stack,			// stack from which to allocate
+	size_t				in_dst			// the byte array to be appended to
+	)
+	{
+	const
+	char *				CAT_RESULT = "cha, cha, cha";
+
+	size_t				dst;
+	size_t				src;
+	size_t				src2;
+	int					cnt;
+	size_t				result;
+
+	dst = in_dst ?
+			in_dst :
+			bzb_init_size( NULL, stack, strlen( CAT_RESULT) );
+	src = bzb_from_asciiz( NULL, stack, "cha");
+	src2 = bzb_from_asciiz( NULL, stack, ", ");
+	for ( cnt = 1; ; cnt++)
+
+		{
+		result = bzb_concat_to( NULL, stack, dst, src);
+		bzb_deref( NULL, *stack, dst);  // code as if no-move not known
+		dst = result;
+		if ( cnt >= 3)
+			{
+			break;  // === stop ===
+			}  // done?
+
+		result = bzb_concat_to( NULL, stack, dst, src2);
+		bzb_deref( NULL, *stack, dst);  // code as if no-move not known
+		dst = result;
+		}  // add each "cha" to output
+
+	if ( ! in_dst)
+		{
+		assert( result == dst);  // *not* moved / expanded
+		}  // had to make exact-fit buffer?
+	// else:  we were given a small buffer
+	assert( memcmp( CAT_RESULT,
+			bzb_to_asciiz( NULL, *stack, dst),
+			bzb_size( NULL, *stack, dst) ) == 0);
+	bzb_deref( NULL, *stack, src);
+	bzb_deref( NULL, *stack, src2);
+	bzb_deref( NULL, *stack, dst);
+	}  // _________________________________________________________
+
+/**
+ * Test byte array update functionality
+ */
+static
+void					test_mutable_byte_array( void)
+	{
+/*
+	const
+	char *				HW = "Hello, world";
+	const
+	char *				NAME = "Wayne's ";
+	const
+	char *				SIMPLE_SPLICE = "Hello, Wayne's world";
+*/
+
+	t_stack *			stack;
+	size_t				empty_top;
+	size_t				dst;
+
+	puts( "\nTest mutable byte array use"); fflush( stdout);
+
+	stack = bza_cons_stack( NULL);
+	empty_top = stack->top;
+
+	// concatenate to existing largish buffer
+
+	help_test_ba_concat( &stack, 0);
+	assert( stack->top == empty_top);
+
+	// concatenate to existing too-small buffer
+
+	dst = bzb_init_size( NULL, &stack, 0);
+	help_test_ba_concat( &stack, dst);
+	assert( stack->top == empty_top);
+
+	// expand and relocate case:
+
+/*
+	dst = bzb_from_asciiz( NULL, &stack, HW);
+	src = bzb_from_asciiz( NULL, &stack, NAME);
+	result = bzb_splice( NULL, &stack,
+			dst, 7, 0,
+			src, 0, -1);
+	bzb_deref( NULL, stack, dst);
+	dst = result;
+	assert( memcmp( SIMPLE_SPLICE,
+			bzb_to_asciiz( NULL, stack, dst),
+			bzb_size( NULL, stack, dst) ) == 0);
+	bzb_deref( NULL, stack, dst);
+	bzb_deref( NULL, stack, src);
+	assert( stack->top == empty_top);
+*/
+
+	// reuse large buffer case:
+
+/*
+	dst = bzb_init_size( NULL, &stack, strlen( SIMPLE_SPLICE) + 1);
+
+	src = bzb_from_asciiz( NULL, &stack, HW);
+	result = bzb_splice( NULL, &stack,
+			dst, 0, bzb_size( NULL, stack, src),
+			src, 0, -1);
+	assert( result == dst);  // *not* moved / expanded
+	bzb_deref( NULL, stack, dst);  // code as if no-move not known
+	dst = result;
+	assert( memcmp( HW,
+			bzb_to_asciiz( NULL, stack, dst),
+			bzb_size( NULL, stack, dst) ) == 0);
+	bzb_deref( NULL, stack, src);
+
+	src = bzb_from_asciiz( NULL, &stack, NAME);
+	result = bzb_splice( NULL, &stack,
+			dst, 7, 0,
+			src, 0, -1);
+	assert( result == dst);  // still *not* moved / expanded
+	bzb_deref( NULL, stack, dst);  // code as if no-move not known
+	dst = result;
+	assert( memcmp( SIMPLE_SPLICE,
+			bzb_to_asciiz( NULL, stack, dst),
+			bzb_size( NULL, stack, dst) ) == 0);
+	bzb_deref( NULL, stack, src);
+	bzb_deref( NULL, stack, dst);
+
+	assert( stack->top == empty_top);
+*/
+
+	// TODO:  test default "-1" in splice args
+
+	bza_dest_stack( NULL, &stack);
+	}  // _________________________________________________________
+
+/**
+ * Test key-table store/lookup code.
+ */
+static
+void					test_table_access( void)
+	{
+	const
+	char *				SOME_KEY = "random bytes";
+	const
+	char *				SOME_VAL = "arbitrary result";
+	const
+	char *				ANOTHER_KEY = "more random bytes";
+	const
+	char *				ANOTHER_VAL = "another arbitrary result";
+
+	t_stack *			stack;
+	size_t				empty_top;
+	size_t				table;
+	size_t				search_res_ba;
+
+	puts( "\nTest lookup table use"); fflush( stdout);
+
+	stack = bza_cons_stack( NULL);
+	empty_top = stack->top;
+	table = bzt_init( NULL, &stack);
+
+	// make sure that we don't find anything when nothing is there:
+
+	search_res_ba = bzt_get( NULL, stack, table,
+			SOME_KEY, strlen( SOME_KEY) );
+	assert( search_res_ba == 0);
+
+	// save something and get it back
+
+	bzt_put( NULL, &stack, table,
+			SOME_KEY, strlen( SOME_KEY), SOME_VAL, strlen( SOME_VAL) );
+	search_res_ba = bzt_get( NULL, stack, table,
+			SOME_KEY, strlen( SOME_KEY) );
+	assert( search_res_ba != 0);
+	assert( memcmp( SOME_VAL,
+			bzb_to_asciiz( NULL, stack, search_res_ba),
+			bzb_size( NULL, stack, search_res_ba) ) == 0);
+
+	// check for miss
+
+	search_res_ba = bzt_get( NULL, stack, table,
+			ANOTHER_KEY, strlen( ANOTHER_KEY) );
+	assert( search_res_ba == 0);
+
+	// save multiple items, check for hit/miss
+
+	bzt_put( NULL, &stack, table,
+			ANOTHER_KEY, strlen( ANOTHER_KEY), ANOTHER_VAL, strlen( ANOTHER_VAL) );
+	search_res_ba = bzt_get( NULL, stack, table,
+			ANOTHER_KEY, strlen( ANOTHER_KEY) );
+	assert( search_res_ba != 0);
+	assert( memcmp( ANOTHER_VAL,
+			bzb_to_asciiz( NULL, stack, search_res_ba),
+			bzb_size( NULL, stack, search_res_ba) ) == 0);
+	search_res_ba = bzt_get( NULL, stack, table,
+			SOME_KEY, strlen( SOME_KEY) );
+	assert( search_res_ba != 0);
+	assert( memcmp( SOME_VAL,
+			bzb_to_asciiz( NULL, stack, search_res_ba),
+			bzb_size( NULL, stack, search_res_ba) ) == 0);
+
+	// cleanup
+
+	bzt_deref( NULL, stack, table);
+	assert( stack->top == empty_top);
+	bza_dest_stack( NULL, &stack);
+	}  // _________________________________________________________
+
+/**
+ * Test frame alignment:  16 bytes always, more on request.
+ */
+static
+void					test_aligned_frames( void)
+	{
+	const
+	int					NUM_FRAMES = 200;
+
+	t_stack *			stack;
+	t_stack *			seg_stack;
+	size_t				frames[ NUM_FRAMES ];
+	char *				ptr;
+	size_t				align;
+	int					idx;
+
+	puts( "\nTest aligned frames"); fflush( stdout);
+
+	stack = bza_cons_stack( NULL);
+	seg_stack = bza_cons_stack_seg( NULL, 12);
+	for ( idx = 0; idx < NUM_FRAMES; idx++)
+
+		{
+		frames[ idx ] = bza_cons_stk_frame( NULL, &stack, idx % 37);
+		ptr = bza_get_frame_ptr( NULL, seg_stack,
+				bza_cons_stk_frame( NULL, &seg_stack, ( idx * 13) % 700) );
+		assert( ( ( (size_t) ptr) & 15) == 0);
+		}  // allocate odd sizes
+
+	for ( idx = 0; idx < NUM_FRAMES; idx += 3)
+
+		{
+		bza_deref_stk_frame( NULL, stack, frames[ idx ]);
+		}  // punch holes
+
+	for ( idx = 0; idx < NUM_FRAMES; idx += 3)
+
+		{
+		frames[ idx ] = bza_cons_stk_frame( NULL, &stack, idx % 11);
+		}  // refill (some) holes
+
+	for ( idx = 0; idx < NUM_FRAMES; idx++)
+
+		{
+		ptr = bza_get_frame_ptr( NULL, stack, frames[ idx ]);
+		assert( ( ( (size_t) ptr) & 15) == 0);
+		}  // everything still aligned?
+
+	bza_dest_stack( NULL, &seg_stack);
+	bza_dest_stack( NULL, &stack);
+
+	// bigger alignments, on stacks that don't move
+
+	stack = bza_cons_stack_vm( NULL, 16 * 1024 * 1024);
+	seg_stack = bza_cons_stack_seg( NULL, 16);
+	for ( align = 32; align <= 4096; align *= 2)
+
+		{
+		for ( idx = 0; idx < 5; idx++)
+
+			{
+			bza_cons_stk_frame( NULL, &stack, idx * 7);
+			ptr = bza_get_frame_ptr( NULL, stack,
+					bza_cons_stk_frame_aligned( NULL, &stack, 100, align) );
+			assert( ( ( (size_t) ptr) & ( align - 1) ) == 0);
+			memset( ptr, 'A', 100);
+
+			bza_cons_stk_frame( NULL, &seg_stack, idx * 7);
+			ptr = bza_get_frame_ptr( NULL, seg_stack,
+					bza_cons_stk_frame_aligned( NULL, &seg_stack, 100, align) );
+			assert( ( ( (size_t) ptr) & ( align - 1) ) == 0);
+			memset( ptr, 'A', 100);
+			}  // mix with unaligned
+
+		}  // each alignment
+
+	bza_dest_stack( NULL, &seg_stack);
+	bza_dest_stack( NULL, &stack);
+	}  // _________________________________________________________
+
+/**
+ * Test stacks with the compact (8 byte) frame marker,
+ *  both contiguous and segmented:  holes, checkpoints, compaction.
+ */
+static
+void					test_compact_hdr( void)
+	{
+	const
+	int					NUM_FRAMES = 400;
+
+	t_stack_opts		opts;
+	t_stack *			stack;
+	size_t				frames[ NUM_FRAMES ];
+	size_t				sizes[ NUM_FRAMES ];
+	size_t				mark;
+	size_t				top;
+	char *				ptr;
+	t_remap *			remap;
+	int					pass;
+	int					idx;
+
+	puts( "\nTest compact frame headers"); fflush( stdout);
+
+	for ( pass = 0; pass < 2; pass++)
+
+		{
+		memset( &opts, 0, sizeof( opts) );
+		opts.flags = BZA_OPT_COMPACT_HDR;
+		opts.seg_shift = ( pass == 0) ? 0 : 12;
+		stack = bza_cons_stack_opts( NULL, &opts);
+
+		for ( idx = 0; idx < NUM_FRAMES; idx++)
+
+			{
+			sizes[ idx ] = 1 + ( ( idx * 37) % 200);
+			frames[ idx ] = bza_cons_stk_frame( NULL, &stack, sizes[ idx ]);
+			ptr = bza_get_frame_ptr( NULL, stack, frames[ idx ]);
+			assert( ( ( (size_t) ptr) & 15) == 0);
+			memset( ptr, idx & 0x7f, sizes[ idx ]);
+			}  // allocate and init each frame
+
+		// 8 byte frames take 16 bytes, overhead and all
+		top = stack->top;
+		bza_deref_stk_frame( NULL, stack,
+				bza_cons_stk_frame( NULL, &stack, 8) );
+		assert( stack->top == top);
+		if ( pass == 0)
+			{
+			mark = bza_mark( NULL, stack);
+			bza_cons_stk_frame( NULL, &stack, 8);
+			assert( stack->top == ( mark + 16) );
+			bza_release_to( NULL, stack, mark);
+			}  // no segment ends to skip?
+
+		for ( idx = 0; idx < NUM_FRAMES; idx += 3)
+
+			{
+			bza_deref_stk_frame( NULL, stack, frames[ idx ]);
+			frames[ idx ] = 0;
+			}  // punch holes
+
+		assert( stack->num_holes > 0);
+		for ( idx = 0; idx < NUM_FRAMES; idx += 6)
+
+			{
+			sizes[ idx ] = 1 + ( idx % 40);
+			frames[ idx ] = bza_cons_stk_frame( NULL, &stack, sizes[ idx ]);
+			ptr = bza_get_frame_ptr( NULL, stack, frames[ idx ]);
+			memset( ptr, idx & 0x7f, sizes[ idx ]);
+			}  // refill some holes
+
+		remap = bza_compact( NULL, stack);
+		assert( ( pass == 1) || ( stack->num_holes == 0) );  // (fillers stay)
+		for ( idx = 0; idx < NUM_FRAMES; idx++)
+
+			{
+			if ( frames[ idx ] == 0)
+				{
+				continue;  // === skip ===
+				}  // freed?
+
+			frames[ idx ] = bza_remap_off( remap, frames[ idx ]);
+			assert( frames[ idx ] != 0);
+			ptr = bza_get_frame_ptr( NULL, stack, frames[ idx ]);
+			assert( ptr[ 0 ] == ( idx & 0x7f) );
+			assert( ptr[ sizes[ idx ] - 1 ] == ( idx & 0x7f) );
+			}  // check each survivor
+
+		bza_dest_remap( NULL, &remap);
+		for ( idx = NUM_FRAMES - 1; idx >= 0; idx--)
+
+			{
+			if ( frames[ idx ] != 0)
+				{
+				bza_deref_stk_frame( NULL, stack, frames[ idx ]);
+				}  // still live?
+
+			}  // pop everything
+
+		assert( stack->top == 0);
+		bza_dest_stack( NULL, &stack);
+		}  // contiguous, then segmented
+
+	}  // _________________________________________________________
+
+/**
+ * Test slab sub-allocation of small frames:  immediate reuse,
+ *  byte arrays, checkpoints and compaction.
+ */
+static
+void					test_slab_frames( void)
+	{
+	const
+	int					NUM_FRAMES = 500;
+	const
+	char *				TEST_STR = "Testing, 123";
+
+	t_stack_opts		opts;
+	t_stack *			stack;
+	size_t				frames[ NUM_FRAMES ];
+	size_t				sizes[ NUM_FRAMES ];
+	size_t				srcs[ 3 ];
+	size_t				barr;
+	size_t				big;
+	size_t				top;
+	size_t				mark;
+	char *				ptr;
+	t_remap *			remap;
+	int					pass;
+	int					idx;
+
+	puts( "\nTest slab frames"); fflush( stdout);
+
+	for ( pass = 0; pass < 2; pass++)
+
+		{
+		memset( &opts, 0, sizeof( opts) );
+		opts.flags = BZA_OPT_SLAB;
+		if ( pass == 1)
+			{
+			opts.flags |= BZA_OPT_COMPACT_HDR;
+			opts.seg_shift = 12;
+			}  // segmented, short markers?
+
+		stack = bza_cons_stack_opts( NULL, &opts);
+		for ( idx = 0; idx < NUM_FRAMES; idx++)
+
+			{
+			sizes[ idx ] = ( idx % 5 == 4) ? 300 : ( 1 + ( ( idx * 29) % 128) );
+			frames[ idx ] = bza_cons_stk_frame( NULL, &stack, sizes[ idx ]);
+			ptr = bza_get_frame_ptr( NULL, stack, frames[ idx ]);
+			assert( ( ( (size_t) ptr) & 15) == 0);
+			memset( ptr, idx & 0x7f, sizes[ idx ]);
+			}  // allocate and init each frame
+
+		// freed slots are reused right away, even under live frames
+
+		top = stack->top;
+		for ( idx = 0; idx < NUM_FRAMES; idx += 2)
+
+			{
+			if ( sizes[ idx ] <= 128)
+				{
+				assert( bza_get_ref_count( NULL, stack, frames[ idx ]) == 1);
+				bza_ref_stk_frame( NULL, stack, frames[ idx ]);
+				bza_deref_stk_frame( NULL, stack, frames[ idx ]);
+				bza_deref_stk_frame( NULL, stack, frames[ idx ]);
+				frames[ idx ] = bza_cons_stk_frame( NULL, &stack, sizes[ idx ]);
+				memset( bza_get_frame_ptr( NULL, stack, frames[ idx ]),
+						idx & 0x7f, sizes[ idx ]);
+				}  // small?
+
+			}  // free and reallocate every other small frame
+
+		assert( stack->top == top);
+		assert( ( pass == 1) ||  // (segment end fillers)
+				( bza_get_stranded_bytes( NULL, stack) == 0) );
+
+		// byte arrays go through slabs too
+
+		barr = bzb_from_asciiz( NULL, &stack, TEST_STR);
+		srcs[ 0 ] = srcs[ 1 ] = barr;
+		srcs[ 2 ] = 0;
+		big = bzb_concat( NULL, &stack, srcs);
+		assert( bzb_size( NULL, stack, big) == ( 2 * strlen( TEST_STR) ) );
+		assert( memcmp( &( bzb_to_asciiz( NULL, stack, big)[ strlen( TEST_STR) ]),
+				TEST_STR, strlen( TEST_STR) ) == 0);
+		bzb_deref( NULL, stack, big);
+		bzb_deref( NULL, stack, barr);
+
+		// checkpoints drop slabs made since
+
+		mark = bza_mark( NULL, stack);
+		for ( idx = 0; idx < 200; idx++)
+
+			{
+			bza_cons_stk_frame( NULL, &stack, 100);
+			}  // fill some more slabs
+
+		bza_release_to( NULL, stack, mark);
+		assert( stack->top == mark);
+		for ( idx = 0; idx < 200; idx++)
+
+			{
+			bza_cons_stk_frame( NULL, &stack, 100);
+			}  // fill them again
+
+		bza_release_to( NULL, stack, mark);
+
+		// compaction moves slots along with their slabs
+
+		for ( idx = 4; idx < NUM_FRAMES; idx += 5)
+
+			{
+			bza_deref_stk_frame( NULL, stack, frames[ idx ]);
+			frames[ idx ] = 0;
+			}  // free the big frames
+
+		remap = bza_compact( NULL, stack);
+		for ( idx = 0; idx < NUM_FRAMES; idx++)
+
+			{
+			if ( frames[ idx ] == 0)
+				{
+				continue;  // === skip ===
+				}  // freed?
+
+			frames[ idx ] = bza_remap_off( remap, frames[ idx ]);
+			ptr = bza_get_frame_ptr( NULL, stack, frames[ idx ]);
+			assert( ptr[ 0 ] == ( idx & 0x7f) );
+			assert( ptr[ sizes[ idx ] - 1 ] == ( idx & 0x7f) );
+			}  // check each survivor
+
+		bza_dest_remap( NULL, &remap);
+		for ( idx = 0; idx < NUM_FRAMES; idx++)
+
+			{
+			if ( frames[ idx ] != 0)
+				{
+				bza_deref_stk_frame( NULL, stack, frames[ idx ]);
+				}  // still live?
+
+			}  // free everything (slabs go, but one per class)
+
+		for ( idx = 0; idx < NUM_FRAMES; idx++)
+
+			{
+			frames[ idx ] = bza_cons_stk_frame( NULL, &stack, 16);
+			}  // still works after all that?
+
+		bza_reset_stack( NULL, stack);
+		assert( stack->top == 0);
+		bza_cons_stk_frame( NULL, &stack, 16);
+		bza_dest_stack( NULL, &stack);
+		}  // contiguous, then segmented with compact markers
+
+	}  // _________________________________________________________
+
+/**
+ * Test allocating several frames at once.
+ */
+static
+void					test_batch_frames( void)
+	{
+	const
+	int					NUM_FRAMES = 10;
+
+	t_stack *			stack;
+	size_t				sizes[ NUM_FRAMES ];
+	size_t				offs[ NUM_FRAMES ];
+	const
+	char *				mems[ 3 ] = { "one", "", "three" };
+	size_t				lens[ 3 ] = { 3, 0, 5 };
+	char *				ptr;
+	size_t				lone;
+	int					idx;
+
+	puts( "\nTest batch frame allocation"); fflush( stdout);
+
+	stack = bza_cons_stack( NULL);
+	for ( idx = 0; idx < NUM_FRAMES; idx++)
+
+		{
+		sizes[ idx ] = 1 + ( idx * 50);
+		}  // pick odd sizes
+
+	bza_cons_stk_frames( NULL, &stack, sizes, NUM_FRAMES, offs);
+	for ( idx = 0; idx < NUM_FRAMES; idx++)
+
+		{
+		assert( ( idx == 0) || ( offs[ idx ] > offs[ idx - 1 ]) );
+		assert( bza_get_ref_count( NULL, stack, offs[ idx ]) == 1);
+		ptr = bza_get_frame_ptr( NULL, stack, offs[ idx ]);
+		assert( ( ( (size_t) ptr) & 15) == 0);
+		memset( ptr, idx, sizes[ idx ]);
+		}  // check each frame
+
+	for ( idx = 0; idx < NUM_FRAMES; idx++)
+
+		{
+		ptr = bza_get_frame_ptr( NULL, stack, offs[ idx ]);
+		assert( ( ptr[ 0 ] == idx) && ( ptr[ sizes[ idx ] - 1 ] == idx) );
+		}  // nothing overlapped?
+
+	// with a hole to fill, the batch goes in it
+
+	lone = bza_cons_stk_frame( NULL, &stack, 8);
+	bza_deref_stk_frame( NULL, stack, offs[ 0 ]);
+	bza_cons_stk_frames( NULL, &stack, sizes, 1, offs);
+	assert( offs[ 0 ] < lone);
+
+	// byte arrays in a batch
+
+	bzb_from_fixed_mems( NULL, &stack, mems, lens, 3, offs);
+	for ( idx = 0; idx < 3; idx++)
+
+		{
+		assert( bzb_size( NULL, stack, offs[ idx ]) == lens[ idx ]);
+		assert( strcmp( bzb_to_asciiz( NULL, stack, offs[ idx ]),
+				mems[ idx ]) == 0);
+		}  // check each array
+
+	bza_dest_stack( NULL, &stack);
+	}  // _________________________________________________________
+
+/**
+ * Test a table with many keys, including prefixes of each other.
+ */
+static
+void					test_table_many( void)
+	{
+	const
+	int					NUM_KEYS = 2000;
+
+	t_stack *			stack;
+	size_t				table;
+	size_t				junk;
+	size_t				val;
+	char				key[ 32 ];
+	char				expect[ 32 ];
+	t_remap *			remap;
+	int					idx;
+
+	puts( "\nTest lookup table with many keys"); fflush( stdout);
+
+	stack = bza_cons_stack( NULL);
+	junk = bza_cons_stk_frame( NULL, &stack, 1000);
+	table = bzt_init( NULL, &stack);
+	bzt_put( NULL, &stack, table, "", 0, "empty", 5);
+	for ( idx = 0; idx < NUM_KEYS; idx++)
+
+		{
+		sprintf( key, "%d", idx * 7);
+		sprintf( expect, "v%d", idx);
+		bzt_put( NULL, &stack, table, key, strlen( key),
+				expect, strlen( expect) );
+		}  // put each key
+
+	for ( idx = 0; idx < NUM_KEYS; idx += 3)
+
+		{
+		sprintf( key, "%d", idx * 7);
+		sprintf( expect, "w%d", idx);
+		bzt_put( NULL, &stack, table, key, strlen( key),
+				expect, strlen( expect) );
+		}  // replace some values
+
+	// garbage below the table, so compaction moves it all
+
+	bza_deref_stk_frame( NULL, stack, junk);
+	remap = bza_compact( NULL, stack);
+	table = bzt_relocate( NULL, stack, table, remap);
+	bza_dest_remap( NULL, &remap);
+
+	for ( idx = 0; idx < NUM_KEYS; idx++)
+
+		{
+		sprintf( key, "%d", idx * 7);
+		sprintf( expect, "%c%d", ( ( idx % 3) == 0) ? 'w' : 'v', idx);
+		val = bzt_get( NULL, stack, table, key, strlen( key) );
+		assert( val != 0);
+		assert( strcmp( bzb_to_asciiz( NULL, stack, val), expect) == 0);
+
+		sprintf( key, "%d", ( idx * 7) + 1);
+		val = bzt_get( NULL, stack, table, key, strlen( key) );
+		assert( val == 0);
+		}  // get each key, and miss a neighbor
+
+	val = bzt_get( NULL, stack, table, "", 0);
+	assert( strcmp( bzb_to_asciiz( NULL, stack, val), "empty") == 0);
+
+	bzt_deref( NULL, stack, table);
+	assert( stack->top == 0);
+	bza_dest_stack( NULL, &stack);
+	}  // _________________________________________________________
+
+/**
+ * Test the allocator statistics.
+ */
+static
+void					test_stats( void)
+	{
+	t_stack *			stack;
+	t_stack_stats		stats;
+	t_stack_opts		opts;
+	size_t				low;
+	size_t				mid;
+	size_t				big;
+	size_t				mark;
+	size_t				slot;
+
+	puts( "\nTest allocator statistics"); fflush( stdout);
+
+	stack = bza_cons_stack( NULL);
+	bza_get_stats( NULL, stack, &stats);
+	assert( ( stats.live_frames == 0) && ( stats.live_bytes == 0) );
+	assert( ( stats.top == 0) && ( stats.high_water == 0) );
+
+	low = bza_cons_stk_frame( NULL, &stack, 8);
+	mid = bza_cons_stk_frame( NULL, &stack, 100);
+	big = bza_cons_stk_frame( NULL, &stack, 300000);
+	bza_get_stats( NULL, stack, &stats);
+	assert( stats.live_frames == 3);
+	assert( stats.live_bytes >= ( 8 + 100 + 300000) );
+	assert( ( stats.size_hist[ 0 ] == 1) && ( stats.size_hist[ 3 ] == 1) );
+	assert( stats.size_hist[ BZA_STAT_BUCKETS - 1 ] == 1);
+	assert( stats.num_grows > 0);
+	assert( stats.high_water == stats.top);
+
+	// a dead frame beneath a live one is stranded
+	bza_deref_stk_frame( NULL, stack, mid);
+	bza_get_stats( NULL, stack, &stats);
+	assert( stats.live_frames == 2);
+	assert( ( stats.num_holes == 1) && ( stats.stranded_bytes > 100) );
+	assert( stats.size_hist[ 3 ] == 0);
+
+	// popping lowers the top, but not the high water mark
+	bza_deref_stk_frame( NULL, stack, big);
+	bza_get_stats( NULL, stack, &stats);
+	assert( ( stats.live_frames == 1) && ( stats.num_holes == 0) );
+	assert( stats.top < stats.high_water);
+
+	// frames dropped by a checkpoint are recounted
+	mark = bza_mark( NULL, stack);
+	bza_cons_stk_frame( NULL, &stack, 40);
+	bza_cons_stk_frame( NULL, &stack, 40);
+	bza_release_to( NULL, stack, mark);
+	bza_get_stats( NULL, stack, &stats);
+	assert( stats.live_frames == 1);
+	assert( stats.live_bytes == stats.size_hist[ 0 ] * 8);
+
+	bza_deref_stk_frame( NULL, stack, low);
+	bza_get_stats( NULL, stack, &stats);
+	assert( ( stats.live_frames == 0) && ( stats.live_bytes == 0) );
+	bza_dest_stack( NULL, &stack);
+
+	// slots are counted apart from (their slab) frames
+	memset( &opts, 0, sizeof( opts) );
+	opts.flags = BZA_OPT_SLAB;
+	stack = bza_cons_stack_opts( NULL, &opts);
+	slot = bza_cons_stk_frame( NULL, &stack, 20);
+	bza_get_stats( NULL, stack, &stats);
+	assert( ( stats.live_slots == 1) && ( stats.slot_hist[ 1 ] == 1) );
+	assert( stats.slot_bytes == 32);
+	assert( stats.live_frames == 1);
+	bza_deref_stk_frame( NULL, stack, slot);
+	bza_get_stats( NULL, stack, &stats);
+	assert( stats.live_slots == 0);
+	bza_dest_stack( NULL, &stack);
+	}  // _________________________________________________________
+
+/**
+ * Test the allocator event tracer.
+ */
+static
+void					test_trace( void)
+	{
+	t_stack *			stack;
+	FILE *				tmp;
+	t_trace_hdr			hdr;
+	t_trace_ev			evs[ 16 ];
+	size_t				frame;
+	int					idx;
+
+	puts( "\nTest allocator event tracer"); fflush( stdout);
+
+	stack = bza_cons_stack( NULL);
+	bza_cons_stk_frame( NULL, &stack, 8);  // (not traced)
+	bza_trace_on( NULL, stack, 10);
+	frame = bza_cons_stk_frame( NULL, &stack, 40);
+	bza_ref_stk_frame( NULL, stack, frame);
+	bza_deref_stk_frame( NULL, stack, frame);
+	bza_deref_stk_frame( NULL, stack, frame);
+
+	tmp = tmpfile();
+	bza_trace_save( NULL, stack, tmp);
+	rewind( tmp);
+	assert( fread( &hdr, sizeof( hdr), 1, tmp) == 1);
+	assert( memcmp( hdr.magic, BZA_TRACE_MAGIC, sizeof( hdr.magic) ) == 0);
+	assert( ( hdr.first == 0) && ( hdr.num == 4) );
+	assert( fread( evs, sizeof( evs[ 0 ]), 4, tmp) == 4);
+	assert( ( evs[ 0 ].op == BZA_EV_CONS) && ( evs[ 0 ].off == frame) );
+	assert( evs[ 0 ].size >= 40);
+	assert( ( evs[ 1 ].op == BZA_EV_REF) && ( evs[ 1 ].size == 2) );
+	assert( ( evs[ 2 ].op == BZA_EV_DEREF) && ( evs[ 2 ].size == 1) );
+	assert( ( evs[ 3 ].op == BZA_EV_DEREF) && ( evs[ 3 ].size == 0) );
+	assert( evs[ 3 ].ticks >= evs[ 0 ].ticks);
+	fclose( tmp);
+
+	// the ring keeps only the most recent events
+	for ( idx = 0; idx < 20; idx++)
+
+		{
+		bza_cons_stk_frame( NULL, &stack, 8);
+		}  // overflow the ring
+
+	tmp = tmpfile();
+	bza_trace_save( NULL, stack, tmp);
+	rewind( tmp);
+	assert( fread( &hdr, sizeof( hdr), 1, tmp) == 1);
+	assert( ( hdr.first >= 8) && ( hdr.num == 16) );  // (and any grows)
+	assert( fread( evs, sizeof( evs[ 0 ]), 16, tmp) == 16);
+	assert( evs[ 15 ].op == BZA_EV_CONS);
+	fclose( tmp);
+
+	bza_trace_off( NULL, stack);
+	assert( stack->trace == NULL);
+	bza_dest_stack( NULL, &stack);
+	}  // _________________________________________________________
+
+/**
+ * Test recording of allocation calls (for test/bin/replay).
+ */
+static
+void					test_record( void)
+	{
+	t_stack *			stack;
+	FILE *				tmp;
+	t_record_hdr		hdr;
+	t_record_ev			evs[ 8 ];
+	t_record_move		move;
+	t_remap *			remap;
+	size_t				low;
+	size_t				frame;
+	size_t				mark;
+
+	puts( "\nTest allocation recording"); fflush( stdout);
+
+	stack = bza_cons_stack( NULL);
+	tmp = tmpfile();
+	bza_record_on( NULL, stack, tmp);
+	low = bza_cons_stk_frame( NULL, &stack, 5);
+	frame = bza_cons_stk_frame( NULL, &stack, 40);
+	bza_ref_stk_frame( NULL, stack, frame);
+	bza_deref_stk_frame( NULL, stack, low);
+	mark = bza_mark( NULL, stack);
+	bza_cons_stk_frame( NULL, &stack, 100);  // (too big for the hole)
+	bza_release_to( NULL, stack, mark);
+	remap = bza_compact( NULL, stack);
+	bza_dest_remap( NULL, &remap);
+	bza_record_off( NULL, stack);
+	bza_cons_stk_frame( NULL, &stack, 8);  // (not recorded)
+
+	rewind( tmp);
+	assert( fread( &hdr, sizeof( hdr), 1, tmp) == 1);
+	assert( memcmp( hdr.magic, BZA_RECORD_MAGIC, sizeof( hdr.magic) ) == 0);
+	assert( fread( evs, sizeof( evs[ 0 ]), 7, tmp) == 7);
+	assert( ( evs[ 0 ].op == BZA_EV_CONS) && ( evs[ 0 ].off == low) );
+	assert( evs[ 0 ].size == 5);  // (as requested)
+	assert( ( evs[ 1 ].op == BZA_EV_CONS) && ( evs[ 1 ].size == 40) );
+	assert( ( evs[ 2 ].op == BZA_EV_REF) && ( evs[ 2 ].off == frame) );
+	assert( ( evs[ 3 ].op == BZA_EV_DEREF) && ( evs[ 3 ].size == 0) );
+	assert( evs[ 4 ].op == BZA_EV_CONS);
+	assert( ( evs[ 5 ].op == BZA_EV_RELEASE) && ( evs[ 5 ].off == mark) );
+	assert( ( evs[ 6 ].op == BZA_EV_COMPACT) && ( evs[ 6 ].size == 1) );
+	assert( fread( &move, sizeof( move), 1, tmp) == 1);
+	assert( ( move.old_off == frame) && ( move.new_off < frame) );
+	assert( fread( evs, sizeof( evs[ 0 ]), 1, tmp) == 0);
+	fclose( tmp);
+
+	bza_dest_stack( NULL, &stack);
+	}  // _________________________________________________________
+
+/** return true if every page of a block is resident */
+static
+int						is_resident
+	(
+	void *				blk,			// page aligned block
+	size_t				len				// bytes in block
+	)
+	{
+	size_t				page_size;
+	size_t				num_pages;
+	unsigned char *		vec;
+	size_t				idx;
+	int					all_in;
+
+	page_size = (size_t) sysconf( _SC_PAGESIZE);
+	num_pages = ( len + page_size - 1) / page_size;
+	vec = malloc( num_pages);
+	assert( mincore( blk, len, vec) == 0);
+	all_in = 1;
+	for ( idx = 0; idx < num_pages; idx++)
+
+		{
+		all_in = all_in && ( vec[ idx ] & 1);
+		}  // check each page
+
+	free( vec);
+	return all_in;
+	}  // _________________________________________________________
+
+/**
+ * Test the "real time" options (pre-faulting, locking, huge pages).
+ */
+static
+void					test_rt_options( void)
+	{
+	const
+	size_t				K256 = ( 1 << 18);
+	const
+	size_t				M64 = ( 1 << 26);
+	const
+	size_t				M2 = ( 1 << 21);
+	const
+	int					NUM_FRAMES = 1000;
+
+	t_stack *			stack;
+	t_stack *			locked;
+	t_stack_opts		opts;
+	struct rlimit		old_lim;
+	struct rlimit		lim;
+	size_t				first;
+	size_t				frame;
+	size_t				mapped;
+	int					idx;
+	jmp_buf				catcher;
+	int					is_err;
+
+	puts( "\nTest real time options"); fflush( stdout);
+
+	// fixed, pre-faulted and locked:  no page is left to fault in
+	memset( &opts, 0, sizeof( opts) );
+	opts.initial_size = K256;
+	opts.is_fixed = 1;
+	opts.flags = BZA_OPT_PREFAULT | BZA_OPT_LOCK;
+	stack = bza_cons_stack_opts( NULL, &opts);
+	assert( stack->mapped == K256);
+	assert( is_resident( stack, K256) );
+	first = bza_cons_stk_frame( NULL, &stack, 1000);
+	memset( bza_get_frame_ptr( NULL, stack, first), 'R', 1000);
+
+	is_err = setjmp( catcher);
+	if ( ! is_err)
+		{
+		bza_cons_stk_frame( &catcher, &stack, K256);
+		assert( "Error check failed, this should not be reached" == NULL);
+		}  // initial "try" to overallocate?
+	// else:  falling through from the error check + longjmp
+	assert( ( (char *) bza_get_frame_ptr( NULL, stack, first) )[ 999 ] == 'R');
+	bza_dest_stack( NULL, &stack);
+
+	// growing, on huge pages (if any):  the new pages are faulted in too
+	opts.initial_size = 0;
+	opts.is_fixed = 0;
+	opts.flags = BZA_OPT_PREFAULT | BZA_OPT_HUGE;
+	stack = bza_cons_stack_opts( NULL, &opts);
+	assert( stack->mapped == M2);
+	first = bza_cons_stk_frame( NULL, &stack, 64);
+	memset( bza_get_frame_ptr( NULL, stack, first), 'H', 64);
+	for ( idx = 0; idx < NUM_FRAMES; idx++)
+
+		{
+		frame = bza_cons_stk_frame( NULL, &stack, 4000);
+		memset( bza_get_frame_ptr( NULL, stack, frame), 'I', 4000);
+		}  // allocate each frame
+
+	assert( stack->mapped > M2);
+	assert( ( stack->mapped % M2) == 0);
+	assert( is_resident( stack, stack->mapped) );
+	assert( ( (char *) bza_get_frame_ptr( NULL, stack, first) )[ 63 ] == 'H');
+	assert( ( stack->bytes_copied % M2) == 0);  // (whole mappings, if any)
+	bza_dest_stack( NULL, &stack);
+
+	// normal pages:  grown by mremap, which copies nothing
+	opts.flags = BZA_OPT_PREFAULT;
+	stack = bza_cons_stack_opts( NULL, &opts);
+	for ( idx = 0; idx < NUM_FRAMES; idx++)
+
+		{
+		bza_cons_stk_frame( NULL, &stack, 4000);
+		}  // allocate each frame
+
+	assert( stack->num_grows > 0);
+	assert( stack->bytes_copied == 0);
+	bza_dest_stack( NULL, &stack);
+
+	// "vm" stack:  pages are faulted in as they are committed
+	opts.vm_reserve = M64;
+	opts.flags = BZA_OPT_PREFAULT;
+	stack = bza_cons_stack_opts( NULL, &opts);
+	for ( idx = 0; idx < NUM_FRAMES; idx++)
+
+		{
+		bza_cons_stk_frame( NULL, &stack, 1000);
+		}  // allocate each frame
+
+	assert( is_resident( stack, sizeof( t_stack) + stack->size) );
+	bza_dest_stack( NULL, &stack);
+
+	// locked, growing past the lock limit:  the stack is left as it was
+	// (unless we may lock without limit, e.g. as root)
+	opts.vm_reserve = 0;
+	opts.flags = BZA_OPT_LOCK;
+	opts.initial_size = K256;
+	locked = bza_cons_stack_opts( NULL, &opts);
+	first = bza_cons_stk_frame( NULL, &locked, 1000);
+	memset( bza_get_frame_ptr( NULL, locked, first), 'L', 1000);
+	mapped = locked->mapped;
+
+	getrlimit( RLIMIT_MEMLOCK, &old_lim);
+	lim = old_lim;
+	lim.rlim_cur = mapped;
+	setrlimit( RLIMIT_MEMLOCK, &lim);
+	is_err = setjmp( catcher);
+	if ( ! is_err)
+		{
+		bza_cons_stk_frame( &catcher, &locked, M64);
+		}  // initial "try" to lock too much?
+	else
+		{
+		assert( locked->mapped == mapped);
+		assert( is_resident( locked, mapped) );
+		}  // falling through from the error check + longjmp?
+	setrlimit( RLIMIT_MEMLOCK, &old_lim);
+
+	assert( ( (char *) bza_get_frame_ptr( NULL, locked, first) )[ 999 ] == 'L');
+	frame = bza_cons_stk_frame( NULL, &locked, 1000);
+	memset( bza_get_frame_ptr( NULL, locked, frame), 'M', 1000);
+	bza_dest_stack( NULL, &locked);
+	}  // _________________________________________________________
+
+/** worker for test_stack_pool:  many small "tasks", each on a stack */
+static
+void *					pool_worker
+	(
+	void *				arg				// the pool
+	)
+	{
+	t_stack_pool *		pool;
+	t_stack *			stack;
+	size_t				frame;
+	int					task;
+
+	pool = (t_stack_pool *) arg;
+	for ( task = 0; task < 1000; task++)
+
+		{
+		stack = bza_pool_get( NULL, pool);
+		assert( stack->top == 0);
+		frame = bza_cons_stk_frame( NULL, &stack, 100 + ( task % 7) * 500);
+		memset( bza_get_frame_ptr( NULL, stack, frame), 'P', 100);
+		bza_pool_put( NULL, pool, &stack);
+		assert( stack == NULL);
+		}  // run each task
+
+	return NULL;
+	}  // _________________________________________________________
+
+/**
+ * Test the stack pool.
+ */
+static
+void					test_stack_pool( void)
+	{
+	const
+	int					NUM_THREADS = 4;
+
+	t_stack_pool *		pool;
+	t_pool_opts			opts;
+	t_stack *			stack;
+	t_stack *			first;
+	pthread_t			threads[ NUM_THREADS ];
+	size_t				frame;
+	int					idx;
+	int					rc;
+
+	puts( "\nTest stack pool"); fflush( stdout);
+
+	memset( &opts, 0, sizeof( opts) );
+	opts.stack_opts.initial_size = 4096;
+	opts.cache_max = 2;
+	opts.shared_max = 2;
+	pool = bza_cons_pool( NULL, &opts);
+
+	// a returned stack is reused, reset and trimmed back
+	first = bza_pool_get( NULL, pool);
+	assert( first->size == ( 4096 - sizeof( t_stack) ) );
+	bza_cons_stk_frame( NULL, &first, 100000);
+	assert( first->size > 4096);
+	bza_pool_put( NULL, pool, &first);
+	first = bza_pool_get( NULL, pool);
+	assert( first->top == 0);
+	assert( first->size == ( 4096 - sizeof( t_stack) ) );
+	assert( ( pool->num_created == 1) && ( pool->num_trimmed == 1) );
+	bza_pool_put( NULL, pool, &first);
+
+	// overflow:  cache, then shared list, then freed
+	stack = bza_pool_get( NULL, pool);
+	first = bza_pool_get( NULL, pool);
+	bza_pool_put( NULL, pool, &stack);
+	bza_pool_put( NULL, pool, &first);
+	for ( idx = 0; idx < 5; idx++)
+
+		{
+		stack = bza_cons_stack( NULL);
+		bza_pool_put( NULL, pool, &stack);
+		}  // return some extra stacks
+
+	assert( ( pool->num_shared == 2) && ( pool->num_freed == 3) );
+
+	// threads:  exiting ones give their caches to the shared list
+	for ( idx = 0; idx < NUM_THREADS; idx++)
+
+		{
+		rc = pthread_create( &( threads[ idx ]), NULL, pool_worker, pool);
+		assert( rc == 0);
+		}  // start each thread
+
+	for ( idx = 0; idx < NUM_THREADS; idx++)
+
+		{
+		pthread_join( threads[ idx ], NULL);
+		}  // wait for each thread
+
+	assert( pool->num_shared == 2);
+	assert( pool->num_created <= ( 2 + NUM_THREADS) );
+
+	bza_dest_pool( NULL, &pool);
+	assert( pool == NULL);
+
+	// "vm" stacks:  trimming gives the pages back, in place
+	memset( &opts, 0, sizeof( opts) );
+	opts.stack_opts.initial_size = 65536;
+	opts.stack_opts.vm_reserve = 1 << 28;
+	pool = bza_cons_pool( NULL, &opts);
+	first = bza_pool_get( NULL, pool);
+	stack = first;
+	frame = bza_cons_stk_frame( NULL, &first, 8 << 20);
+	memset( bza_get_frame_ptr( NULL, first, frame), 'p', 8 << 20);
+	bza_pool_put( NULL, pool, &first);
+	first = bza_pool_get( NULL, pool);
+	assert( ( first == stack) && ( pool->num_trimmed == 1) );
+	assert( ( first->size + sizeof( t_stack) ) <= 65536);
+	assert( ! is_resident( ( (char *) first) + ( 4 << 20), 4096) );
+	bza_pool_put( NULL, pool, &first);
+	bza_dest_pool( NULL, &pool);
+	}  // _________________________________________________________
+
+/** worker for test_shared_stack:  frames made, shared, dropped */
+static
+void *					shared_worker
+	(
+	void *				arg				// the (shared) stack
+	)
+	{
+	t_stack *			stack;
+	size_t				frames[ 16 ];
+	int					round;
+	int					idx;
+
+	stack = (t_stack *) arg;
+	for ( round = 0; round < 2000; round++)
+
+		{
+		for ( idx = 0; idx < 16; idx++)
+
+			{
+			frames[ idx ] = bza_cons_stk_frame( NULL, &stack, 8 + idx * 24);
+			bza_ref_stk_frame( NULL, stack, frames[ idx ]);
+			}  // make each frame (2 references)
+
+		for ( idx = 0; idx < 16; idx++)
+
+			{
+			bza_deref_stk_frame( NULL, stack, frames[ ( idx * 7) % 16 ]);
+			bza_deref_stk_frame( NULL, stack, frames[ ( idx * 5) % 16 ]);
+			}  // drop each reference, out of order
+
+		}  // each round
+
+	return NULL;
+	}  // _________________________________________________________
+
+/**
+ * Test stacks shared between threads.
+ */
+static
+void					test_shared_stack( void)
+	{
+	const
+	int					NUM_THREADS = 4;
+
+	t_stack *			stack;
+	t_stack_opts		opts;
+	t_stack_stats		stats;
+	pthread_t			threads[ NUM_THREADS ];
+	size_t				frame;
+	int					idx;
+	int					rc;
+	jmp_buf				catcher;
+	int					is_err;
+
+	puts( "\nTest shared stacks"); fflush( stdout);
+
+	// a stack which may be relocated cannot be shared
+	memset( &opts, 0, sizeof( opts) );
+	opts.flags = BZA_OPT_SHARED;
+	is_err = setjmp( catcher);
+	if ( ! is_err)
+		{
+		bza_cons_stack_opts( &catcher, &opts);
+		assert( "Error check failed, this should not be reached" == NULL);
+		}  // initial "try" to share a relocatable stack?
+
+	// nor a segmented one, since its segment table moves as it grows
+	opts.seg_shift = 12;
+	is_err = setjmp( catcher);
+	if ( ! is_err)
+		{
+		bza_cons_stack_opts( &catcher, &opts);
+		assert( "Error check failed, this should not be reached" == NULL);
+		}  // initial "try" to share a segmented stack?
+	opts.seg_shift = 0;
+
+	opts.vm_reserve = ( 1 << 26);
+	stack = bza_cons_stack_opts( NULL, &opts);
+	frame = bza_cons_stk_frame( NULL, &stack, 100);
+	for ( idx = 0; idx < NUM_THREADS; idx++)
+
+		{
+		rc = pthread_create( &( threads[ idx ]), NULL, shared_worker,
+				stack);
+		assert( rc == 0);
+		}  // start each thread
+
+	for ( idx = 0; idx < NUM_THREADS; idx++)
+
+		{
+		pthread_join( threads[ idx ], NULL);
+		}  // wait for each thread
+
+	// everything the threads made is gone, without a trace
+	bza_get_stats( NULL, stack, &stats);
+	assert( ( stats.live_frames == 1) && ( stats.num_holes == 0) );
+	bza_deref_stk_frame( NULL, stack, frame);
+	assert( stack->top == 0);
+
+	// a failure inside the lock is passed on (and the lock given back)
+	is_err = setjmp( catcher);
+	if ( ! is_err)
+		{
+		bza_cons_stk_frame( &catcher, &stack, ( 1 << 26) );
+		assert( "Error check failed, this should not be reached" == NULL);
+		}  // initial "try" to overallocate?
+	frame = bza_cons_stk_frame( NULL, &stack, 100);
+	bza_deref_stk_frame( NULL, stack, frame);
+
+	bza_dest_stack( NULL, &stack);
+	}  // _________________________________________________________
+
+/**
+ * Test copying tables (and byte arrays) out of a scratch stack.
+ */
+static
+void					test_transfer( void)
+	{
+	const
+	int					NUM_KEYS = 500;
+
+	t_stack *			scratch;
+	t_stack *			stack;
+	t_stack_opts		opts;
+	size_t				table;
+	size_t				copy;
+	size_t				bytes;
+	size_t				val;
+	char				key[ 32 ];
+	char				expect[ 32 ];
+	int					idx;
+
+	puts( "\nTest transfer between stacks"); fflush( stdout);
+
+	scratch = bza_cons_stack( NULL);
+	bza_cons_stk_frame( NULL, &scratch, 5000);  // (garbage)
+	table = bzt_init( NULL, &scratch);
+	for ( idx = 0; idx < NUM_KEYS; idx++)
+
+		{
+		sprintf( key, "k%d", idx * 3);
+		sprintf( expect, "v%d", idx);
+		bzt_put( NULL, &scratch, table, key, strlen( key),
+				expect, strlen( expect) );
+		}  // put each key
+
+	bzt_put( NULL, &scratch, table, "", 0, "empty", 5);
+	bytes = bzb_from_asciiz( NULL, &scratch, "survivor");
+
+	// promote the survivors, onto a stack of another layout
+	memset( &opts, 0, sizeof( opts) );
+	opts.flags = BZA_OPT_COMPACT_HDR;
+	stack = bza_cons_stack_opts( NULL, &opts);
+	copy = bzt_transfer( NULL, scratch, &stack, table);
+	bytes = bzb_transfer( NULL, scratch, &stack, bytes);
+	assert( bzb_transfer( NULL, scratch, &stack, 0) == 0);
+	bza_dest_stack( NULL, &scratch);
+
+	for ( idx = 0; idx < NUM_KEYS; idx++)
+
+		{
+		sprintf( key, "k%d", idx * 3);
+		sprintf( expect, "v%d", idx);
+		val = bzt_get( NULL, stack, copy, key, strlen( key) );
+		assert( val != 0);
+		assert( strcmp( bzb_to_asciiz( NULL, stack, val), expect) == 0);
+
+		sprintf( key, "k%d", ( idx * 3) + 1);
+		assert( bzt_get( NULL, stack, copy, key, strlen( key) ) == 0);
+		}  // get each key, and miss a neighbor
+
+	val = bzt_get( NULL, stack, copy, "", 0);
+	assert( strcmp( bzb_to_asciiz( NULL, stack, val), "empty") == 0);
+	assert( strcmp( bzb_to_asciiz( NULL, stack, bytes), "survivor") == 0);
+	assert( bzb_size( NULL, stack, bytes) == 8);
+
+	// the copy is complete:  dropping it frees every frame
+	bzb_deref( NULL, stack, bytes);
+	bzt_deref( NULL, stack, copy);
+	assert( stack->top == 0);
+	bza_dest_stack( NULL, &stack);
+	}  // _________________________________________________________
+
+/**
+ * Test child stacks, carved out of frames of a parent stack.
+ */
+static
+void					test_child_stack( void)
+	{
+	t_stack *			parent;
+	t_stack *			child;
+	t_stack *			grandchild;
+	t_stack *			heap;
+	t_stack_opts		opts;
+	size_t				mark;
+	size_t				first;
+	size_t				frame;
+	int					idx;
+	jmp_buf				catcher;
+	int					is_err;
+
+	puts( "\nTest child stacks"); fflush( stdout);
+
+	parent = bza_cons_stack_vm( NULL, ( 1 << 24) );
+	mark = bza_mark( NULL, parent);
+
+	// fixed:  fails when full, nests, and goes away with its frame
+	memset( &opts, 0, sizeof( opts) );
+	opts.initial_size = 8192;
+	opts.is_fixed = 1;
+	child = bza_cons_child_stack( NULL, parent, &opts);
+	assert( child->parent == parent);
+	assert( ( child->size + sizeof( t_stack) ) >= 8192);
+	first = bza_cons_stk_frame( NULL, &child, 100);
+	memset( bza_get_frame_ptr( NULL, child, first), 'C', 100);
+
+	opts.initial_size = 2048;
+	grandchild = bza_cons_child_stack( NULL, child, &opts);
+	frame = bza_cons_stk_frame( NULL, &grandchild, 500);
+	memset( bza_get_frame_ptr( NULL, grandchild, frame), 'G', 500);
+	bza_dest_stack( NULL, &grandchild);
+
+	is_err = setjmp( catcher);
+	if ( ! is_err)
+		{
+		bza_cons_stk_frame( &catcher, &child, 8192);
+		assert( "Error check failed, this should not be reached" == NULL);
+		}  // initial "try" to overallocate?
+	// else:  falling through from the error check + longjmp
+	assert( ( (char *) bza_get_frame_ptr( NULL, child, first) )[ 99 ] == 'C');
+	bza_dest_stack( NULL, &child);
+	assert( parent->top == mark);
+
+	// not fixed:  spills into a bigger frame of the parent
+	opts.initial_size = 1024;
+	opts.is_fixed = 0;
+	child = bza_cons_child_stack( NULL, parent, &opts);
+	first = bza_cons_stk_frame( NULL, &child, 100);
+	memset( bza_get_frame_ptr( NULL, child, first), 'S', 100);
+	for ( idx = 0; idx < 100; idx++)
+
+		{
+		bza_cons_stk_frame( NULL, &child, 200);
+		}  // allocate each frame
+
+	assert( child->num_grows > 0);
+	assert( ( (char *) bza_get_frame_ptr( NULL, child, first) )[ 0 ] == 'S');
+	assert( bza_get_ref_count( NULL, parent, child->parent_frame) == 1);
+	bza_dest_stack( NULL, &child);
+	assert( parent->top == mark);
+
+	// a parent which may move would leave its children behind
+	heap = bza_cons_stack( NULL);
+	is_err = setjmp( catcher);
+	if ( ! is_err)
+		{
+		bza_cons_child_stack( &catcher, heap, NULL);
+		assert( "Error check failed, this should not be reached" == NULL);
+		}  // initial "try" to nest in a relocatable stack?
+	bza_dest_stack( NULL, &heap);
+
+	// shared:  only if fixed, since spilling would move it
+	memset( &opts, 0, sizeof( opts) );
+	opts.initial_size = 1024;
+	opts.flags = BZA_OPT_SHARED;
+	is_err = setjmp( catcher);
+	if ( ! is_err)
+		{
+		bza_cons_child_stack( &catcher, parent, &opts);
+		assert( "Error check failed, this should not be reached" == NULL);
+		}  // initial "try" to share a child that may spill?
+	assert( parent->top == mark);
+
+	opts.is_fixed = 1;
+	child = bza_cons_child_stack( NULL, parent, &opts);
+	bza_dest_stack( NULL, &child);
+
+	// storage options the parent's frame cannot provide
+	opts.flags = BZA_OPT_COW;
+	is_err = setjmp( catcher);
+	if ( ! is_err)
+		{
+		bza_cons_child_stack( &catcher, parent, &opts);
+		assert( "Error check failed, this should not be reached" == NULL);
+		}  // initial "try" at a copy-on-write child?
+
+	opts.flags = 0;
+	opts.vm_reserve = 1 << 20;
+	is_err = setjmp( catcher);
+	if ( ! is_err)
+		{
+		bza_cons_child_stack( &catcher, parent, &opts);
+		assert( "Error check failed, this should not be reached" == NULL);
+		}  // initial "try" at a "vm" child?
+	assert( parent->top == mark);
+
+	bza_dest_stack( NULL, &parent);
+	}  // _________________________________________________________
+
+/**
+ * Test saving a stack to a file, and mapping it back.
+ */
+static
+void					test_save_map( void)
+	{
+	const
+	int					NUM_KEYS = 300;
+
+	t_stack *			stack;
+	t_stack *			mapped;
+	t_stack_stats		stats;
+	size_t				table;
+	size_t				root;
+	size_t				val;
+	size_t				junk;
+	char				path[] = "/tmp/bz_save_XXXXXX";
+	char				key[ 32 ];
+	char				expect[ 32 ];
+	uint64_t			bad;
+	int					fd;
+	int					idx;
+	jmp_buf				catcher;
+	int					is_err;
+
+	puts( "\nTest saved (mapped) stacks"); fflush( stdout);
+
+	stack = bza_cons_stack( NULL);
+	junk = bza_cons_stk_frame( NULL, &stack, 3000);
+	table = bzt_init( NULL, &stack);
+	for ( idx = 0; idx < NUM_KEYS; idx++)
+
+		{
+		sprintf( key, "s%d", idx);
+		sprintf( expect, "m%d", idx);
+		bzt_put( NULL, &stack, table, key, strlen( key),
+				expect, strlen( expect) );
+		}  // put each key
+
+	bza_deref_stk_frame( NULL, stack, junk);  // (a hole is saved too)
+
+	fd = mkstemp( path);
+	assert( fd >= 0);
+	bza_save_stack( NULL, stack, table, fd);
+	close( fd);
+
+	// read-only:  lookups straight from the file
+	mapped = bza_map_stack( NULL, path, 0, &root);
+	assert( root == table);
+	assert( mapped->top == stack->top);
+	for ( idx = 0; idx < NUM_KEYS; idx++)
+
+		{
+		sprintf( key, "s%d", idx);
+		sprintf( expect, "m%d", idx);
+		val = bzt_get( NULL, mapped, root, key, strlen( key) );
+		assert( strcmp( bzb_to_asciiz( NULL, mapped, val), expect) == 0);
+		}  // get each key
+
+	bza_get_stats( NULL, mapped, &stats);
+	assert( stats.num_holes == 1);
+	bza_dest_stack( NULL, &mapped);
+
+	// copy-on-write:  changes stay in this process
+	mapped = bza_map_stack( NULL, path, 1, &root);
+	bzt_deref( NULL, mapped, root);
+	assert( mapped->top == 0);
+	bza_dest_stack( NULL, &mapped);
+
+	mapped = bza_map_stack( NULL, path, 1, &root);
+	assert( mapped->top == stack->top);
+	val = bzt_get( NULL, mapped, root, "s7", 2);
+	assert( strcmp( bzb_to_asciiz( NULL, mapped, val), "m7") == 0);
+	bza_dest_stack( NULL, &mapped);
+
+	// a hole list head which is not a frame is refused
+	fd = open( path, O_RDWR);
+	assert( fd >= 0);
+	bad = stack->top + 64;
+	assert( pwrite( fd, &bad, sizeof( bad), offsetof( t_save_hdr, holes) )
+			== sizeof( bad) );
+	close( fd);
+	is_err = setjmp( catcher);
+	if ( ! is_err)
+		{
+		bza_map_stack( &catcher, path, 0, &root);
+		assert( "Error check failed, this should not be reached" == NULL);
+		}  // initial "try" to map a corrupt file?
+
+	// ... as is a root which is not
+	fd = open( path, O_RDWR | O_TRUNC);
+	assert( fd >= 0);
+	bza_save_stack( NULL, stack, table + 8, fd);
+	is_err = setjmp( catcher);
+	if ( ! is_err)
+		{
+		bza_map_stack( &catcher, path, 0, &root);
+		assert( "Error check failed, this should not be reached" == NULL);
+		}  // initial "try" to map a misaligned root?
+
+	// ... and a file too short for its frames
+	assert( ftruncate( fd, 0) == 0);
+	bza_save_stack( NULL, stack, table, fd);
+	assert( ftruncate( fd, BZA_SAVE_DATA_OFF + ( stack->top / 2) ) == 0);
+	close( fd);
+	is_err = setjmp( catcher);
+	if ( ! is_err)
+		{
+		bza_map_stack( &catcher, path, 0, &root);
+		assert( "Error check failed, this should not be reached" == NULL);
+		}  // initial "try" to map a truncated file?
+
+	unlink( path);
+	bzt_deref( NULL, stack, table);
+	bza_dest_stack( NULL, &stack);
+	}  // _________________________________________________________
+
+/**
+ * Test cloning stacks (copy-on-write, or copied).
+ */
+static
+void					test_clone_stack( void)
+	{
+	t_stack_opts		opts;
+	t_stack *			stack;
+	t_stack *			clone;
+	t_stack *			clone2;
+	t_stack *			plain;
+	size_t				frames[ 64 ];
+	size_t				extra;
+	int					idx;
+	jmp_buf				catcher;
+	int					is_err;
+
+	puts( "\nTest cloned stacks"); fflush( stdout);
+
+	memset( &opts, 0, sizeof( opts) );
+	opts.flags = BZA_OPT_COW;
+	stack = bza_cons_stack_opts( NULL, &opts);
+	for ( idx = 0; idx < 64; idx++)
+
+		{
+		frames[ idx ] = bza_cons_stk_frame( NULL, &stack, 1000);
+		memset( bza_get_frame_ptr( NULL, stack, frames[ idx ]), idx, 1000);
+		}  // fill several pages
+
+	// each side's changes stay its own
+	clone = bza_clone_stack( NULL, stack);
+	assert( clone != stack);
+	assert( clone->top == stack->top);
+	memset( bza_get_frame_ptr( NULL, clone, frames[ 3 ]), 'c', 1000);
+	memset( bza_get_frame_ptr( NULL, stack, frames[ 5 ]), 's', 1000);
+	assert( ( (char *) bza_get_frame_ptr( NULL, stack, frames[ 3 ]) )[ 9 ]
+			== 3);
+	assert( ( (char *) bza_get_frame_ptr( NULL, clone, frames[ 5 ]) )[ 9 ]
+			== 5);
+	assert( ( (char *) bza_get_frame_ptr( NULL, clone, frames[ 3 ]) )[ 9 ]
+			== 'c');
+
+	// frames come and go independently, and either may grow
+	bza_deref_stk_frame( NULL, clone, frames[ 63 ]);
+	assert( clone->top < stack->top);
+	extra = bza_cons_stk_frame( NULL, &clone, 100000);
+	memset( bza_get_frame_ptr( NULL, clone, extra), 'x', 100000);
+	assert( ( (char *) bza_get_frame_ptr( NULL, clone, frames[ 62 ]) )[ 9 ]
+			== 62);
+	extra = bza_cons_stk_frame( NULL, &stack, 100000);
+	assert( ( (char *) bza_get_frame_ptr( NULL, stack, frames[ 63 ]) )[ 9 ]
+			== 63);
+
+	// a clone of a clone, while the first is still in use
+	clone2 = bza_clone_stack( NULL, clone);
+	memset( bza_get_frame_ptr( NULL, clone, frames[ 7 ]), 'C', 1000);
+	assert( ( (char *) bza_get_frame_ptr( NULL, clone2, frames[ 3 ]) )[ 9 ]
+			== 'c');
+	assert( ( (char *) bza_get_frame_ptr( NULL, clone2, frames[ 7 ]) )[ 9 ]
+			== 7);
+	bza_dest_stack( NULL, &clone2);
+	bza_dest_stack( NULL, &clone);
+
+	// cloned again (after the clones are gone):  sees later changes
+	memset( bza_get_frame_ptr( NULL, stack, frames[ 9 ]), 'S', 1000);
+	clone = bza_clone_stack( NULL, stack);
+	assert( ( (char *) bza_get_frame_ptr( NULL, clone, frames[ 9 ]) )[ 9 ]
+			== 'S');
+	assert( ( (char *) bza_get_frame_ptr( NULL, clone, frames[ 5 ]) )[ 9 ]
+			== 's');
+	bza_dest_stack( NULL, &clone);
+	bza_dest_stack( NULL, &stack);
+
+	// any other stack is copied
+	plain = bza_cons_stack( NULL);
+	frames[ 0 ] = bza_cons_stk_frame( NULL, &plain, 500);
+	memset( bza_get_frame_ptr( NULL, plain, frames[ 0 ]), 'p', 500);
+	clone = bza_clone_stack( NULL, plain);
+	assert( clone->flags & BZA_OPT_COW);
+	memset( bza_get_frame_ptr( NULL, plain, frames[ 0 ]), 'q', 500);
+	assert( ( (char *) bza_get_frame_ptr( NULL, clone, frames[ 0 ]) )[ 9 ]
+			== 'p');
+	bza_dest_stack( NULL, &clone);
+	bza_dest_stack( NULL, &plain);
+
+	// (not with other storage)
+	opts.flags = BZA_OPT_COW | BZA_OPT_PREFAULT;
+	is_err = setjmp( catcher);
+	if ( ! is_err)
+		{
+		bza_cons_stack_opts( &catcher, &opts);
+		assert( "Error check failed, this should not be reached" == NULL);
+		}  // initial "try" to map a "real time" stack from a file?
+	}  // _________________________________________________________
+
+/**
+ * Test giving memory back after a spike (bza_trim, BZA_OPT_AUTO_TRIM).
+ */
+static
+void					test_trim( void)
+	{
+	const
+	size_t				SPIKE = 8 << 20;
+
+	t_stack_opts		opts;
+	t_stack *			stack;
+	t_stack *			parent;
+	size_t				small;
+	size_t				big;
+	size_t				idx;
+	size_t				frames[ 10 ];
+
+	puts( "\nTest trimming stacks"); fflush( stdout);
+
+	// plain:  reallocated
+	stack = bza_cons_stack( NULL);
+	small = bza_cons_stk_frame( NULL, &stack, 100);
+	memset( bza_get_frame_ptr( NULL, stack, small), 's', 100);
+	big = bza_cons_stk_frame( NULL, &stack, SPIKE);
+	bza_deref_stk_frame( NULL, stack, big);
+	assert( stack->size >= SPIKE);
+	assert( bza_trim( NULL, &stack, 0) >= ( SPIKE - stack->top) );
+	assert( stack->size == stack->top);
+	assert( ( (char *) bza_get_frame_ptr( NULL, stack, small) )[ 99 ] == 's');
+	assert( bza_trim( NULL, &stack, 0) == 0);
+	big = bza_cons_stk_frame( NULL, &stack, 1000);  // (grows again)
+	bza_dest_stack( NULL, &stack);
+
+	// "vm":  the pages are given back in place
+	stack = bza_cons_stack_vm( NULL, 1 << 28);
+	small = bza_cons_stk_frame( NULL, &stack, 100);
+	big = bza_cons_stk_frame( NULL, &stack, SPIKE);
+	memset( bza_get_frame_ptr( NULL, stack, big), 'b', SPIKE);
+	bza_deref_stk_frame( NULL, stack, big);
+	assert( bza_trim( NULL, &stack, 0) > 0);
+	assert( ! is_resident( ( (char *) stack) + ( SPIKE / 2), 4096) );
+	big = bza_cons_stk_frame( NULL, &stack, SPIKE);
+	memset( bza_get_frame_ptr( NULL, stack, big), 'c', SPIKE);
+	bza_dest_stack( NULL, &stack);
+
+	// segmented:  segments beyond the top are freed
+	stack = bza_cons_stack_seg( NULL, 16);
+	for ( idx = 0; idx < 10; idx++)
+
+		{
+		frames[ idx ] = bza_cons_stk_frame( NULL, &stack, 30000);
+		}  // several segments' worth
+
+	assert( stack->num_segs >= 5);
+	for ( idx = 1; idx < 10; idx++)
+
+		{
+		bza_deref_stk_frame( NULL, stack, frames[ 10 - idx ]);
+		}  // all but the first, from the top
+
+	assert( bza_trim( NULL, &stack, 0) > 0);
+	assert( stack->num_segs == 1);
+	bza_dest_stack( NULL, &stack);
+
+	// mapped, and copy-on-write:  unmapped in place
+	memset( &opts, 0, sizeof( opts) );
+	opts.flags = BZA_OPT_PREFAULT;
+	for ( idx = 0; idx < 2; idx++)
+
+		{
+		stack = bza_cons_stack_opts( NULL, &opts);
+		small = bza_cons_stk_frame( NULL, &stack, 100);
+		memset( bza_get_frame_ptr( NULL, stack, small), 's', 100);
+		big = bza_cons_stk_frame( NULL, &stack, SPIKE);
+		bza_deref_stk_frame( NULL, stack, big);
+		assert( bza_trim( NULL, &stack, 0) > 0);
+		assert( stack->mapped < ( 1 << 20) );
+		assert( ( (char *) bza_get_frame_ptr( NULL, stack, small) )[ 0 ]
+				== 's');
+		big = bza_cons_stk_frame( NULL, &stack, SPIKE);
+		memset( bza_get_frame_ptr( NULL, stack, big), 'b', SPIKE);
+		bza_dest_stack( NULL, &stack);
+		opts.flags = BZA_OPT_COW;
+		}  // each sort of mapping
+
+	// fixed size:  left alone
+	stack = bza_cons_stack_rt( NULL, 1 << 20, 1);
+	assert( bza_trim( NULL, &stack, 0) == 0);
+	bza_dest_stack( NULL, &stack);
+
+	// child:  left alone too (its parent would only grow)
+	parent = bza_cons_stack_vm( NULL, 1 << 28);
+	memset( &opts, 0, sizeof( opts) );
+	opts.initial_size = 4096;
+	stack = bza_cons_child_stack( NULL, parent, &opts);
+	big = bza_cons_stk_frame( NULL, &stack, 100000);
+	bza_deref_stk_frame( NULL, stack, big);
+	idx = parent->top;
+	assert( bza_trim( NULL, &stack, 0) == 0);
+	assert( parent->top == idx);
+	bza_dest_stack( NULL, &stack);
+	bza_dest_stack( NULL, &parent);
+
+	// automatic:  cut back on the next push, down to twice what's used
+	memset( &opts, 0, sizeof( opts) );
+	opts.flags = BZA_OPT_AUTO_TRIM;
+	stack = bza_cons_stack_opts( NULL, &opts);
+	small = bza_cons_stk_frame( NULL, &stack, 100);
+	big = bza_cons_stk_frame( NULL, &stack, SPIKE);
+	bza_deref_stk_frame( NULL, stack, big);
+	assert( stack->size >= SPIKE);
+	big = bza_cons_stk_frame( NULL, &stack, 1000);
+	assert( stack->size < ( 1 << 20) );
+	assert( stack->size >= ( 64 * 1024) );
+
+	// (and not again, until the stack grows and shrinks a lot)
+	idx = stack->num_grows;
+	for ( small = 0; small < 20; small++)
+
+		{
+		bza_deref_stk_frame( NULL, stack, big);
+		big = bza_cons_stk_frame( NULL, &stack, 1000);
+		}  // churn
+
+	assert( stack->num_grows == idx);
+	bza_dest_stack( NULL, &stack);
+	}  // _________________________________________________________
+
+/**
+ * Test that the inline accessors agree with their checked counterparts,
+ *  on each frame layout (also built with BZA_UNCHECKED, see Makefile).
+ */
+static
+void					test_fast_access( void)
+	{
+	static const
+	int					FLAGS[] = { 0, BZA_OPT_COMPACT_HDR, BZA_OPT_SLAB,
+										BZA_OPT_OFF32 };
+	static const
+	size_t				SIZES[] = { 8, 40, 100, 1000, 70000 };
+	const
+	int					NUM_SIZES = sizeof( SIZES) / sizeof( SIZES[ 0 ]);
+
+	t_stack_opts		opts;
+	t_stack *			stack;
+	size_t				frames[ sizeof( SIZES) / sizeof( SIZES[ 0 ]) ];
+	size_t				bytes;
+	size_t				empty;
+	int					num_slots;
+	int					layout;
+	int					idx;
+
+#ifdef BZA_UNCHECKED
+	puts( "\nTest inline accessors (unchecked)"); fflush( stdout);
+#else
+	puts( "\nTest inline accessors"); fflush( stdout);
+#endif  // BZA_UNCHECKED defined?
+
+	// each layout in FLAGS, then a segmented stack
+	for ( layout = 0; layout < 5; layout++)
+
+		{
+		memset( &opts, 0, sizeof( opts) );
+		if ( layout < 4)
+			{
+			opts.flags = FLAGS[ layout ];
+			}  // contiguous?
+		else
+			{
+			opts.seg_shift = 17;
+			}  // segmented
+
+		stack = bza_cons_stack_opts( NULL, &opts);
+		num_slots = 0;
+		for ( idx = 0; idx < NUM_SIZES; idx++)
+
+			{
+			frames[ idx ] = bza_cons_stk_frame( NULL, &stack, SIZES[ idx ]);
+			memset( bza_fast_frame_ptr( stack, frames[ idx ]), 'a' + idx,
+					SIZES[ idx ]);
+			num_slots += ( ( frames[ idx ] & BZA_SLOT_TAG) != 0);
+			}  // make each frame
+
+		// (small frames are slab slots on a BZA_OPT_SLAB stack)
+		assert( ( num_slots > 0) == ( ( stack->flags & BZA_OPT_SLAB) != 0) );
+
+		bza_ref_stk_frame( NULL, stack, frames[ 0 ]);
+		for ( idx = 0; idx < NUM_SIZES; idx++)
+
+			{
+			assert( bza_fast_frame_ptr( stack, frames[ idx ]) ==
+					bza_get_frame_ptr( NULL, stack, frames[ idx ]) );
+			assert( *bza_frame_refs( stack, frames[ idx ]) ==
+					bza_get_ref_count( NULL, stack, frames[ idx ]) );
+			assert( ( (char *) bza_fast_frame_ptr( stack, frames[ idx ]) )
+					[ SIZES[ idx ] - 1 ] == ( 'a' + idx) );
+			}  // compare each frame
+
+		assert( *bza_frame_refs( stack, frames[ 0 ]) == 2);
+
+		// byte arrays (32 bit headers on a BZA_OPT_OFF32 stack)
+		bytes = bzb_from_asciiz( NULL, &stack, "fast and checked");
+		empty = bzb_init_size( NULL, &stack, 10);
+		assert( bzb_fast_size( stack, bytes) == bzb_size( NULL, stack, bytes) );
+		assert( bzb_fast_size( stack, bytes) == 16);
+		assert( bzb_fast_data( stack, bytes) ==
+				bzb_to_asciiz( NULL, stack, bytes) );
+		assert( strcmp( bzb_fast_data( stack, bytes), "fast and checked") == 0);
+		assert( bzb_fast_size( stack, empty) == 0);
+		assert( bzb_fast_data( stack, empty) ==
+				bzb_to_asciiz( NULL, stack, empty) );
+		bza_dest_stack( NULL, &stack);
+		}  // each layout
+
+	}  // _________________________________________________________
+
+/**
+ * Test 32 bit offset stacks (BZA_OPT_OFF32):  byte arrays and tables
+ *  work as usual, in less space, and move to and from normal stacks.
+ */
+static
+void					test_off32( void)
+	{
+	const
+	int					NUM_KEYS = 2000;
+
+	t_stack_opts		opts;
+	t_stack *			stacks[ 2 ];
+	t_stack *			stack;
+	size_t				tables[ 2 ];
+	size_t				copy;
+	size_t				back;
+	size_t				srcs[ 3 ];
+	size_t				bytes;
+	size_t				val;
+	char				key[ 32 ];
+	char				expect[ 32 ];
+	t_remap *			remap;
+	int					idx;
+	int					side;
+	jmp_buf				catcher;
+	int					is_err;
+
+	puts( "\nTest 32 bit offset stacks"); fflush( stdout);
+
+	// the same table, on a normal and a 32 bit stack
+	memset( &opts, 0, sizeof( opts) );
+	for ( side = 0; side < 2; side++)
+
+		{
+		opts.flags = side ? BZA_OPT_OFF32 : 0;
+		stacks[ side ] = bza_cons_stack_opts( NULL, &opts);
+		bytes = bza_cons_stk_frame( NULL, &stacks[ side ], 1000);
+		tables[ side ] = bzt_init( NULL, &stacks[ side ]);
+		for ( idx = 0; idx < NUM_KEYS; idx++)
+
+			{
+			sprintf( key, "%d", idx * 7);
+			sprintf( expect, "v%d", idx);
+			bzt_put( NULL, &stacks[ side ], tables[ side ], key, strlen( key),
+					expect, strlen( expect) );
+			}  // put each key
+
+		// (compaction moves it all)
+		bza_deref_stk_frame( NULL, stacks[ side ], bytes);
+		remap = bza_compact( NULL, stacks[ side ]);
+		tables[ side ] = bzt_relocate( NULL, stacks[ side ], tables[ side ],
+				remap);
+		bza_dest_remap( NULL, &remap);
+		}  // each sort of stack
+
+	stack = stacks[ 1 ];
+	assert( stack->flags & BZA_OPT_COMPACT_HDR);
+	assert( ( stack->top * 3) < ( stacks[ 0 ]->top * 2) );
+	printf( "table of %d keys:  %lu b, vs %lu b\n", NUM_KEYS,
+			(unsigned long) stack->top, (unsigned long) stacks[ 0 ]->top);
+
+	// copied to the normal stack, and back again
+	copy = bzt_transfer( NULL, stack, &stacks[ 0 ], tables[ 1 ]);
+	bzt_deref( NULL, stack, tables[ 1 ]);
+	assert( stack->top == 0);
+	back = bzt_transfer( NULL, stacks[ 0 ], &stack, copy);
+	for ( idx = 0; idx < NUM_KEYS; idx++)
+
+		{
+		sprintf( key, "%d", idx * 7);
+		sprintf( expect, "v%d", idx);
+		for ( side = 0; side < 2; side++)
+
+			{
+			val = bzt_get( NULL, stacks[ side ], side ? back : copy,
+					key, strlen( key) );
+			assert( val != 0);
+			assert( strcmp( bzb_to_asciiz( NULL, stacks[ side ], val),
+					expect) == 0);
+			}  // each copy
+
+		sprintf( key, "%d", ( idx * 7) + 1);
+		assert( bzt_get( NULL, stack, back, key, strlen( key) ) == 0);
+		}  // get each key, and miss a neighbor
+
+	bzt_deref( NULL, stack, back);
+	assert( stack->top == 0);
+
+	// byte arrays
+	srcs[ 0 ] = bzb_from_asciiz( NULL, &stack, "abc");
+	srcs[ 1 ] = bzb_from_fixed_mem( NULL, &stack, "defgh", 5);
+	srcs[ 2 ] = 0;
+	bytes = bzb_concat( NULL, &stack, srcs);
+	assert( strcmp( bzb_to_asciiz( NULL, stack, bytes), "abcdefgh") == 0);
+	assert( bzb_size( NULL, stack, bytes) == 8);
+	val = bzb_subarray( NULL, &stack, bytes, 2, 4);
+	assert( strcmp( bzb_to_asciiz( NULL, stack, val), "cdef") == 0);
+	bzb_deref( NULL, stack, val);
+	val = bzb_init_size( NULL, &stack, 4);
+	for ( idx = 0; idx < 3; idx++)
+
+		{
+		bytes = bzb_concat_to( NULL, &stack, val, srcs[ 0 ]);
+		bzb_deref( NULL, stack, val);
+		val = bytes;
+		}  // append, outgrowing the buffer
+
+	assert( strcmp( bzb_to_asciiz( NULL, stack, val), "abcabcabc") == 0);
+	bytes = bzb_transfer( NULL, stack, &stacks[ 0 ], val);
+	assert( strcmp( bzb_to_asciiz( NULL, stacks[ 0 ], bytes), "abcabcabc")
+			== 0);
+	assert( bzb_size( NULL, stacks[ 0 ], bytes) == 9);
+
+	bza_dest_stack( NULL, &stacks[ 0 ]);
+	bza_dest_stack( NULL, &stack);
+
+	// no more than 4 GB
+	opts.flags = BZA_OPT_OFF32;
+	opts.initial_size = ( (size_t) 5) << 30;
+	is_err = setjmp( catcher);
+	if ( ! is_err)
+		{
+		bza_cons_stack_opts( &catcher, &opts);
+		assert( "Error check failed, this should not be reached" == NULL);
+		}  // initial "try" to make a huge stack?
+	// else:  falling through from the error check + longjmp
+	}  // _________________________________________________________
+
 /**
  * Drive tests.
  * TODO: xunit or something like that (but exit-on-failure for now)
@@ -508,11 +2889,36 @@ int						main
 	test_stack_init();
 	test_stack_alloc();
 	test_rt_stack_alloc();
+	test_stack_grow();
+	test_stack_holes();
+	test_hole_merge();
+	test_stack_compact();
+	test_stack_reset();
+	test_vm_stack();
+	test_seg_stack();
+	test_aligned_frames();
+	test_compact_hdr();
+	test_slab_frames();
 
 	test_byte_array();
 	test_mutable_byte_array();
 
 	test_table_access();
+	test_batch_frames();
+	test_table_many();
+	test_stats();
+	test_trace();
+	test_record();
+	test_rt_options();
+	test_stack_pool();
+	test_shared_stack();
+	test_transfer();
+	test_child_stack();
+	test_save_map();
+	test_clone_stack();
+	test_trim();
+	test_fast_access();
+	test_off32();
 
 	// TODO: basic I/O
 
@@ -0,0 +1,517 @@
+/**
+ * Replay an allocation recording (from bza_record_on)
+ *  against a stack, or against malloc for comparison,
+ *  and report throughput, peak RSS and fragmentation.
+ *  Each frame is filled (memset) when made, as a real caller would,
+ *  so that both allocators touch the same pages.
+ *  usage:  replay recording [bza|malloc]
+ */
+/*
+    buzzard:  blaze runtime (so far, just a simple memory management library)
+
+    Copyright (C) 2010, Robin R Anderson
+    roboprog@yahoo.com
+    PO 1608
+    Shingle Springs, CA 95682
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "bzrt_alloc.h"
+
+/** a live frame, by its recorded offset */
+typedef struct			t_live
+	{
+	uint64_t			key;			// recorded offset, 0 if slot empty
+	size_t				handle;			// replayed frame offset (bza)
+	void *				ptr;			// replayed block (malloc)
+	uint32_t			refs;			// reference count
+	uint32_t			size;			// requested size
+	}					t_live;
+
+/** replay state */
+typedef struct			t_replay
+	{
+	int					use_malloc;		// true for malloc, false for bza
+	t_stack *			stack;			// stack replayed on (bza)
+	t_live *			lives;			// hash table of live frames
+	size_t				mask;			// table size - 1 (a power of 2)
+	size_t				num_lives;		// number of live frames
+	size_t				live_bytes;		// requested bytes in live frames
+	size_t				peak_bytes;		// most live bytes at once
+	}					t_replay;
+
+/** return a monotonic time stamp, in seconds */
+static
+double					now_sec( void)
+	{
+	struct timespec		ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ( ts.tv_nsec / 1e9);
+	}  // _________________________________________________________
+
+/** return the peak resident set size so far, in KB */
+static
+long					peak_rss_kb( void)
+	{
+	struct rusage		usage;
+
+	getrusage( RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+	}  // _________________________________________________________
+
+/** return the home slot of a key */
+static
+size_t					home_of
+	(
+	const
+	t_replay *			rp,				// replay state
+	uint64_t			key				// recorded offset
+	)
+	{
+	return ( ( key * 0x9E3779B97F4A7C15ULL) >> 24) & rp->mask;
+	}  // _________________________________________________________
+
+/** return the slot holding a key, or the empty slot where it would go */
+static
+size_t					find_slot
+	(
+	const
+	t_replay *			rp,				// replay state
+	uint64_t			key				// recorded offset
+	)
+	{
+	size_t				idx;
+
+	for ( idx = home_of( rp, key);
+		  ( rp->lives[ idx ].key != 0) && ( rp->lives[ idx ].key != key);
+		  idx = ( idx + 1) & rp->mask)
+
+		{
+		}  // probe each slot
+
+	return idx;
+	}  // _________________________________________________________
+
+/** make the hash table the given size (a power of 2), rehashing */
+static
+void					resize_table
+	(
+	t_replay *			rp,				// replay state
+	size_t				num_slots		// new table size
+	)
+	{
+	t_live *			old;
+	size_t				old_slots;
+	size_t				idx;
+
+	old = rp->lives;
+	old_slots = ( old != NULL) ? ( rp->mask + 1) : 0;
+	rp->lives = calloc( num_slots, sizeof( t_live) );
+	rp->mask = num_slots - 1;
+	for ( idx = 0; idx < old_slots; idx++)
+
+		{
+		if ( old[ idx ].key != 0)
+			{
+			rp->lives[ find_slot( rp, old[ idx ].key) ] = old[ idx ];
+			}  // in use?
+
+		}  // move each entry
+
+	free( old);
+	}  // _________________________________________________________
+
+/** remove the entry in a slot (shifting later probes back) */
+static
+void					remove_slot
+	(
+	t_replay *			rp,				// replay state
+	size_t				hole			// slot to be emptied
+	)
+	{
+	size_t				idx;
+	size_t				home;
+
+	for ( idx = ( hole + 1) & rp->mask;
+		  rp->lives[ idx ].key != 0;
+		  idx = ( idx + 1) & rp->mask)
+
+		{
+		home = home_of( rp, rp->lives[ idx ].key);
+		if ( ( ( idx - home) & rp->mask) >= ( ( idx - hole) & rp->mask) )
+			{
+			rp->lives[ hole ] = rp->lives[ idx ];
+			hole = idx;
+			}  // may move back into the hole?
+
+		}  // check each later probe
+
+	rp->lives[ hole ].key = 0;
+	rp->num_lives--;
+	}  // _________________________________________________________
+
+/** drop a frame altogether (as by a release or reset) */
+static
+void					drop_live
+	(
+	t_replay *			rp,				// replay state
+	t_live *			live			// live frame
+	)
+	{
+	rp->live_bytes -= live->size;
+	if ( rp->use_malloc)
+		{
+		free( live->ptr);
+		}  // malloc?
+	else
+		{
+		while ( live->refs-- > 0)
+
+			{
+			bza_deref_stk_frame( NULL, rp->stack, live->handle);
+			}  // deref until gone
+
+		}  // bza
+
+	}  // _________________________________________________________
+
+/** translate the recorded offset of a frame moved by a compaction */
+static
+uint64_t				moved_key
+	(
+	const
+	t_record_move *		moves,			// moves, in offset order
+	size_t				num_moves,		// number of moves
+	uint64_t			key				// recorded offset (before)
+	)
+	{
+	size_t				low;
+	size_t				high;
+	size_t				mid;
+	uint64_t			look_for;
+
+	// a slot moves with the slab (frame) just above it
+	look_for = ( key & 1) ? ( key + 1) : key;
+	low = 0;
+	high = num_moves;
+	while ( low < high)
+
+		{
+		mid = low + ( ( high - low) >> 1);
+		if ( moves[ mid ].old_off < look_for)
+			{
+			low = mid + 1;
+			}  // look higher?
+		else
+			{
+			high = mid;
+			}  // look lower (or here)?
+
+		}  // narrow down each half
+
+	if ( low >= num_moves)
+		{
+		return key;
+		}  // not moved?
+
+	return key + ( moves[ low ].new_off - moves[ low ].old_off);
+	}  // _________________________________________________________
+
+/** replay one compaction, rekeying the live frames */
+static
+void					replay_compact
+	(
+	t_replay *			rp,				// replay state
+	const
+	t_record_move *		moves,			// moves, in offset order
+	size_t				num_moves		// number of moves
+	)
+	{
+	t_remap *			remap;
+	t_live *			old;
+	size_t				old_slots;
+	size_t				idx;
+	t_live				live;
+
+	remap = NULL;
+	if ( ! rp->use_malloc)
+		{
+		remap = bza_compact( NULL, rp->stack);
+		}  // bza?
+
+	// rekey every live frame (and translate its handle)
+	old = rp->lives;
+	old_slots = rp->mask + 1;
+	rp->lives = calloc( old_slots, sizeof( t_live) );
+	for ( idx = 0; idx < old_slots; idx++)
+
+		{
+		if ( old[ idx ].key == 0)
+			{
+			continue;  // === skip ===
+			}  // empty?
+
+		live = old[ idx ];
+		live.key = moved_key( moves, num_moves, live.key);
+		if ( remap != NULL)
+			{
+			live.handle = bza_remap_off( remap, live.handle);
+			}  // bza?
+
+		rp->lives[ find_slot( rp, live.key) ] = live;
+		}  // move each entry
+
+	free( old);
+	if ( remap != NULL)
+		{
+		bza_dest_remap( NULL, &remap);
+		}  // bza?
+
+	}  // _________________________________________________________
+
+/** replay one call */
+static
+void					replay_ev
+	(
+	t_replay *			rp,				// replay state
+	const
+	t_record_ev *		ev				// recorded call
+	)
+	{
+	size_t				idx;
+	t_live *			live;
+	void *				ptr;
+
+	switch ( ev->op)
+		{
+		case BZA_EV_CONS:
+			if ( ( ( rp->num_lives + 1) * 2) > ( rp->mask + 1) )
+				{
+				resize_table( rp, ( rp->mask + 1) * 2);
+				}  // keep the table at most half full
+
+			live = &( rp->lives[ find_slot( rp, ev->off) ]);
+			live->key = ev->off;
+			live->refs = 1;
+			live->size = ev->size;
+			if ( rp->use_malloc)
+				{
+				live->ptr = ptr = malloc( ( ev->size > 0) ? ev->size : 1);
+				}  // malloc?
+			else
+				{
+				live->handle = bza_cons_stk_frame( NULL, &( rp->stack), ev->size);
+				ptr = bza_get_frame_ptr( NULL, rp->stack, live->handle);
+				}  // bza
+
+			memset( ptr, 0, ev->size);
+			rp->num_lives++;
+			rp->live_bytes += ev->size;
+			if ( rp->live_bytes > rp->peak_bytes)
+				{
+				rp->peak_bytes = rp->live_bytes;
+				}  // new peak?
+
+			break;
+
+		case BZA_EV_REF:
+			live = &( rp->lives[ find_slot( rp, ev->off) ]);
+			if ( live->key == 0)
+				{
+				break;  // === skip ===
+				}  // unknown (made before recording started)?
+
+			live->refs++;
+			if ( ! rp->use_malloc)
+				{
+				bza_ref_stk_frame( NULL, rp->stack, live->handle);
+				}  // bza?
+
+			break;
+
+		case BZA_EV_DEREF:
+			idx = find_slot( rp, ev->off);
+			live = &( rp->lives[ idx ]);
+			if ( live->key == 0)
+				{
+				break;  // === skip ===
+				}  // unknown (made before recording started)?
+
+			live->refs--;
+			if ( ! rp->use_malloc)
+				{
+				bza_deref_stk_frame( NULL, rp->stack, live->handle);
+				}  // bza?
+			else if ( live->refs == 0)
+				{
+				free( live->ptr);
+				}  // last malloc reference?
+
+			if ( live->refs == 0)
+				{
+				rp->live_bytes -= live->size;
+				remove_slot( rp, idx);
+				}  // gone?
+
+			break;
+
+		case BZA_EV_RESET:
+		case BZA_EV_RELEASE:
+			// (a release drops the frames at or above its checkpoint)
+			idx = 0;
+			while ( idx <= rp->mask)
+
+				{
+				live = &( rp->lives[ idx ]);
+				if ( ( live->key != 0) &&
+					 ( ( ev->op == BZA_EV_RESET) || ( live->key >= ev->off) ) )
+					{
+					drop_live( rp, live);
+					remove_slot( rp, idx);
+					}  // dropped (check this slot again, shifted into)?
+				else
+					{
+					idx++;
+					}  // kept
+
+				}  // check each slot
+
+			break;
+
+		default:
+			break;
+		}  // what sort of call?
+
+	}  // _________________________________________________________
+
+/**
+ * Load the whole recording, replay it, and report.
+ */
+int						main
+	(
+	int					argc,
+	char *				argv []
+	)
+	{
+	FILE *				in;
+	long				file_sz;
+	char *				buf;
+	t_record_hdr *		hdr;
+	const
+	t_record_ev *		ev;
+	size_t				pos;
+	long				num_ops;
+	t_replay			rp;
+	t_stack_opts		opts;
+	t_stack_stats		stats;
+	long				rss_base;
+	long				rss_peak;
+	double				start;
+	double				elapsed;
+
+	if ( argc < 2)
+		{
+		fprintf( stderr, "usage:  replay recording [bza|malloc]\n");
+		return 1;
+		}  // no recording?
+
+	// load it all, so that reading it isn't timed
+	in = fopen( argv[ 1 ], "rb");
+	if ( in == NULL)
+		{
+		perror( argv[ 1 ]);
+		return 1;
+		}  // can't open?
+
+	fseek( in, 0, SEEK_END);
+	file_sz = ftell( in);
+	rewind( in);
+	buf = malloc( file_sz);
+	if ( ( file_sz < sizeof( t_record_hdr) ) ||
+		 ( fread( buf, 1, file_sz, in) != file_sz) ||
+		 ( memcmp( buf, BZA_RECORD_MAGIC, sizeof( hdr->magic) ) != 0) )
+		{
+		fprintf( stderr, "not a buzzard recording\n");
+		return 1;
+		}  // bad file?
+
+	fclose( in);
+	hdr = (t_record_hdr *) buf;
+
+	memset( &rp, 0, sizeof( rp) );
+	rp.use_malloc = ( argc > 2) && ( strcmp( argv[ 2 ], "malloc") == 0);
+	resize_table( &rp, 1024);
+	if ( ! rp.use_malloc)
+		{
+		memset( &opts, 0, sizeof( opts) );
+		opts.flags = hdr->flags;
+		rp.stack = bza_cons_stack_opts( NULL, &opts);
+		}  // bza?
+
+	rss_base = peak_rss_kb();
+	num_ops = 0;
+	start = now_sec();
+	for ( pos = sizeof( t_record_hdr);
+		  ( pos + sizeof( t_record_ev) ) <= file_sz;
+		  pos += sizeof( t_record_ev) )
+
+		{
+		ev = (const t_record_ev *) ( buf + pos);
+		if ( ev->op == BZA_EV_COMPACT)
+			{
+			replay_compact( &rp, (const t_record_move *) ( ev + 1), ev->size);
+			pos += ev->size * sizeof( t_record_move);
+			}  // followed by moves?
+		else
+			{
+			replay_ev( &rp, ev);
+			}  // single call
+
+		num_ops++;
+		}  // replay each call
+
+	elapsed = now_sec() - start;
+	rss_peak = peak_rss_kb();
+
+	printf( "%-6s  %ld calls  %8.3f s  %8.2f Mcalls/s\n",
+			rp.use_malloc ? "malloc" : "bza",
+			num_ops, elapsed, ( num_ops / elapsed) / 1e6);
+	printf( "        peak live %ld KB  peak RSS +%ld KB  fragmentation %.1f%%\n",
+			(long) ( rp.peak_bytes / 1024), rss_peak - rss_base,
+			( rss_peak > rss_base) ?
+				( 100.0 * ( 1.0 - ( ( rp.peak_bytes / 1024.0) /
+					( rss_peak - rss_base) ) ) ) :
+				0.0);
+	if ( ! rp.use_malloc)
+		{
+		bza_get_stats( NULL, rp.stack, &stats);
+		printf( "        high water %ld KB  stranded at end %ld KB\n",
+				(long) ( stats.high_water / 1024),
+				(long) ( stats.stranded_bytes / 1024) );
+		bza_dest_stack( NULL, &( rp.stack) );
+		}  // bza?
+
+	return 0;
+	}  // _________________________________________________________
+
+// vi: ts=4 sw=4 ai
+// *** EOF ***
@@ -0,0 +1,176 @@
+/**
+ * Decode an allocator event trace (from bza_trace_save)
+ *  into a readable timeline, followed by a count of each operation.
+ *  usage:  bz_trace [trace_file]   (standard input if none)
+ */
+/*
+    buzzard:  blaze runtime (so far, just a simple memory management library)
+
+    Copyright (C) 2010, Robin R Anderson
+    roboprog@yahoo.com
+    PO 1608
+    Shingle Springs, CA 95682
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bzrt_alloc.h"
+
+/** return the display name of an operation */
+static
+const
+char *					op_name
+	(
+	uint32_t			op				// e_trace_op
+	)
+	{
+	static
+	const
+	char *				NAMES[ BZA_EV_NUM_OPS ] =
+		{
+		"?",
+		"cons",
+		"ref",
+		"deref",
+		"grow",
+		"reset",
+		"release",
+		"compact"
+		};
+
+	return ( op < BZA_EV_NUM_OPS) ? NAMES[ op ] : "?";
+	}  // _________________________________________________________
+
+/** print one event */
+static
+void					print_ev
+	(
+	uint64_t			seq,			// sequence number
+	double				usec,			// time since tracing started
+	const
+	t_trace_ev *		ev				// event
+	)
+	{
+	printf( "%10llu %14.3f  %-8s", (unsigned long long) seq, usec,
+			op_name( ev->op) );
+	switch ( ev->op)
+		{
+		case BZA_EV_CONS:
+			printf( "  frame %12llu  size %10lu\n",
+					(unsigned long long) ev->off, (unsigned long) ev->size);
+			break;
+
+		case BZA_EV_REF:
+		case BZA_EV_DEREF:
+			printf( "  frame %12llu  refs %10lu%s\n",
+					(unsigned long long) ev->off, (unsigned long) ev->size,
+					( ( ev->op == BZA_EV_DEREF) && ( ev->size == 0) ) ?
+						"  (freed)" : "");
+			break;
+
+		case BZA_EV_GROW:
+			printf( "  size %13lu\n", (unsigned long) ev->size);
+			break;
+
+		case BZA_EV_RELEASE:
+			printf( "  mark %13llu\n", (unsigned long long) ev->off);
+			break;
+
+		case BZA_EV_COMPACT:
+			printf( "  top %14llu  live %10lu\n",
+					(unsigned long long) ev->off, (unsigned long) ev->size);
+			break;
+
+		default:
+			printf( "\n");
+			break;
+		}  // what sort of event?
+
+	}  // _________________________________________________________
+
+/**
+ * Read the trace header, then print each event and a summary.
+ */
+int						main
+	(
+	int					argc,
+	char *				argv []
+	)
+	{
+	FILE *				in;
+	t_trace_hdr			hdr;
+	t_trace_ev			ev;
+	uint64_t			seq;
+	uint64_t			counts[ BZA_EV_NUM_OPS ];
+	uint64_t			last_ticks;
+	uint32_t			op;
+
+	in = ( argc > 1) ? fopen( argv[ 1 ], "rb") : stdin;
+	if ( in == NULL)
+		{
+		perror( argv[ 1 ]);
+		return 1;
+		}  // can't open?
+
+	if ( ( fread( &hdr, sizeof( hdr), 1, in) != 1) ||
+		 ( memcmp( hdr.magic, BZA_TRACE_MAGIC, sizeof( hdr.magic) ) != 0) )
+		{
+		fprintf( stderr, "not a buzzard trace\n");
+		return 1;
+		}  // bad header?
+
+	printf( "%llu events (from #%llu), %.3f ticks / ns\n\n",
+			(unsigned long long) hdr.num, (unsigned long long) hdr.first,
+			hdr.ticks_per_ns);
+	printf( "%10s %14s  %s\n", "seq", "usec", "op");
+
+	memset( counts, 0, sizeof( counts) );
+	last_ticks = hdr.ticks0;
+	for ( seq = hdr.first; seq < ( hdr.first + hdr.num); seq++)
+
+		{
+		if ( fread( &ev, sizeof( ev), 1, in) != 1)
+			{
+			fprintf( stderr, "trace cut short at #%llu\n",
+					(unsigned long long) seq);
+			return 1;
+			}  // truncated?
+
+		print_ev( seq, ( ev.ticks - hdr.ticks0) / ( hdr.ticks_per_ns * 1e3), &ev);
+		counts[ ( ev.op < BZA_EV_NUM_OPS) ? ev.op : 0 ]++;
+		last_ticks = ev.ticks;
+		}  // decode each event
+
+	printf( "\n%.3f usec traced\n",
+			( last_ticks - hdr.ticks0) / ( hdr.ticks_per_ns * 1e3) );
+	for ( op = 0; op < BZA_EV_NUM_OPS; op++)
+
+		{
+		if ( counts[ op ] > 0)
+			{
+			printf( "%-8s %10llu\n", op_name( op),
+					(unsigned long long) counts[ op ]);
+			}  // seen?
+
+		}  // summarize each operation
+
+	return 0;
+	}  // _________________________________________________________
+
+// vi: ts=4 sw=4 ai
+// *** EOF ***